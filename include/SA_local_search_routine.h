@@ -15,6 +15,7 @@
 #include "SA_local_search.h"
 #include "move_verifier.h"
 #include "exchange_verifier.h"
+#include "evaluation_cache.h"
 
 #include <vector>
 #include <boost/cstdint.hpp>
@@ -27,12 +28,15 @@ namespace R12 {
 	const static long double InitProb = 0.8;
 	// Min probability to take a move instead of an exchange
 	const static long double MinProb = 0.2;
+	// Number of Metropolis thresholds drawn before each call to SA_search (power of two)
+	const static uint32_t ThresholdTableSize = 1024;
 
 class SALocalSearchRoutine : public SALocalSearch
 {
 	private:
 		typedef boost::random::uniform_smallint<ProcessID> ProcessDist;
 		typedef boost::random::uniform_smallint<MachineID> MachineDist;
+		typedef boost::random::taus88 FastRNG;
 
 		long double MinTemperature;
 		long double IProbMove;
@@ -49,23 +53,39 @@ class SALocalSearchRoutine : public SALocalSearch
 		// constructed during initialization
 		ProcessDist m_pDist;
 		MachineDist m_mDist;
+		EvaluationCache m_cache;
+		// seeded from the shared generator, much cheaper than the Mersenne twister for the inner loop
+		FastRNG m_fastRng;
+		// -T ln(u) thresholds of the Metropolis test, refilled at the start of SA_search
+		std::vector<int64_t> m_thresholds;
 
-		inline bool IterationEnd(uint32_t iteration) { return (iteration>MaxIterations || interrupted());}
+		// the flag is read every 256 iterations
+		inline bool IterationEnd(uint32_t iteration) { return (iteration>MaxIterations || ((iteration & 255) == 0 && interrupted()));}
 
 		// Statistics
 		long double BestMoveTemperature;
 		uint32_t NullMoves;
-		uint64_t IntialObjective;
+		uint64_t m_iterations;
+		double m_seconds;
 
 		//Move randomMove(const SolutionInfo & info);
 		//Exchange randomExchange(const SolutionInfo & info);
 		long double Probability(long double MaxT, long double T);
+		void fillThresholds(double temperature);
+		void commit(MoveVerifier & mverifier, ExchangeVerifier & exverifier, bool isMove, const Move & move, const Exchange & exmove);
 
 	public:
 		virtual void configure(const ParameterMap & parameters);
 		virtual void SA_search(SolutionInfo & info, uint64_t bestObjective, long double MaxT, long double T);
 		const uint32_t getNullMoves() const {return NullMoves;}
 		const long double getBestMoveTemperature() const {return BestMoveTemperature;}
+		/*! Returns the iterations performed by all the calls to SA_search. */
+		uint64_t iterations() const { return m_iterations; }
+		/*! Returns the seconds spent in SA_search. */
+		double seconds() const { return m_seconds; }
+		double iterationsPerSecond() const { return m_seconds > 0.0 ? m_iterations / m_seconds : 0.0; }
+		/*! Must be called when SA_search is going to work on a different solution. */
+		void resetCache() { m_cache.reset(); }
 };
 
 }
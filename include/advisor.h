@@ -2,25 +2,34 @@
 #define R12_ADVISOR_H
 
 #include "problem.h"
+#include "solution_info.h"
 #include "move.h"
 #include "exchange.h"
 #include "compatibility.h"
+#include "requirement_buckets.h"
 #include <vector>
+#include <memory>
 #include <boost/random.hpp>
 
 namespace R12 {
 
 class Advisor {
 private:
-	Compatibility m_comp;
+	std::shared_ptr<const Compatibility> m_compPtr;
+	const Compatibility & m_comp;
+	RequirementBuckets m_buckets;
 	boost::mt19937 & m_rng;
 	boost::random::discrete_distribution<ProcessID> m_pDist;
 public:
 	Advisor(const Problem & instance,
 			const std::vector<MachineID> & initial,
-			boost::mt19937 & rng)
-			: m_comp(instance, initial),
+			boost::mt19937 & rng,
+			const uint32_t threads = 1)
+			: m_compPtr(Compatibility::shared(instance, initial, threads)),
+			  m_comp(*m_compPtr),
+			  m_buckets(instance),
 			  m_rng(rng) {
+		// the weights rank all processes by compatible count, so the advisor forces the full count up front
 		ProcessCount pCount = instance.processes().size();
 		std::vector<double> weights(pCount);
 		for (ProcessCount pIdx = 0; pIdx < pCount; ++pIdx) {
@@ -53,15 +62,27 @@ public:
 		return Move(p, src, dst);
 	}
 	Exchange adviseExchange(const SolutionInfo & info) const {
-		ProcessID p1, p2;
-		MachineID m1, m2;
-		do {
-			// select processes
+		const uint32_t maxDraws = 8;
+		const ProcessCount pCount = info.solution().size();
+		ProcessID p1 = 0;
+		ProcessID p2 = 0;
+		MachineID m1 = 0;
+		MachineID m2 = 0;
+		for (uint32_t draw = 0; draw < maxDraws; ++draw) {
+			// select a process and a partner with a similar requirement profile
 			p1 = m_pDist(m_rng);
-			p2 = m_pDist(m_rng);
+			p2 = m_buckets.partner(p1, m_rng);
 			m1 = info.solution()[p1];
 			m2 = info.solution()[p2];
-		} while (p1 == p2 || !m_comp.compatible(p1, m2) || !m_comp.compatible(p2, m1));
+			if (p1 != p2 && m1 != m2 && m_comp.compatible(p1, m2) && m_comp.compatible(p2, m1)) {
+				break;
+			}
+		}
+		// the verifier rejects the exchange if no compatible pair was found
+		if (p1 == p2) {
+			p2 = (p1 + 1) % pCount;
+			m2 = info.solution()[p2];
+		}
 		return Exchange(m1,p1,m2,p2);
 	}
 };
@@ -0,0 +1,86 @@
+#ifndef R12_ALIAS_TABLE_H
+#define R12_ALIAS_TABLE_H
+
+#include "common.h"
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/random.hpp>
+
+namespace R12 {
+
+/*! Walker's alias method: O(n) construction, O(1) sampling from a discrete distribution. */
+class AliasTable {
+private:
+	std::vector<float> m_prob;
+	std::vector<uint32_t> m_alias;
+public:
+	AliasTable() {
+	}
+	AliasTable(const std::vector<double> & weights) {
+		build(weights);
+	}
+	uint32_t size() const {
+		return m_prob.size();
+	}
+	/*! Rebuilds the table from non-negative weights, at least one of which must be positive. */
+	void build(const std::vector<double> & weights) {
+		const uint32_t n = weights.size();
+		CHECK(n > 0);
+		m_prob.resize(n);
+		m_alias.resize(n);
+		double total = 0.0;
+		for (uint32_t i = 0; i < n; ++i) {
+			total += weights[i];
+		}
+		CHECK(total > 0.0);
+		// scaled probabilities have mean one
+		std::vector<double> scaled(n);
+		std::vector<uint32_t> small;
+		std::vector<uint32_t> large;
+		small.reserve(n);
+		large.reserve(n);
+		for (uint32_t i = 0; i < n; ++i) {
+			scaled[i] = weights[i] * n / total;
+			if (scaled[i] < 1.0) {
+				small.push_back(i);
+			} else {
+				large.push_back(i);
+			}
+		}
+		while (!small.empty() && !large.empty()) {
+			const uint32_t s = small.back();
+			small.pop_back();
+			const uint32_t l = large.back();
+			m_prob[s] = static_cast<float>(scaled[s]);
+			m_alias[s] = l;
+			scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+			if (scaled[l] < 1.0) {
+				large.pop_back();
+				small.push_back(l);
+			}
+		}
+		// leftovers are one up to rounding errors
+		for (auto itr = large.begin(); itr != large.end(); ++itr) {
+			m_prob[*itr] = 1.0f;
+			m_alias[*itr] = *itr;
+		}
+		for (auto itr = small.begin(); itr != small.end(); ++itr) {
+			m_prob[*itr] = 1.0f;
+			m_alias[*itr] = *itr;
+		}
+	}
+	template<typename Engine> uint32_t sample(Engine & rng) const {
+		boost::random::uniform_int_distribution<uint32_t> columnDist(0, m_prob.size() - 1);
+		boost::random::uniform_01<float> coinDist;
+		const uint32_t column = columnDist(rng);
+		if (coinDist(rng) < m_prob[column]) {
+			return column;
+		} else {
+			return m_alias[column];
+		}
+	}
+};
+
+}
+
+#endif
@@ -19,6 +19,8 @@ struct Arguments {
 	bool onlyPrintName;
 	unsigned int seed;
 	std::string heuristicName;
+	uint32_t threads;
+	bool staticSchedule;
 	bool analyze;
 	bool parse(int argc, char ** argv);
 };
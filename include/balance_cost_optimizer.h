@@ -3,13 +3,61 @@
 
 #include "common.h"
 #include "solution_info.h"
+#include "exchange.h"
+#include "exchange_verifier.h"
+#include "task_runtime.h"
+#include <vector>
+#include <memory>
 
 namespace R12 {
 
+/*! Reduces each balance cost by exchanging processes of the machines with a positive balance cost with processes
+	of the machines with a negative one. The processes of every machine are indexed and kept up to date on commit;
+	the candidate exchanges of each step are evaluated by up to threads workers of the task runtime, each with its own
+	verifier, and reduced so that the committed exchange does not depend on the number of workers. */
 class BalanceCostOptimizer {
-	void optimizeBalance(SolutionInfo & x, const BalanceCostID b) const;
+private:
+	struct Worker {
+		std::unique_ptr<ExchangeVerifier> ev;
+		uint64_t bestObj;
+		Exchange bestExchange;
+		uint32_t bestIndex;
+		Worker() : bestObj(0), bestExchange(0, 0, 0, 0), bestIndex(0) {
+		}
+	};
+	class EvaluateBody : public ParallelBody {
+	private:
+		BalanceCostOptimizer & m_optimizer;
+		const Problem & m_instance;
+		const BalanceCost & m_balance;
+		const MachineID m_m1;
+	public:
+		EvaluateBody(BalanceCostOptimizer & optimizer, const Problem & instance, const BalanceCost & balance, const MachineID m1)
+		: m_optimizer(optimizer), m_instance(instance), m_balance(balance), m_m1(m1) {
+		}
+		virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) {
+			m_optimizer.evaluate(m_optimizer.m_workers[worker], m_instance, m_balance, m_m1, begin, end);
+		}
+	};
+private:
+	uint32_t m_threads;
+	std::vector<Worker> m_workers;
+	// processes of each machine and position of each process in the list of its machine
+	std::vector<std::vector<ProcessID>> m_procByMachine;
+	std::vector<uint32_t> m_position;
+	// machines with a negative balance cost for the current balance, by increasing cost
+	std::vector<MachineID> m_negative;
+private:
+	void index(SolutionInfo & x);
+	void evaluate(Worker & worker, const Problem & instance, const BalanceCost & balance, const MachineID m1, const uint32_t begin, const uint32_t end);
+	bool bestExchange(const SolutionInfo & x, const BalanceCost & balance, const MachineID m1, Exchange & exchange);
+	void commit(const Exchange & exchange);
+	void relocate(const ProcessID p, const MachineID src, const MachineID dst);
+	void optimizeBalance(SolutionInfo & x, const BalanceCostID b);
 public:
-	void optimize(SolutionInfo & x) const;
+	/*! Evaluates the candidate exchanges with at most threads workers, all the slots of the task runtime by default. */
+	explicit BalanceCostOptimizer(const uint32_t threads = TaskRuntime::instance().threads());
+	void optimize(SolutionInfo & x);
 };
 
 }
@@ -5,18 +5,52 @@
 #include "problem.h"
 #include "verifier.h"
 #include "solution_info.h"
+#include "move.h"
+#include "move_verifier.h"
+#include "task_runtime.h"
 #include <memory>
 
 namespace R12 {
 
-/*! Performs a best-improvement local search. */
+/*! Performs a best-improvement local search.
+	With threads greater than one, the processes are split among the workers of the task runtime at each iteration. */
 class BestImprovementLocalSearch : public Heuristic {
+private:
+	/*! Best move found by a worker; ties are broken by process and machine as in a sequential scan. */
+	struct Candidate {
+		Move move;
+		uint64_t obj;
+		uint64_t moveCount;
+		Candidate() : move(0, 0, 0), obj(0), moveCount(0) {
+		}
+		bool better(const Move & other, const uint64_t otherObj) const {
+			if (otherObj != obj) return otherObj < obj;
+			if (other.p() != move.p()) return other.p() < move.p();
+			return other.dst() < move.dst();
+		}
+	};
+	/*! Evaluates all moves of a range of processes against the shared solution. */
+	class ScanBody : public ParallelBody {
+	private:
+		BestImprovementLocalSearch & m_ls;
+		const SolutionInfo & m_info;
+		std::vector<std::unique_ptr<MoveVerifier>> & m_verifiers;
+		std::vector<Candidate> & m_candidates;
+	public:
+		ScanBody(BestImprovementLocalSearch & ls, const SolutionInfo & info,
+				 std::vector<std::unique_ptr<MoveVerifier>> & verifiers, std::vector<Candidate> & candidates)
+		: m_ls(ls), m_info(info), m_verifiers(verifiers), m_candidates(candidates) {
+		}
+		virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker);
+	};
 private:
 	std::vector<MachineID> m_bestSolution;
 	uint64_t m_bestObjective;
+	uint32_t m_threads;
 public:
 	BestImprovementLocalSearch() {
 		m_bestObjective = 0;
+		m_threads = 0;
 	}
 	void runFromSolution(SolutionInfo & info);
 	virtual void run();
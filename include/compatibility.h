@@ -3,98 +3,104 @@
 
 #include "common.h"
 #include "problem.h"
-#include "solution_info.h"
+#include "task_runtime.h"
 #include <vector>
-#include <algorithm>
+#include <memory>
+#include <pthread.h>
 
 namespace R12 {
 
+/*! Determines which machines can host each process, given the capacity left free by transient usage in the initial assignment.
+	Compatible machine lists are computed lazily per process, while counts are computed on first use for all processes at once,
+	scanning blocks of processes against blocks of machines. Safe to share among threads. */
 class Compatibility {
 private:
-	std::vector<bool> m_compMatrix;
-	std::vector<std::vector<MachineID>> m_comp;
-	std::vector<ProcessID> m_pByCompCount;
-	uint32_t m_compCount;
+	const Problem & m_instance;
+	const std::vector<MachineID> & m_initial;
+	uint32_t m_threads;
+	// usable capacity, resource-major: m_usable[r * mCount + m]
+	std::vector<uint32_t> m_usable;
+	// lazily computed compatible machines of each process
+	mutable std::vector<std::vector<MachineID>> m_comp;
+	mutable std::vector<int32_t> m_compReady;
+	// lazily computed counts for all processes
+	mutable std::vector<MachineCount> m_count;
+	mutable std::vector<ProcessID> m_pByCompCount;
+	mutable uint32_t m_compCount;
+	mutable int32_t m_countReady;
+	mutable pthread_mutex_t m_mutex;
 private:
 	class CompatibleCountCompare {
 	private:
-		const Compatibility & m_compatibility;
+		const std::vector<MachineCount> & m_count;
 	public:
-		CompatibleCountCompare(const Compatibility & compatibility)
-		: m_compatibility(compatibility) {
+		CompatibleCountCompare(const std::vector<MachineCount> & count)
+		: m_count(count) {
 		}
 		bool operator()(const ProcessID p1, const ProcessID p2) const {
-			return m_compatibility.compatibleCount(p1) < m_compatibility.compatibleCount(p2);
+			return m_count[p1] < m_count[p2];
 		}
 	};
-public:
-	Compatibility(const Problem & instance, const std::vector<MachineID> & initial) {
-		const ProcessCount pCount = instance.processes().size();
-		const MachineCount mCount = instance.machines().size();
-		// initialize compatibility
-		m_comp.resize(pCount);
-		m_compMatrix.resize(pCount * mCount);
-		SolutionInfo initialInfo(instance, initial);
-		m_compCount = 0;
-		for (MachineID m = 0; m < mCount; ++m) {
-			const Machine & machine = instance.machines()[m];
-			// compute usable capacity at machine m
-			std::vector<uint32_t> usable(instance.resources().size());
-			const std::vector<ResourceID> & transient = instance.transientResources();
-			for (auto itr = transient.begin(); itr != transient.end(); ++itr) {
-				const ResourceID r = *itr;
-				usable[r] = machine.capacity(r) - initialInfo.usage(m, r);
-			}
-			const std::vector<ResourceID> & nonTransient = instance.nonTransientResources();
-			for (auto itr = nonTransient.begin(); itr != nonTransient.end(); ++itr) {
-				const ResourceID r = *itr;
-				usable[r] = machine.capacity(r);
-			}
-			// determine compatible processes
-			for (ProcessID p = 0; p < pCount; ++p) {
-				const Process & process = instance.processes()[p];
-				bool compatible = true;
-				if (initial[p] != m) {
-					for (ResourceID r = 0; r < instance.resources().size(); ++r) {
-						if (process.requirement(r) > usable[r]) {
-							compatible = false;
-							break;
-						}
-					}
-				}
-				if (compatible) {
-					m_comp[p].push_back(m);
-					m_compMatrix[p + m * pCount] = true;
-					++m_compCount;
-				}
-			}
+	/*! Counts the compatible machines of a range of process blocks. */
+	class CountBody : public ParallelBody {
+	private:
+		const Compatibility & m_comp;
+	public:
+		CountBody(const Compatibility & comp) : m_comp(comp) {
 		}
-		// sort compatible machines
-		for (ProcessID p = 0; p < instance.processes().size(); ++p) {
-			CHECK(m_comp[p].size() >= 1);
-			std::sort(m_comp[p].begin(), m_comp[p].end());
+		virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker);
+	};
+private:
+	Compatibility(const Compatibility &);
+	Compatibility & operator=(const Compatibility &);
+	/*! Marks in mask the machines of [mBegin, mEnd) which can host process p. */
+	void scanBlock(const ProcessID p, const MachineID mBegin, const MachineID mEnd, uint8_t * mask) const;
+	void countRange(const ProcessID pBegin, const ProcessID pEnd) const;
+	void buildList(const ProcessID p) const;
+	void buildCounts() const;
+	const std::vector<MachineID> & list(const ProcessID p) const {
+		if (!__atomic_load_n(&m_compReady[p], __ATOMIC_ACQUIRE)) {
+			buildList(p);
 		}
-		// processes sorted by compatibility
-		m_pByCompCount.resize(instance.processes().size());
-		for (ProcessID p = 0; p < instance.processes().size(); ++p) {
-			m_pByCompCount[p] = p;
+		return m_comp[p];
+	}
+	void ensureCounts() const {
+		if (!__atomic_load_n(&m_countReady, __ATOMIC_ACQUIRE)) {
+			buildCounts();
 		}
-		std::sort(m_pByCompCount.begin(), m_pByCompCount.end(), CompatibleCountCompare(*this));
 	}
+public:
+	/*! Counts for all processes are computed using at most the given number of threads of the task runtime. */
+	Compatibility(const Problem & instance, const std::vector<MachineID> & initial, const uint32_t threads = 1);
+	~Compatibility();
+	/*! Returns the instance shared by all users of the same problem and initial assignment, creating it if needed. */
+	static std::shared_ptr<const Compatibility> shared(const Problem & instance, const std::vector<MachineID> & initial, const uint32_t threads = 1);
 	bool compatible(const ProcessID p, const MachineID m) const {
-		ProcessCount pCount = m_comp.size();
-		return m_compMatrix[p + m * pCount];
+		if (m_initial[p] == m) {
+			return true;
+		}
+		const MachineCount mCount = m_instance.machines().size();
+		const Process & process = m_instance.processes()[p];
+		for (ResourceID r = 0; r < m_instance.resources().size(); ++r) {
+			if (process.requirement(r) > m_usable[r * mCount + m]) {
+				return false;
+			}
+		}
+		return true;
 	}
 	MachineCount compatibleCount(const ProcessID p) const {
-		return m_comp[p].size();
+		ensureCounts();
+		return m_count[p];
 	}
 	MachineID getCompatible(const ProcessID p, const MachineCount idx) const {
-		return m_comp[p][idx];
+		return list(p)[idx];
 	}
 	ProcessID processByCompatibleCount(const ProcessCount idx) const {
+		ensureCounts();
 		return m_pByCompCount[idx];
 	}
 	uint32_t totalCompatibleCount() const {
+		ensureCounts();
 		return m_compCount;
 	}
 };
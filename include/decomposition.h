@@ -0,0 +1,73 @@
+#ifndef R12_DECOMPOSITION_H
+#define R12_DECOMPOSITION_H
+
+#include "common.h"
+#include "heuristic.h"
+#include "problem.h"
+#include "solution_info.h"
+#include "solution_pool.h"
+#include "atomic_flag.h"
+#include <vector>
+#include <memory>
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/random.hpp>
+
+namespace R12 {
+
+/*! Splits the machines into clusters of whole neighborhoods and improves the clusters in parallel, each as an independent
+	instance solved by another heuristic for a round, then merges the results which keep the whole solution feasible and better.
+	Processes of a service are only free to move inside a cluster when the constraints involving the service can be stated
+	on the cluster alone; the others are fixed and their usage is subtracted from the capacities of the cluster machines.
+	The partition changes at every round. Parameters: sub (heuristic solving the clusters, which receives the same configuration),
+	clusters (default: the runtime threads) and round (seconds per round). */
+class Decomposition : public Heuristic {
+private:
+	/*! A cluster as an instance of its own. */
+	struct SubProblem {
+		// cluster machine and free process of each index of the instance
+		std::vector<MachineID> machines;
+		std::vector<ProcessID> processes;
+		std::vector<MachineID> initial;
+		std::vector<MachineID> solution;
+		std::unique_ptr<Problem> instance;
+		std::unique_ptr<SolutionInfo> start;
+		uint64_t startObjective;
+		std::unique_ptr<SolutionPool> pool;
+		std::unique_ptr<Heuristic> heuristic;
+	};
+private:
+	std::unique_ptr<SolutionInfo> m_best;
+	boost::mt19937 m_rng;
+	// stops the heuristics of the clusters at the end of a round
+	AtomicFlag m_roundFlag;
+	std::vector<NeighborhoodID> m_neighborhoods;
+	// cluster of each machine and service state, reused while building the clusters
+	std::vector<uint32_t> m_machineCluster;
+	std::vector<uint8_t> m_serviceFree;
+	std::vector<uint32_t> m_serviceIndex;
+	std::vector<uint32_t> m_machineIndex;
+private: // parameters
+	std::string m_subName;
+	uint32_t m_clusters;
+	double m_roundTime;
+private:
+	void partition(std::vector<std::vector<MachineID>> & clusters);
+	bool build(const uint32_t cluster, const std::vector<MachineID> & machines, SubProblem & sub);
+	void solve(std::vector<std::unique_ptr<SubProblem>> & subs);
+	bool merge(std::vector<std::unique_ptr<SubProblem>> & subs);
+	void apply(const SubProblem & sub, std::vector<MachineID> & solution) const;
+public:
+	virtual void run();
+	virtual void runFromSolution(SolutionInfo & info);
+	virtual const std::vector<MachineID> & bestSolution() const {
+		return m_best->solution();
+	}
+	virtual uint64_t bestObjective() const {
+		return m_best->objective();
+	}
+};
+
+}
+
+#endif
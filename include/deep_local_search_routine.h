@@ -9,23 +9,42 @@
 #include "atomic_flag.h"
 #include "parameter_map.h"
 #include "local_search_routine.h"
+#include "sample_worker.h"
+#include "task_runtime.h"
 #include <vector>
 #include <boost/cstdint.hpp>
 #include <boost/random.hpp>
 
 namespace R12 {
 
+/*! Commits the best of a batch of random improving moves and exchanges. With threads greater than one,
+	the trials and samples of each iteration are split among workers of the task runtime. */
 class DeepLocalSearchRoutine : public LocalSearchRoutine {
 private:
 	typedef boost::random::uniform_smallint<uint8_t> MethodDist;
 	typedef boost::random::uniform_smallint<ProcessID> ProcessDist;
-	typedef boost::random::uniform_smallint<MachineID> MachineDist;
+	class CollectBody : public ParallelBody {
+	private:
+		DeepLocalSearchRoutine & m_routine;
+		const SolutionInfo & m_x;
+		const uint64_t & m_xObj;
+	public:
+		CollectBody(DeepLocalSearchRoutine & routine, const SolutionInfo & x, const uint64_t & xObj)
+		: m_routine(routine), m_x(x), m_xObj(xObj) {
+		}
+		virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) {
+			for (uint32_t w = begin; w < end; ++w) {
+				m_routine.collect(m_routine.m_workers[w], m_x, m_xObj);
+			}
+		}
+	};
 private: // constructed during initialization
 	ProcessDist m_pDist;
-	MachineDist m_mDist;
+	std::vector<SampleWorker> m_workers;
 private: // parameters
 	uint64_t m_maxTrials;
 	uint64_t m_maxSamples;
+	uint32_t m_threads;
 private: // statistics
 	uint64_t m_moveFeasibleEvalCount;
 	uint64_t m_moveObjectiveEvalCount;
@@ -35,8 +54,9 @@ private: // statistics
 	uint64_t m_exchangeCommitCount;
 private:
 	uint64_t defaultMaxTrials();
-	Move randomMove(const SolutionInfo & x);
-	Exchange randomExchange(const SolutionInfo & x);
+	Move randomMove(const SolutionInfo & x, boost::mt19937 & rng);
+	Exchange randomExchange(const SolutionInfo & x, boost::mt19937 & rng);
+	void collect(SampleWorker & worker, const SolutionInfo & x, const uint64_t xObj);
 public:
 	virtual void configure(const ParameterMap & parameters);
 	virtual void search(SolutionInfo & x);
@@ -9,33 +9,66 @@
 #include "atomic_flag.h"
 #include "parameter_map.h"
 #include "shake_routine.h"
+#include "task_runtime.h"
 #include <vector>
+#include <memory>
 #include <boost/cstdint.hpp>
 #include <boost/random.hpp>
 
 namespace R12 {
 
+/*! Shakes the solution into several independent samples and keeps the best one.
+	Samples are built in parallel on the task runtime, each with its own random generator seeded in sample order,
+	so that the result does not depend on the number of threads. */
 class DeepShakeRoutine : public ShakeRoutine {
 private:
 	typedef boost::random::uniform_smallint<uint8_t> MethodDist;
 	typedef boost::random::uniform_smallint<ProcessID> ProcessDist;
-	typedef boost::random::uniform_smallint<MachineID> MachineDist;
+	/*! Statistics of a worker. */
+	struct Counters {
+		uint64_t moveFeasibleEvalCount;
+		uint64_t moveObjectiveEvalCount;
+		uint64_t moveCommitCount;
+		uint64_t exchangeFeasibleEvalCount;
+		uint64_t exchangeObjectiveEvalCount;
+		uint64_t exchangeCommitCount;
+		Counters() : moveFeasibleEvalCount(0), moveObjectiveEvalCount(0), moveCommitCount(0),
+					 exchangeFeasibleEvalCount(0), exchangeObjectiveEvalCount(0), exchangeCommitCount(0) {
+		}
+	};
+	/*! Buffers reused by a worker across samples and shakes. */
+	struct Worker {
+		std::unique_ptr<SolutionInfo> x;
+		std::unique_ptr<SolutionInfo> best;
+		uint64_t bestObj;
+		uint64_t bestSample;
+		Counters counters;
+	};
+	class SampleBody : public ParallelBody {
+	private:
+		DeepShakeRoutine & m_routine;
+		const SolutionInfo & m_xStart;
+		const uint64_t m_k;
+	public:
+		SampleBody(DeepShakeRoutine & routine, const SolutionInfo & xStart, const uint64_t k)
+		: m_routine(routine), m_xStart(xStart), m_k(k) {
+		}
+		virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker);
+	};
 private: // constructed during initialization
 	ProcessDist m_pDist;
-	MachineDist m_mDist;
+	std::vector<Worker> m_workers;
+	std::vector<uint32_t> m_seeds;
 private: // parameters
 	uint64_t m_samples;
 	uint64_t m_maxTrials;
+	uint32_t m_threads;
 private: // statistics
-	uint64_t m_moveFeasibleEvalCount;
-	uint64_t m_moveObjectiveEvalCount;
-	uint64_t m_moveCommitCount;
-	uint64_t m_exchangeFeasibleEvalCount;
-	uint64_t m_exchangeObjectiveEvalCount;
-	uint64_t m_exchangeCommitCount;
+	Counters m_counters;
 private:
-	Move randomMove(const SolutionInfo & x);
-	Exchange randomExchange(const SolutionInfo & x);
+	Move randomMove(const SolutionInfo & x, boost::mt19937 & rng);
+	Exchange randomExchange(const SolutionInfo & x, boost::mt19937 & rng);
+	void buildSample(Worker & worker, const SolutionInfo & xStart, const uint64_t k, const uint64_t sample);
 public:
 	virtual void configure(const ParameterMap & parameters);
 	virtual void shake(SolutionInfo & x, const uint64_t k);
@@ -0,0 +1,121 @@
+#ifndef R12_DESTINATION_SAMPLER_H
+#define R12_DESTINATION_SAMPLER_H
+
+#include "common.h"
+#include "problem.h"
+#include "solution_info.h"
+#include "parameter_map.h"
+#include "alias_table.h"
+#include <vector>
+#include <memory>
+#include <pthread.h>
+#include <boost/cstdint.hpp>
+#include <boost/random.hpp>
+
+namespace R12 {
+
+/*! Chooses destination machines for random moves. The sampled machine may be the current machine of the process.
+	Between calls to refresh or update, sample may be called concurrently with different generators. */
+class DestinationSampler {
+public:
+	virtual ~DestinationSampler() {
+	}
+	/*! True if every machine is equally likely, regardless of the process. */
+	virtual bool uniform() const {
+		return false;
+	}
+	/*! Called when a routine starts working on solution x. */
+	virtual void refresh(const SolutionInfo & x) {
+	}
+	/*! Called after each move or exchange committed to the solution passed to refresh. */
+	virtual void update() {
+	}
+	virtual MachineID sample(const ProcessID p, boost::mt19937 & rng) = 0;
+};
+
+/*! Samples machines uniformly at random. */
+class UniformDestinationSampler : public DestinationSampler {
+private:
+	typedef boost::random::uniform_smallint<MachineID> MachineDist;
+private:
+	MachineDist m_mDist;
+public:
+	UniformDestinationSampler(const Problem & instance)
+	: m_mDist(0, instance.machines().size() - 1) {
+	}
+	virtual bool uniform() const {
+		return true;
+	}
+	virtual MachineID sample(const ProcessID p, boost::mt19937 & rng) {
+		return m_mDist(rng);
+	}
+};
+
+/*! Samples machines with probability decreasing with the machine move cost from the initial machine of the process. */
+class MoveCostDestinationSampler : public DestinationSampler {
+private:
+	const Problem & m_instance;
+	const std::vector<MachineID> & m_initial;
+	double m_bias;
+	// alias table index for each origin machine, built lazily
+	std::vector<uint32_t> m_tableIndex;
+	// origins whose move cost rows are identical share the same table, reserved for one table per machine so that tables never move
+	std::vector<AliasTable> m_tables;
+	std::vector<MachineID> m_tableOrigin;
+	std::vector<uint64_t> m_tableHash;
+	pthread_mutex_t m_mutex;
+private:
+	MoveCostDestinationSampler(const MoveCostDestinationSampler &);
+	MoveCostDestinationSampler & operator=(const MoveCostDestinationSampler &);
+	uint32_t buildTable(const MachineID origin);
+public:
+	MoveCostDestinationSampler(const Problem & instance, const std::vector<MachineID> & initial, const double bias);
+	virtual ~MoveCostDestinationSampler();
+	virtual MachineID sample(const ProcessID p, boost::mt19937 & rng) {
+		const MachineID origin = m_initial[p];
+		uint32_t index = m_tableIndex[origin];
+		__sync_synchronize();
+		if (index == UINT32_MAX) {
+			index = buildTable(origin);
+		}
+		return m_tables[index].sample(rng);
+	}
+};
+
+/*! Samples machines with probability proportional to their residual capacity in the current solution. */
+class CapacityDestinationSampler : public DestinationSampler {
+private:
+	const Problem & m_instance;
+	const SolutionInfo * m_x;
+	AliasTable m_table;
+	std::vector<double> m_weights;
+	std::vector<double> m_resourceScale;
+	uint32_t m_period;
+	uint32_t m_updates;
+private:
+	void rebuild();
+public:
+	CapacityDestinationSampler(const Problem & instance, const uint32_t period);
+	virtual void refresh(const SolutionInfo & x) {
+		m_x = &x;
+		rebuild();
+	}
+	virtual void update() {
+		++m_updates;
+		if (m_updates >= m_period) {
+			rebuild();
+		}
+	}
+	virtual MachineID sample(const ProcessID p, boost::mt19937 & rng) {
+		return m_table.sample(rng);
+	}
+};
+
+/*! Creates the sampler selected by the dst parameter (uniform, cost or capacity). */
+DestinationSampler * makeDestinationSampler(const Problem & instance,
+											const std::vector<MachineID> & initial,
+											const ParameterMap & parameters);
+
+}
+
+#endif
@@ -2,16 +2,39 @@
 #define R12_ELS_H
 
 #include "heuristic.h"
+#include "exchange_verifier.h"
+#include <vector>
 
 namespace R12 {
 
+/*! Exchanges processes between machines above and below their safety capacities when the exchange brings both machines
+	closer to their safety capacities and improves the objective. The distance of every machine from its safety capacities
+	is cached and updated on commit, the processes of every machine are kept in flat arrays, and the distances after
+	exchanging a process with each process of the partner machine are computed in a single pass over contiguous requirements. */
 class ELS : public Heuristic {
 private:
 	uint64_t m_bestObjective;
 	std::vector<MachineID> m_bestSolution;
-public:
+	// cached distance of each machine, negative when above safety capacity
+	std::vector<int64_t> m_distance;
+	// processes of each machine and position of each process in its array
+	std::vector<std::vector<ProcessID>> m_procByMachine;
+	std::vector<uint32_t> m_position;
+	// requirements of the processes of the partner machine and slack of the partner without each of them, resource by resource
+	std::vector<int64_t> m_partnerReq;
+	std::vector<int64_t> m_partnerBase;
+	std::vector<int64_t> m_base;
+	std::vector<int64_t> m_newDistance1;
+	std::vector<int64_t> m_newDistance2;
+	std::vector<uint8_t> m_outside1;
+	std::vector<uint8_t> m_outside2;
+private:
 	int64_t distance(const SolutionInfo & info, const MachineID m) const;
-	int64_t distance(const SolutionInfo & info, const MachineID m, const ProcessID pOut, const ProcessID pIn) const; 
+	void preparePartner(const SolutionInfo & info, const MachineID m2);
+	void computeDistances(const SolutionInfo & info, const MachineID m1, const ProcessID p1, const uint32_t count);
+	void moveProcess(const ProcessID p, const MachineID src, const MachineID dst);
+	static void removeMachine(std::vector<MachineID> & machines, const MachineID m);
+public:
 	virtual void run() {
 		SolutionInfo info(instance(), initial());
 		runFromSolution(info);
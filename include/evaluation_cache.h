@@ -0,0 +1,205 @@
+#ifndef R12_EVALUATION_CACHE_H
+#define R12_EVALUATION_CACHE_H
+
+#include "common.h"
+#include "problem.h"
+#include "move.h"
+#include "exchange.h"
+#include "move_verifier.h"
+#include "exchange_verifier.h"
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace R12 {
+
+/*! Direct-mapped cache of move and exchange evaluations.
+	Each entry stores the feasibility and the objective delta, excluding the service move cost
+	which depends on the whole solution and is recomputed on every hit. Entries are tagged with the
+	sum of the version counters of the machines, services and neighborhoods they depend on: since
+	counters only grow, the sum changes as soon as any of them is bumped by a commit. */
+class EvaluationCache {
+private:
+	struct Entry {
+		uint64_t key;
+		uint64_t stamp;
+		int64_t delta;
+		bool feasible;
+		Entry() : key(0), stamp(0), delta(0), feasible(false) {
+		}
+	};
+private:
+	const Problem * m_instancePtr;
+	uint64_t m_mask;
+	uint64_t m_epoch;
+	std::vector<Entry> m_moves;
+	std::vector<Entry> m_exchanges;
+	std::vector<uint32_t> m_machineVersion;
+	std::vector<uint32_t> m_serviceVersion;
+	std::vector<uint32_t> m_neighborhoodVersion;
+	uint64_t m_hits;
+	uint64_t m_misses;
+private:
+	const Problem & instance() const {
+		return *m_instancePtr;
+	}
+	static uint64_t slot(uint64_t key) {
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		return key;
+	}
+	static uint64_t moveKey(const Move & move) {
+		return (static_cast<uint64_t>(move.p()) << 32) |
+			   (static_cast<uint64_t>(move.src()) << 16) |
+			   static_cast<uint64_t>(move.dst());
+	}
+	static uint64_t exchangeKey(const Exchange & exchange) {
+		return (static_cast<uint64_t>(exchange.p1()) << 48) |
+			   (static_cast<uint64_t>(exchange.p2()) << 32) |
+			   (static_cast<uint64_t>(exchange.m1()) << 16) |
+			   static_cast<uint64_t>(exchange.m2());
+	}
+	uint64_t moveStamp(const Move & move) const {
+		const ServiceID s = instance().processes()[move.p()].service();
+		const NeighborhoodID nsrc = instance().machines()[move.src()].neighborhood();
+		const NeighborhoodID ndst = instance().machines()[move.dst()].neighborhood();
+		return m_epoch +
+			   m_machineVersion[move.src()] + m_machineVersion[move.dst()] +
+			   m_serviceVersion[s] +
+			   m_neighborhoodVersion[nsrc] + m_neighborhoodVersion[ndst];
+	}
+	uint64_t exchangeStamp(const Exchange & exchange) const {
+		const ServiceID s1 = instance().processes()[exchange.p1()].service();
+		const ServiceID s2 = instance().processes()[exchange.p2()].service();
+		const NeighborhoodID n1 = instance().machines()[exchange.m1()].neighborhood();
+		const NeighborhoodID n2 = instance().machines()[exchange.m2()].neighborhood();
+		return m_epoch +
+			   m_machineVersion[exchange.m1()] + m_machineVersion[exchange.m2()] +
+			   m_serviceVersion[s1] + m_serviceVersion[s2] +
+			   m_neighborhoodVersion[n1] + m_neighborhoodVersion[n2];
+	}
+	void touch(const ProcessID p, const MachineID src, const MachineID dst) {
+		const NeighborhoodID nsrc = instance().machines()[src].neighborhood();
+		const NeighborhoodID ndst = instance().machines()[dst].neighborhood();
+		++m_machineVersion[src];
+		++m_machineVersion[dst];
+		++m_serviceVersion[instance().processes()[p].service()];
+		if (nsrc != ndst) {
+			++m_neighborhoodVersion[nsrc];
+			++m_neighborhoodVersion[ndst];
+		}
+	}
+public:
+	EvaluationCache() : m_instancePtr(0), m_mask(0), m_epoch(1), m_hits(0), m_misses(0) {
+	}
+	/*! Allocates 2^bits entries for moves and for exchanges; zero bits disables the cache. */
+	void init(const Problem & instance, const uint32_t bits) {
+		m_instancePtr = &instance;
+		m_epoch = 1;
+		m_hits = 0;
+		m_misses = 0;
+		if (bits == 0) {
+			m_mask = 0;
+			m_moves.clear();
+			m_exchanges.clear();
+			return;
+		}
+		m_mask = (1ULL << bits) - 1;
+		m_moves.assign(m_mask + 1, Entry());
+		m_exchanges.assign(m_mask + 1, Entry());
+		m_machineVersion.assign(instance.machines().size(), 0);
+		m_serviceVersion.assign(instance.services().size(), 0);
+		m_neighborhoodVersion.assign(instance.neighborhoodCount(), 0);
+	}
+	bool enabled() const {
+		return m_mask != 0;
+	}
+	/*! Invalidates all entries, e.g. when switching to a different solution. */
+	void reset() {
+		// larger than any sum of counters bumped since the previous reset
+		m_epoch += (1ULL << 40);
+	}
+	/*! Records that a move has been committed. */
+	void update(const Move & move) {
+		if (enabled()) {
+			touch(move.p(), move.src(), move.dst());
+		}
+	}
+	/*! Records that an exchange has been committed. */
+	void update(const Exchange & exchange) {
+		if (enabled()) {
+			touch(exchange.p1(), exchange.m1(), exchange.m2());
+			touch(exchange.p2(), exchange.m2(), exchange.m1());
+		}
+	}
+	/*! Returns true if the move is feasible and, in that case, its objective. */
+	bool evaluate(const MoveVerifier & mv, const Move & move, const uint64_t xObj, uint64_t & obj) {
+		if (!enabled()) {
+			if (!mv.feasible(move)) {
+				return false;
+			}
+			obj = mv.objective(move);
+			return true;
+		}
+		const int64_t wsmc = instance().weightServiceMoveCost();
+		const uint64_t key = moveKey(move);
+		const uint64_t stamp = moveStamp(move);
+		Entry & entry = m_moves[slot(key) & m_mask];
+		if (entry.key == key && entry.stamp == stamp) {
+			++m_hits;
+			if (entry.feasible) {
+				obj = xObj + entry.delta + wsmc * mv.serviceMoveCostDiff(move);
+			}
+			return entry.feasible;
+		}
+		++m_misses;
+		entry.key = key;
+		entry.stamp = stamp;
+		entry.feasible = mv.feasible(move);
+		if (entry.feasible) {
+			obj = mv.objective(move);
+			entry.delta = static_cast<int64_t>(obj) - static_cast<int64_t>(xObj) - wsmc * mv.serviceMoveCostDiff(move);
+		}
+		return entry.feasible;
+	}
+	/*! Returns true if the exchange is feasible and, in that case, its objective. */
+	bool evaluate(const ExchangeVerifier & ev, const Exchange & exchange, const uint64_t xObj, uint64_t & obj) {
+		if (!enabled()) {
+			if (!ev.feasible(exchange)) {
+				return false;
+			}
+			obj = ev.objective(exchange);
+			return true;
+		}
+		const int64_t wsmc = instance().weightServiceMoveCost();
+		const uint64_t key = exchangeKey(exchange);
+		const uint64_t stamp = exchangeStamp(exchange);
+		Entry & entry = m_exchanges[slot(key) & m_mask];
+		if (entry.key == key && entry.stamp == stamp) {
+			++m_hits;
+			if (entry.feasible) {
+				obj = xObj + entry.delta + wsmc * ev.serviceMoveCostDiff(exchange);
+			}
+			return entry.feasible;
+		}
+		++m_misses;
+		entry.key = key;
+		entry.stamp = stamp;
+		entry.feasible = ev.feasible(exchange);
+		if (entry.feasible) {
+			obj = ev.objective(exchange);
+			entry.delta = static_cast<int64_t>(obj) - static_cast<int64_t>(xObj) - wsmc * ev.serviceMoveCostDiff(exchange);
+		}
+		return entry.feasible;
+	}
+	uint64_t hits() const {
+		return m_hits;
+	}
+	uint64_t misses() const {
+		return m_misses;
+	}
+};
+
+}
+
+#endif
@@ -37,6 +37,12 @@ public:
 	void commit(const Exchange & exchange);
 	/*! Computes the objective function for a single move. */
 	uint64_t objective(const Exchange & exchange) const;
+	/*! Computes the change of the (unweighted) service move cost caused by a single exchange. */
+	int64_t serviceMoveCostDiff(const Exchange & exchange) const {
+		m_costDiff.serviceMoveCostDiff() = 0;
+		computeDiffServiceMoveCost(exchange);
+		return m_costDiff.serviceMoveCostDiff();
+	}
 };
 
 }
@@ -7,6 +7,7 @@
 #include "solution_pool.h"
 #include "atomic_flag.h"
 #include "parameter_map.h"
+#include "task_runtime.h"
 #include <stdexcept>
 #include <map>
 #include <ctime>
@@ -22,7 +23,9 @@ private:
 	const AtomicFlag * m_flagPtr;
 	uint32_t m_seed;
 	ParameterMap m_params;
+	std::string m_config;
 	SolutionPool * m_poolPtr;
+	SolutionInfo * m_fromPtr;
 	bool m_completed;
 	bool m_error;
 	std::string m_errorMessage;
@@ -31,16 +34,38 @@ private:
 	double m_totalTime;
 	mutable bool m_interrupted;
 	pthread_t m_thread;
-	pthread_mutex_t m_completedMutex;
+	mutable pthread_mutex_t m_completedMutex;
 	pthread_cond_t m_completedCond;
 	bool m_runningAsync;
+	SolutionPool::SourceID m_source;
+	// set by suspend, read atomically by the heuristic thread
+	mutable uint32_t m_suspended;
+	mutable pthread_mutex_t m_suspendMutex;
+	mutable pthread_cond_t m_suspendCond;
 	static void * doRun(void * hPtr) {
-		static_cast<Heuristic *>(hPtr)->run();
+		// heuristics only run while holding one of the slots of the runtime
+		TaskRuntime::SlotGuard guard;
+		Heuristic * h = static_cast<Heuristic *>(hPtr);
+		SolutionPool::bindThreadSource(h->m_source);
+		if (h->m_fromPtr == 0) {
+			h->run();
+			return 0;
+		}
+		try {
+			h->runFromSolution(*h->m_fromPtr);
+			h->signalCompletion();
+		} catch (std::exception & e) {
+			h->signalError(e.what());
+		}
 		return 0;
 	}
 protected:
-	/*! Checks whether the heuristic should stop. */
+	/*! Checks whether the heuristic should stop, yielding to waiting heuristics when its time slice is over. */
 	bool interrupted() const {
+		TaskRuntime::instance().yieldSlot();
+		if (__atomic_load_n(&m_suspended, __ATOMIC_ACQUIRE) != 0) {
+			waitResume();
+		}
 		if (!m_interrupted) {
 			m_interrupted = flag().read();
 		}
@@ -50,15 +75,23 @@ protected:
 	void signalCompletion();
 	/*! Signals that the heuristic completed with an error. */
 	void signalError(const std::string & message);
+private:
+	/*! Blocks without holding a slot until the heuristic is resumed or the flag is set. */
+	void waitResume() const;
 public:
 	Heuristic() {
 		m_instancePtr = 0;
 		m_initialPtr = 0;
 		m_poolPtr = 0;
+		m_fromPtr = 0;
 		m_flagPtr = 0;
 		pthread_mutex_init(&m_completedMutex, 0);
 		pthread_cond_init(&m_completedCond, 0);
+		pthread_mutex_init(&m_suspendMutex, 0);
+		pthread_cond_init(&m_suspendCond, 0);
 		m_runningAsync = false;
+		m_source = SolutionPool::newSource();
+		m_suspended = 0;
 		m_interrupted = false;
 		m_completed = false;
 		m_error = false;
@@ -69,6 +102,8 @@ public:
 	virtual ~Heuristic() {
 		pthread_mutex_destroy(&m_completedMutex);
 		pthread_cond_destroy(&m_completedCond);
+		pthread_mutex_destroy(&m_suspendMutex);
+		pthread_cond_destroy(&m_suspendCond);
 	}
 private:
 	double timeDifference(const timespec & t2, const timespec & t1) const {
@@ -95,6 +130,10 @@ protected:
 	const ParameterMap & parameters() const {
 		return m_params;
 	}
+	/*! Returns the configuration string the parameters were read from. */
+	const std::string & config() const {
+		return m_config;
+	}
 	uint32_t seed() const {
 		return m_seed;
 	}
@@ -138,6 +177,8 @@ protected:
 public:
 	/*! Starts the heuristic in background, specifying the deadline before which the heuristic should terminate. */
 	void start(const timespec & deadline);
+	/*! Starts the heuristic in background from the given solution, which must outlive the execution, by calling runFromSolution. */
+	void start(const timespec & deadline, SolutionInfo & info);
 	/*! Waits for the heuristic to stop. */
 	void join();
 	/*! Returns either when the deadline is expired or when the heuristic has completed.
@@ -156,6 +197,19 @@ public:
 	virtual const std::vector<MachineID> & bestSolution() const = 0;
 	/*! After the heuristic has stopped, returns the objective value of the best solution found. */
 	virtual uint64_t bestObjective() const = 0;
+	/*! Returns true once the heuristic has signaled completion or an error. */
+	bool completed() const;
+	/*! Makes the heuristic release its slot and wait at its next check for interruption, until resumed or interrupted. */
+	void suspend();
+	/*! Lets a suspended heuristic continue. */
+	void resume();
+	bool suspended() const {
+		return __atomic_load_n(&m_suspended, __ATOMIC_ACQUIRE) != 0;
+	}
+	/*! Returns the source the pushes of the heuristic thread are counted for in the pool. */
+	SolutionPool::SourceID source() const {
+		return m_source;
+	}
 	/*! Returns true if an error occurred during the execution of the heuristic. */
 	bool error() const {
 		return m_error;
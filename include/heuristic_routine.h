@@ -5,6 +5,8 @@
 #include "problem.h"
 #include "atomic_flag.h"
 #include "parameter_map.h"
+#include "destination_sampler.h"
+#include <memory>
 #include <boost/cstdint.hpp>
 #include <boost/random.hpp>
 
@@ -16,6 +18,8 @@ private: // shared objects passed during initialization
 	const std::vector<MachineID> * m_initialPtr;
 	const AtomicFlag * m_flagPtr;
 	boost::mt19937 * m_rngPtr;
+private: // constructed during initialization
+	std::unique_ptr<DestinationSampler> m_dstSampler;
 private: // routine state
 	mutable bool m_interrupted;
 protected:
@@ -25,6 +29,10 @@ protected:
 	const std::vector<MachineID> & initial() const {
 		return *m_initialPtr;
 	}
+	/*! Returns the termination flag, to be read directly by code running on other threads. */
+	const AtomicFlag & flag() const {
+		return *m_flagPtr;
+	}
 	bool interrupted() const {
 		if (!m_interrupted) {
 			m_interrupted = m_flagPtr->read();
@@ -34,6 +42,10 @@ protected:
 	boost::mt19937 & rng() {
 		return *m_rngPtr;
 	}
+	/*! Returns the sampler for move destinations, selected with the dst parameter. */
+	DestinationSampler & dstSampler() {
+		return *m_dstSampler;
+	}
 public:
 	void init(const Problem & instance,
 			  const std::vector<MachineID> & initial,
@@ -45,6 +57,7 @@ public:
 		m_flagPtr = &flag;
 		m_interrupted = false;
 		m_rngPtr = &rng;
+		m_dstSampler.reset(makeDestinationSampler(instance, initial, parameters));
 		configure(parameters);
 	}
 protected:
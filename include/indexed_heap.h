@@ -0,0 +1,117 @@
+#ifndef R12_INDEXED_HEAP_H
+#define R12_INDEXED_HEAP_H
+
+#include "common.h"
+#include <vector>
+#include <limits>
+#include <boost/cstdint.hpp>
+
+namespace R12 {
+
+/*! Binary min-heap of the items 0..n-1 keyed by integers, with the position of every item
+	so that the key of any item can be changed or the item removed in O(log n). */
+class IndexedHeap {
+private:
+	static const uint32_t ABSENT = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> m_heap;
+	std::vector<uint32_t> m_position;
+	std::vector<uint64_t> m_key;
+private:
+	void place(const uint32_t pos, const uint32_t item) {
+		m_heap[pos] = item;
+		m_position[item] = pos;
+	}
+	void siftUp(uint32_t pos) {
+		const uint32_t item = m_heap[pos];
+		while (pos > 0) {
+			const uint32_t parent = (pos - 1) / 2;
+			if (m_key[m_heap[parent]] <= m_key[item]) {
+				break;
+			}
+			place(pos, m_heap[parent]);
+			pos = parent;
+		}
+		place(pos, item);
+	}
+	void siftDown(uint32_t pos) {
+		const uint32_t item = m_heap[pos];
+		const uint32_t size = m_heap.size();
+		while (true) {
+			uint32_t child = 2 * pos + 1;
+			if (child >= size) {
+				break;
+			}
+			if (child + 1 < size && m_key[m_heap[child + 1]] < m_key[m_heap[child]]) {
+				++child;
+			}
+			if (m_key[item] <= m_key[m_heap[child]]) {
+				break;
+			}
+			place(pos, m_heap[child]);
+			pos = child;
+		}
+		place(pos, item);
+	}
+public:
+	/*! Empties the heap, which can then hold the items below n. */
+	void reset(const uint32_t n) {
+		m_heap.clear();
+		m_position.assign(n, ABSENT);
+		m_key.resize(n);
+	}
+	bool empty() const {
+		return m_heap.empty();
+	}
+	uint32_t size() const {
+		return m_heap.size();
+	}
+	bool contains(const uint32_t item) const {
+		return m_position[item] != ABSENT;
+	}
+	/*! Returns the item with the smallest key. */
+	uint32_t top() const {
+		CHECK(!m_heap.empty());
+		return m_heap[0];
+	}
+	uint64_t key(const uint32_t item) const {
+		return m_key[item];
+	}
+	/*! Inserts the item or changes its key. */
+	void update(const uint32_t item, const uint64_t key) {
+		if (m_position[item] == ABSENT) {
+			m_key[item] = key;
+			m_heap.push_back(item);
+			siftUp(m_heap.size() - 1);
+		} else {
+			const uint64_t old = m_key[item];
+			m_key[item] = key;
+			if (key < old) {
+				siftUp(m_position[item]);
+			} else {
+				siftDown(m_position[item]);
+			}
+		}
+	}
+	/*! Removes the item if present. */
+	void remove(const uint32_t item) {
+		const uint32_t pos = m_position[item];
+		if (pos == ABSENT) {
+			return;
+		}
+		m_position[item] = ABSENT;
+		const uint32_t last = m_heap.back();
+		m_heap.pop_back();
+		if (pos < m_heap.size()) {
+			place(pos, last);
+			if (pos > 0 && m_key[last] < m_key[m_heap[(pos - 1) / 2]]) {
+				siftUp(pos);
+			} else {
+				siftDown(pos);
+			}
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef R12_ISLAND_MODEL_H
+#define R12_ISLAND_MODEL_H
+
+#include "common.h"
+#include "solution_pool.h"
+#include "parameter_map.h"
+#include <vector>
+#include <memory>
+#include <string>
+#include <pthread.h>
+#include <boost/cstdint.hpp>
+#include <boost/random.hpp>
+
+namespace R12 {
+
+/*! Replicas of a heuristic, each working with its own pool of elite solutions.
+	A migration thread periodically sends the best solutions of each island to its neighbors in the topology
+	and forwards the best solution of each island to the global pool.
+	Parameters: topology (ring, torus or random), interval between migrations in seconds, migrants sent to each neighbor,
+	elite and diverse sizes of the island pools. */
+class IslandModel {
+public:
+	enum Topology {
+		RING,
+		TORUS,
+		RANDOM
+	};
+private:
+	SolutionPool & m_global;
+	std::vector<std::unique_ptr<SolutionPool>> m_pools;
+	Topology m_topology;
+	double m_interval;
+	uint32_t m_migrants;
+	uint32_t m_rows;
+	uint32_t m_cols;
+	std::vector<SolutionPool::SourceID> m_sources;
+	std::vector<uint64_t> m_forwarded;
+	boost::mt19937 m_rng;
+	pthread_t m_thread;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond;
+	bool m_running;
+	bool m_stopEvent;
+	// statistics
+	uint64_t m_migrationCount;
+	uint64_t m_migrantCount;
+private:
+	IslandModel(const IslandModel &);
+	IslandModel & operator=(const IslandModel &);
+	static void * doMigrate(void * arg);
+	void loop();
+	void neighbors(const uint32_t island, std::vector<uint32_t> & result);
+	void migrate();
+	void forward();
+public:
+	IslandModel(SolutionPool & global, const uint32_t islands, const ParameterMap & parameters, const uint32_t seed,
+		ProcessCount hqMinBestDelta, double hdMaxBestObjRatio);
+	~IslandModel();
+	static Topology parseTopology(const std::string & name);
+	uint32_t islands() const {
+		return m_pools.size();
+	}
+	/*! Returns the pool of the given island, to be passed to the heuristic running on it. */
+	SolutionPool & pool(const uint32_t island) {
+		return *m_pools[island];
+	}
+	/*! Starts the migration thread. */
+	void start();
+	/*! Interrupts the subscribers of the island pools. */
+	void shutdown() {
+		for (uint32_t i = 0; i < m_pools.size(); ++i) {
+			m_pools[i]->shutdown();
+		}
+	}
+	/*! Stops the migration thread and forwards the best solution of each island to the global pool. */
+	void stop();
+	uint64_t migrationCount() const {
+		return m_migrationCount;
+	}
+	uint64_t migrantCount() const {
+		return m_migrantCount;
+	}
+};
+
+}
+
+#endif
@@ -2,9 +2,12 @@
 #define R12_LINEAR_SOLVER_H
 
 #include <vector>
+#include <memory>
+#include <string>
 #include <glpk.h>
 #include "common.h"
 #include "heuristic.h"
+#include "solution_info.h"
 #include "linear_solver_sub_problem.h"
 
 
@@ -12,34 +15,58 @@
 namespace R12
 {
 
+/*! Large neighborhood search: at every iteration a few processes are freed, all the others are fixed,
+	and the sub-problem is solved exactly as a mixed integer program with GLPK.
+	The free processes are those of a service, of a pair of machines or of a neighborhood.
+	Parameters: size (free processes per iteration), select (service, pair, neighborhood or mixed), time (seconds per iteration),
+	gap (relative MIP gap) and read_pool (restarts from the best solution of the pool when better). */
 class LinearSolver : public Heuristic {
-	
+
 public:
 	LinearSolver() {};
 	~LinearSolver() {};
 	void run();
-	const std::vector<MachineID>& bestSolution() const { return best_solution; }
-	uint64_t bestObjective() const { return best_objective; }
-	
+	void runFromSolution(SolutionInfo & info);
+	const std::vector<MachineID>& bestSolution() const { return m_best->solution(); }
+	uint64_t bestObjective() const { return m_best->objective(); }
+
 private:
+	enum Selection {
+		SERVICE,
+		PAIR,
+		NEIGHBORHOOD,
+		MIXED
+	};
+
+	static Selection parseSelection(const std::string & name);
+	void select(std::vector<ProcessID> & freeProcesses);
+	void selectService(std::vector<ProcessID> & freeProcesses);
+	void selectPair(std::vector<ProcessID> & freeProcesses);
+	void selectNeighborhood(std::vector<ProcessID> & freeProcesses);
+	void sample(std::vector<ProcessID> & candidates, std::vector<ProcessID> & freeProcesses);
+	void indexMachines();
 
-	ServiceID pickService();
-		
 	boost::random::taus88 randomizer;
 
-	
-	std::vector<MachineID> best_solution;
-	uint32_t best_objective;
+	std::unique_ptr<SolutionInfo> m_best;
+	// model kept between iterations
+	std::unique_ptr<LinearSolverSubProblem> m_subProblem;
+	// processes on each machine of the best solution
+	std::vector<std::vector<ProcessID>> m_processesByMachine;
+
+	// parameters
+	uint32_t m_size;
+	Selection m_selection;
+	double m_time;
+	double m_gap;
+	bool m_readPool;
 
 	uint32_t n_processes;
 	uint32_t n_machines;
-	uint32_t n_resources;
 	uint32_t n_services;
 	uint32_t n_neighborhoods;
-	uint32_t n_locations;
-	uint32_t n_balanceCosts;
 
-	
+
 };
 
 }
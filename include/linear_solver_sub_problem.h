@@ -2,52 +2,55 @@
 #define R12_LINEAR_PROBLEM_SUB_PROBLEM_H
 
 #include <glpk.h>
+#include <vector>
+#include <utility>
 #include "common.h"
-#include "heuristic.h"
-#include "verifier.h"
+#include "problem.h"
+#include "solution_info.h"
+#include "atomic_flag.h"
 
 
-#define LS_DEBUG 1
+//#define LS_DEBUG
 
 namespace R12
 {
 
+/*! Mixed integer program reassigning a small set of free processes while all the other processes stay on their machine.
+	The usage of the fixed processes is subtracted from the capacities and the objective of the program is the objective
+	of the whole solution: load and balance costs of every machine are modeled on top of the fixed usage, move costs
+	on top of the fixed moves, and the costs which do not depend on the free processes are a constant term.
+	The rows and the cost columns of the machines are built once and only their bounds are updated when the free processes
+	change; the assignment variables, created only for the machines where a free process fits, and the rows of the services
+	are rebuilt at every update, then the whole matrix is loaded at once from a list of triplets. */
 class LinearSolverSubProblem {
 
 	public:
-		LinearSolverSubProblem(const Problem & instance, const std::vector<MachineID> &initial, ServiceID & locked_service) {
-			m_instancePtr = &instance;
-			m_initial = initial;
-			m_freeProcesses = instance.processesByService(locked_service);
-			m_locked_servicePtr = &locked_service;
-			n_free_variables = m_freeProcesses.size();
-			CHECK(n_free_variables > 1);
-		};
-		void solve();
-
-		
+		LinearSolverSubProblem(const Problem & instance, const std::vector<MachineID> & initial);
+		~LinearSolverSubProblem();
+		/*! Frees the given processes of the current solution. */
+		void update(const SolutionInfo & current, const std::vector<ProcessID> & freeProcesses);
+		/*! Solves the program for at most timeLimit seconds, stopping early when the flag is set.
+			Returns true and the whole assignment when a feasible solution has been found. */
+		bool solve(const double timeLimit, const double mipGap, const AtomicFlag & flag, std::vector<MachineID> & solution);
+		/*! Returns the objective of the last solution found, as predicted by the program. */
+		double predictedObjective() const {
+			return predicted_objective;
+		}
+
 	private:
-		const Problem* m_instancePtr;
-		std::vector<MachineID> m_initial;
+		const Problem & m_instance;
+		const std::vector<MachineID> & m_initial;
+		const SolutionInfo * m_current;
 		std::vector<ProcessID> m_freeProcesses;
-		ServiceID* m_locked_servicePtr;
-		
-		const Problem & instance(){
-			return (*m_instancePtr);
+
+		const Problem & instance() const {
+			return m_instance;
 		}
 
-		const std::vector<MachineID> initial(){
+		const std::vector<MachineID> & initial() const {
 			return m_initial;
 		}
 
-		const std::vector<ProcessID> freeProcesses(){
-			return m_freeProcesses;
-		}
-		
-		ServiceID& lockedService(){
-			return (*m_locked_servicePtr);
-		}
-			
 		uint32_t n_free_variables;
 		uint32_t n_processes;
 		uint32_t n_machines;
@@ -57,42 +60,72 @@ class LinearSolverSubProblem {
 		uint32_t n_locations;
 		uint32_t n_balanceCosts;
 
-		std::vector<std::vector<uint32_t>> reduced_capacities;
+		// usage of the fixed processes; the transient usage also counts the free processes on their initial machine, where they count wherever they go
+		std::vector<std::vector<uint32_t>> fixed_usage;
+		std::vector<std::vector<uint32_t>> fixed_transient;
+		// free processes of each service, as indexes in the free processes
+		std::vector<std::vector<uint32_t>> free_by_service;
+		// machines where each free process fits, the first of its contiguous x_ij columns, and the variables on each machine
+		std::vector<std::vector<MachineID>> x_machines;
+		std::vector<uint32_t> x_first_col;
+		std::vector<std::vector<std::pair<uint32_t, uint32_t>>> x_by_machine;
+		// value at the current solution of the costs modeled by the program
+		double modeled_objective;
+		double predicted_objective;
 
-		uint32_t getMatrixIndexForVariable(uint32_t process, MachineID machine);
-		void getProcessesOfService(ServiceID service, std::vector<ProcessID> & processes);
-		void getMachinesOfLocations(LocationID location, std::vector<MachineID> & machines);
-		bool isFreeProcess(ProcessID process);
+		uint32_t capacityRow(MachineID machine, ResourceID resource) const;
+		uint32_t loadCostRow(MachineID machine, ResourceID resource) const;
+		uint32_t balanceCostRow(MachineID machine, uint32_t balanceCost) const;
+		uint32_t loadCostCol(MachineID machine, ResourceID resource) const;
+		uint32_t balanceCostCol(MachineID machine, uint32_t balanceCost) const;
+		uint32_t serviceMoveCostCol() const;
+		double capacityCoefficient(uint32_t process_index, MachineID machine, ResourceID resource) const;
 		void computeReducedCapacities();
+		// processes of a service which are not free on a machine, in a location or in a neighborhood
+		uint32_t fixedOnMachine(ServiceID service, MachineID machine) const;
+		uint32_t fixedInLocation(ServiceID service, LocationID location) const;
+		uint32_t fixedInNeighborhood(ServiceID service, NeighborhoodID neighborhood) const;
+		uint32_t fixedMoved(ServiceID service) const;
+
 
-		
 		// GLPK data
 		glp_prob *lp;
 		// solver parameters
 		glp_iocp param;
 
-		uint32_t last_used_row;
-		uint32_t last_used_col;
-		//uint32_t load_cost_col;
-		//uint32_t balance_cost_col;
+		// rows and columns of the machines, built once
+		uint32_t base_rows;
+		uint32_t base_cols;
+		std::vector<double> base_row_bounds;
+		// constraint matrix as triplets, index 0 unused as required by GLPK; the entries of the cost columns come first
+		std::vector<int> ia;
+		std::vector<int> ja;
+		std::vector<double> ar;
+		uint32_t base_entries;
+		// per machine scratch space, reused while building the rows of the services
+		std::vector<uint32_t> machine_rows;
 
-		void setSolverParameters();
+		void setSolverParameters(const double timeLimit, const double mipGap, const AtomicFlag & flag);
 		void initGLPK();
-		
+		void clearFreeProcesses();
+		void addEntry(uint32_t row, uint32_t col, double val);
+		uint32_t addRow(int type, double lb, double ub);
+		void setBaseRowBounds(uint32_t row, int type, double lb, double ub);
+		static void callback(glp_tree *tree, void *info);
+
 		// model creation
+		void addMachineRows();
+		void updateMachineBounds();
 		void addPlacementConstraints();
 		void addCapacityConstraints();
 		void addConflictConstraints();
 		void addLoadCostObjectiveFunction();
 		void addSpreadConstraints();
 		void addDependencyConstraints();
-		void addDependecyConstraintBetweenServices(ServiceID & service1, ServiceID & service2);
-		void addTransientUsageConstraints();
-		uint32_t addProcessMoveCost();
-		void addServiceMoveCost(uint32_t startColForProcessMove);
-		void addMachineMoveCost();
+		void addDependecyConstraintBetweenServices(ServiceID service1, ServiceID service2);
+		void addServiceMoveCost();
 		void addBalanceCost();
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -3,16 +3,64 @@
 
 #include "common.h"
 #include "solution_info.h"
+#include "move.h"
+#include "move_verifier.h"
+#include "task_runtime.h"
+#include <vector>
+#include <memory>
 
 namespace R12 {
 
+/*! Reduces the load cost of each resource by moving processes away from the machines above their safety capacity,
+	to the machines below it. The processes of every machine and the machines below their safety capacity are indexed and
+	kept up to date on commit; the candidate moves of each step are evaluated by up to threads workers of the task runtime,
+	each with its own verifier, and reduced so that the committed move does not depend on the number of workers. */
 class LoadCostOptimizer {
-	void optimizeResource(SolutionInfo & x, const ResourceID r) const;
+private:
+	struct Worker {
+		std::unique_ptr<MoveVerifier> mv;
+		uint64_t bestObj;
+		Move bestMove;
+		uint32_t bestIndex;
+		Worker() : bestObj(0), bestMove(0, 0, 0), bestIndex(0) {
+		}
+	};
+	class EvaluateBody : public ParallelBody {
+	private:
+		LoadCostOptimizer & m_optimizer;
+		const MachineID m_src;
+	public:
+		EvaluateBody(LoadCostOptimizer & optimizer, const MachineID src)
+		: m_optimizer(optimizer), m_src(src) {
+		}
+		virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) {
+			m_optimizer.evaluate(m_optimizer.m_workers[worker], m_src, begin, end);
+		}
+	};
+private:
+	uint32_t m_threads;
+	std::vector<Worker> m_workers;
+	// processes of each machine and position of each process in the list of its machine
+	std::vector<std::vector<ProcessID>> m_procByMachine;
+	std::vector<uint32_t> m_position;
+	// machines below their safety capacity for the current resource, with their positions
+	std::vector<MachineID> m_lowLoad;
+	std::vector<uint32_t> m_lowLoadPosition;
+private:
+	void index(SolutionInfo & x);
+	void addLowLoad(const MachineID m);
+	void removeLowLoad(const MachineID m);
+	void evaluate(Worker & worker, const MachineID src, const uint32_t begin, const uint32_t end);
+	bool bestMove(const SolutionInfo & x, const MachineID src, Move & move);
+	void commit(const Move & move);
+	void optimizeResource(SolutionInfo & x, const ResourceID r);
 	uint64_t evaluateLoadCost(const Machine & machine,
 							  const ResourceID r,
 							  const int64_t usage) const;
 public:
-	void optimize(SolutionInfo & x) const;
+	/*! Evaluates the candidate moves with at most threads workers, all the slots of the task runtime by default. */
+	explicit LoadCostOptimizer(const uint32_t threads = TaskRuntime::instance().threads());
+	void optimize(SolutionInfo & x);
 };
 
 }
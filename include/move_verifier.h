@@ -55,6 +55,12 @@ public:
 	/*! Computes the objective function for a single move. */
 	uint64_t objective(const Move & move) const { return computeObjective(move); }
 
+	/*! Computes the change of the (unweighted) service move cost caused by a single move. */
+	int64_t serviceMoveCostDiff(const Move & move) const {
+		computeDiffServiceMoveCost(move);
+		return DiffServiceMoveCost;
+	}
+
 };
 
 }
@@ -0,0 +1,96 @@
+#ifndef R12_OPERATOR_BANDIT_H
+#define R12_OPERATOR_BANDIT_H
+
+#include "common.h"
+#include <vector>
+#include <cmath>
+#include <boost/cstdint.hpp>
+
+namespace R12 {
+
+/*! Multi-armed bandit choosing among operators with the UCB1 rule.
+	The reward of an operator is its objective improvement per second, with exponential decay so that
+	the rates follow the search as it slows down; rates are normalized by the best one before adding the exploration term.
+	Every operator is played once before the rule applies. */
+class OperatorBandit {
+private:
+	struct Arm {
+		double gain;
+		double time;
+		uint64_t plays;
+		Arm() : gain(0.0), time(0.0), plays(0) {
+		}
+	};
+	std::vector<Arm> m_arms;
+	uint64_t m_plays;
+	double m_exploration;
+	double m_decay;
+public:
+	OperatorBandit()
+	: m_plays(0), m_exploration(0.5), m_decay(0.99) {
+	}
+	/*! Forgets all the statistics. */
+	void reset(const uint32_t arms, const double exploration, const double decay) {
+		m_arms.assign(arms, Arm());
+		m_plays = 0;
+		m_exploration = exploration;
+		m_decay = decay;
+	}
+	uint32_t size() const {
+		return m_arms.size();
+	}
+	uint64_t plays(const uint32_t arm) const {
+		return m_arms[arm].plays;
+	}
+	/*! Objective improvement per second of the arm. */
+	double rate(const uint32_t arm) const {
+		const Arm & a = m_arms[arm];
+		return a.time > 0.0 ? a.gain / a.time : 0.0;
+	}
+	/*! Rate of the arm relative to the rates of all the arms; uniform while nothing improved. */
+	double weight(const uint32_t arm) const {
+		double total = 0.0;
+		for (uint32_t i = 0; i < m_arms.size(); ++i) {
+			total += rate(i);
+		}
+		return total > 0.0 ? rate(arm) / total : 1.0 / m_arms.size();
+	}
+	uint32_t select() const {
+		CHECK(!m_arms.empty());
+		double maxRate = 0.0;
+		for (uint32_t i = 0; i < m_arms.size(); ++i) {
+			if (m_arms[i].plays == 0) {
+				return i;
+			}
+			maxRate = std::max(maxRate, rate(i));
+		}
+		const double logPlays = std::log(static_cast<double>(m_plays));
+		uint32_t best = 0;
+		double bestScore = -1.0;
+		for (uint32_t i = 0; i < m_arms.size(); ++i) {
+			const double exploitation = maxRate > 0.0 ? rate(i) / maxRate : 0.0;
+			const double score = exploitation + m_exploration * std::sqrt(2.0 * logPlays / m_arms[i].plays);
+			if (score > bestScore) {
+				bestScore = score;
+				best = i;
+			}
+		}
+		return best;
+	}
+	/*! Records that the arm improved the objective by gain in the given seconds. */
+	void update(const uint32_t arm, const double gain, const double seconds) {
+		for (uint32_t i = 0; i < m_arms.size(); ++i) {
+			m_arms[i].gain *= m_decay;
+			m_arms[i].time *= m_decay;
+		}
+		Arm & a = m_arms[arm];
+		a.gain += gain;
+		a.time += seconds;
+		++a.plays;
+		++m_plays;
+	}
+};
+
+}
+
+#endif
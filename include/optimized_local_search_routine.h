@@ -9,24 +9,53 @@
 #include "atomic_flag.h"
 #include "parameter_map.h"
 #include "local_search_routine.h"
+#include "sample_worker.h"
+#include "task_runtime.h"
 #include <vector>
 #include <boost/cstdint.hpp>
 #include <boost/random.hpp>
 
 namespace R12 {
 
+/*! Commits the best of a batch of improving moves and exchanges, drawn from blocks of random processes and machines.
+	With threads greater than one, the trials and samples of each iteration are split among workers of the task runtime.
+	Up to batch - 1 further samples are committed after the best one, provided that the machines, services and neighborhoods
+	they touch are disjoint from those of the samples already committed and that they still improve once re-evaluated. */
 class OptimizedLocalSearchRoutine : public LocalSearchRoutine {
 private:
 	typedef boost::random::uniform_smallint<uint8_t> MethodDist;
 	typedef boost::random::uniform_smallint<ProcessID> ProcessDist;
-	typedef boost::random::uniform_smallint<MachineID> MachineDist;
+	class CollectBody : public ParallelBody {
+	private:
+		OptimizedLocalSearchRoutine & m_routine;
+		const SolutionInfo & m_x;
+		const uint64_t & m_xObj;
+	public:
+		CollectBody(OptimizedLocalSearchRoutine & routine, const SolutionInfo & x, const uint64_t & xObj)
+		: m_routine(routine), m_x(x), m_xObj(xObj) {
+		}
+		virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) {
+			for (uint32_t w = begin; w < end; ++w) {
+				m_routine.collect(m_routine.m_workers[w], m_x, m_xObj);
+			}
+		}
+	};
 private: // constructed during initialization
 	ProcessDist m_pDist;
-	MachineDist m_mDist;
+	std::vector<SampleWorker> m_workers;
+private: // batch commit state
+	std::vector<SampleWorker::Candidate> m_candidates;
+	std::vector<uint32_t> m_machineStamp;
+	std::vector<uint32_t> m_serviceStamp;
+	std::vector<uint32_t> m_neighborhoodStamp;
+	uint32_t m_stamp;
 private: // parameters
 	uint64_t m_maxTrials;
 	uint64_t m_maxSamples;
 	uint64_t m_block;
+	uint32_t m_threads;
+	uint32_t m_batch;
+	double m_batchGain;
 private: // statistics
 	uint64_t m_moveFeasibleEvalCount;
 	uint64_t m_moveObjectiveEvalCount;
@@ -36,6 +65,10 @@ private: // statistics
 	uint64_t m_exchangeCommitCount;
 private:
 	uint64_t defaultMaxTrials();
+	void collect(SampleWorker & worker, const SolutionInfo & x, const uint64_t xObj);
+	bool claim(const ProcessID p, const MachineID src, const MachineID dst, const bool mark);
+	bool claim(const SampleWorker::Candidate & candidate, const bool mark);
+	uint32_t commitBatch(MoveVerifier & mv, ExchangeVerifier & ev, const SolutionInfo & x, uint64_t & xObj);
 public:
 	virtual void configure(const ParameterMap & parameters);
 	virtual void search(SolutionInfo & x);
@@ -0,0 +1,98 @@
+#ifndef R12_PARALLEL_TEMPERING_H
+#define R12_PARALLEL_TEMPERING_H
+
+#include "common.h"
+#include "heuristic.h"
+#include "problem.h"
+#include "solution_info.h"
+#include "move_verifier.h"
+#include "exchange_verifier.h"
+#include "task_runtime.h"
+#include <vector>
+#include <memory>
+#include <boost/cstdint.hpp>
+#include <boost/random.hpp>
+
+//#define TRACE_PT
+
+namespace R12 {
+
+/*! Replica exchange annealing: chains at geometrically spaced temperatures run Metropolis moves and exchanges in parallel,
+	and after every sweep neighboring temperatures try to swap their chains with the Metropolis criterion.
+	Parameters: replicas, min_t and max_t (estimated from sampled deltas when missing, within calib_samples and calib_time),
+	steps per sweep, i_prob and min_prob (probability of a move instead of an exchange at the hottest and coldest levels),
+	read_pool, threads and stats (prints the acceptance rates of the levels and of the swaps at the end). */
+class ParallelTempering : public Heuristic {
+private:
+	typedef boost::random::uniform_int_distribution<ProcessID> ProcessDist;
+	typedef boost::random::uniform_int_distribution<MachineID> MachineDist;
+	/*! A replica: a solution with its verifiers and generator. */
+	struct Chain {
+		std::unique_ptr<SolutionInfo> x;
+		std::unique_ptr<MoveVerifier> mv;
+		std::unique_ptr<ExchangeVerifier> ev;
+		boost::mt19937 rng;
+		// best solution met during the current sweep, if better than the best known when it started
+		uint64_t bestObj;
+		std::vector<MachineID> best;
+	};
+	/*! Runs the steps of a sweep for a range of temperature levels. */
+	class SweepBody : public ParallelBody {
+	private:
+		ParallelTempering & m_pt;
+	public:
+		SweepBody(ParallelTempering & pt) : m_pt(pt) {
+		}
+		virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) {
+			for (uint32_t level = begin; level < end; ++level) {
+				m_pt.sweep(level);
+			}
+		}
+	};
+private:
+	std::vector<Chain> m_chains;
+	// chain at each level, coldest first, with the temperature and the probability of a move
+	std::vector<uint32_t> m_order;
+	std::vector<double> m_temperatures;
+	std::vector<double> m_moveProb;
+	ProcessDist m_pDist;
+	MachineDist m_mDist;
+	boost::mt19937 m_rng;
+	std::unique_ptr<SolutionInfo> m_best;
+private: // parameters
+	uint32_t m_replicas;
+	uint64_t m_steps;
+	uint32_t m_threads;
+	bool m_readPool;
+	bool m_stats;
+private: // statistics, per level and per pair of neighboring levels
+	std::vector<uint64_t> m_proposed;
+	std::vector<uint64_t> m_accepted;
+	std::vector<uint64_t> m_swapsProposed;
+	std::vector<uint64_t> m_swapsAccepted;
+private:
+	void sweep(const uint32_t level);
+	void swap(const uint64_t round);
+	void printStats() const;
+public:
+	virtual void run();
+	virtual void runFromSolution(SolutionInfo & info);
+	virtual const std::vector<MachineID> & bestSolution() const {
+		return m_best->solution();
+	}
+	virtual uint64_t bestObjective() const {
+		return m_best->objective();
+	}
+	/*! Returns the fraction of accepted moves and exchanges at a level, coldest first. */
+	double acceptanceRate(const uint32_t level) const {
+		return m_proposed[level] > 0 ? static_cast<double>(m_accepted[level]) / m_proposed[level] : 0.0;
+	}
+	/*! Returns the fraction of accepted swaps between a level and the next one. */
+	double swapRate(const uint32_t level) const {
+		return m_swapsProposed[level] > 0 ? static_cast<double>(m_swapsAccepted[level]) / m_swapsProposed[level] : 0.0;
+	}
+};
+
+}
+
+#endif
@@ -6,15 +6,32 @@
 #include "move.h"
 #include "solution_pool.h"
 #include "solution_info.h"
+#include "move_verifier.h"
+#include "indexed_heap.h"
 #include <vector>
-#include <list>
 
 namespace R12 {
 
+/*! Relinks every solution notified by the pool with a random high quality solution: starting from the better of the two,
+	the process whose move towards the other solution gives the lowest objective is moved at every step,
+	and the best solution met along the path is improved with a best improvement local search.
+	The objectives of the candidate moves are kept in an indexed heap, and after a step only the candidates sharing a machine
+	or a related service with the moved process are evaluated again. When notifications arrive faster than relinking proceeds,
+	only the best pending one is relinked.
+	Parameters: depth (maximum steps of a relinking, 0 for no limit) and the ls group for the local search. */
 class PathRelinking : public Heuristic {
 private:
 	uint64_t m_bestObjective;
 	std::vector<MachineID> m_bestSolution;
+	uint32_t m_lsThreads;
+	uint32_t m_depth;
+	// candidate moves of the current relinking
+	IndexedHeap m_heap;
+	// differing processes with a candidate move from or to each machine
+	std::vector<std::vector<ProcessID>> m_byMachine;
+	// stamp of the last evaluation of each process
+	std::vector<uint64_t> m_evaluated;
+	uint64_t m_stamp;
 public:
 	virtual void run();
 	virtual uint64_t bestObjective() const {
@@ -24,7 +41,8 @@ public:
 		return m_bestSolution;
 	}
 private:
-	bool step(SolutionInfo & info1, const SolutionInfo & v2, std::list<ProcessID> & differences);
+	void evaluate(const MoveVerifier & mv, const std::vector<MachineID> & target, const ProcessID p);
+	void evaluateAll(const MoveVerifier & mv, const std::vector<MachineID> & target, const std::vector<ProcessID> & processes);
 	void relink(const SolutionPool::Entry s1, const SolutionPool::Entry s2);
 };
 
@@ -19,10 +19,8 @@ class RandomLocalSearchRoutine : public LocalSearchRoutine {
 private:
 	typedef boost::random::uniform_smallint<uint8_t> MethodDist;
 	typedef boost::random::uniform_smallint<ProcessID> ProcessDist;
-	typedef boost::random::uniform_smallint<MachineID> MachineDist;
 private: // constructed during initialization
 	ProcessDist m_pDist;
-	MachineDist m_mDist;
 private: // parameters
 	uint64_t m_maxTrials;
 private: // statistics
@@ -0,0 +1,122 @@
+#ifndef R12_REQUIREMENT_BUCKETS_H
+#define R12_REQUIREMENT_BUCKETS_H
+
+#include "common.h"
+#include "problem.h"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <boost/random.hpp>
+
+namespace R12 {
+
+/*! Groups processes with similar requirement profiles, so that exchange partners can be drawn among similar-sized processes.
+	The signature of a process quantizes, on a logarithmic scale, its requirement of each resource relative to the largest requirement of that resource. */
+class RequirementBuckets {
+private:
+	class SizeCompare {
+	private:
+		const std::vector<double> & m_size;
+	public:
+		SizeCompare(const std::vector<double> & size) : m_size(size) {
+		}
+		bool operator()(const ProcessID p1, const ProcessID p2) const {
+			return m_size[p1] < m_size[p2];
+		}
+	};
+private:
+	std::vector<std::vector<ProcessID>> m_buckets;
+	std::vector<uint32_t> m_bucketOf;
+	// processes sorted by total normalized size, used for singleton buckets
+	std::vector<ProcessID> m_bySize;
+	std::vector<ProcessCount> m_rank;
+	ProcessCount m_window;
+public:
+	RequirementBuckets(const Problem & instance, const uint32_t levels = 4, const ProcessCount window = 8) {
+		const ProcessCount pCount = instance.processes().size();
+		const ResourceCount rCount = instance.resources().size();
+		std::vector<double> maxReq(rCount, 0.0);
+		for (ProcessID p = 0; p < pCount; ++p) {
+			const Process & process = instance.processes()[p];
+			for (ResourceID r = 0; r < rCount; ++r) {
+				maxReq[r] = std::max(maxReq[r], static_cast<double>(process.requirement(r)));
+			}
+		}
+		std::map<std::vector<uint8_t>, uint32_t> index;
+		std::vector<uint8_t> signature(rCount);
+		std::vector<double> size(pCount, 0.0);
+		m_bucketOf.resize(pCount);
+		for (ProcessID p = 0; p < pCount; ++p) {
+			const Process & process = instance.processes()[p];
+			for (ResourceID r = 0; r < rCount; ++r) {
+				const double q = maxReq[r] > 0.0 ? process.requirement(r) / maxReq[r] : 0.0;
+				size[p] += q;
+				// level 0 for requirements below 2^-(levels-1) of the maximum, one more level per doubling
+				int level = 0;
+				if (q > 0.0) {
+					level = static_cast<int>(std::floor(std::log2(q))) + static_cast<int>(levels);
+				}
+				signature[r] = static_cast<uint8_t>(std::max(0, std::min(static_cast<int>(levels) - 1, level)));
+			}
+			auto itr = index.find(signature);
+			if (itr == index.end()) {
+				itr = index.insert(std::make_pair(signature, static_cast<uint32_t>(m_buckets.size()))).first;
+				m_buckets.push_back(std::vector<ProcessID>());
+			}
+			m_bucketOf[p] = itr->second;
+			m_buckets[itr->second].push_back(p);
+		}
+		m_bySize.resize(pCount);
+		for (ProcessID p = 0; p < pCount; ++p) {
+			m_bySize[p] = p;
+		}
+		std::sort(m_bySize.begin(), m_bySize.end(), SizeCompare(size));
+		m_rank.resize(pCount);
+		for (ProcessCount i = 0; i < pCount; ++i) {
+			m_rank[m_bySize[i]] = i;
+		}
+		m_window = std::max<ProcessCount>(1, std::min<ProcessCount>(window, pCount - 1));
+	}
+	uint32_t bucketCount() const {
+		return m_buckets.size();
+	}
+	const std::vector<ProcessID> & bucket(const ProcessID p) const {
+		return m_buckets[m_bucketOf[p]];
+	}
+	/*! Draws a process similar to p, different from p if the instance has more than one process. */
+	template<typename Engine> ProcessID partner(const ProcessID p, Engine & rng) const {
+		const std::vector<ProcessID> & b = bucket(p);
+		if (b.size() > 1) {
+			boost::random::uniform_int_distribution<uint32_t> dist(0, b.size() - 2);
+			// skip p itself without rejection
+			const ProcessID q = b[dist(rng)];
+			return q != p ? q : b.back();
+		}
+		// singleton bucket: pick among the closest processes by total size
+		const ProcessCount pCount = m_bySize.size();
+		if (pCount == 1) {
+			return p;
+		}
+		boost::random::uniform_int_distribution<int32_t> offsetDist(-m_window, m_window - 1);
+		int32_t offset = offsetDist(rng);
+		if (offset >= 0) {
+			++offset;
+		}
+		int32_t rank = static_cast<int32_t>(m_rank[p]) + offset;
+		if (rank < 0) {
+			rank = -rank;
+		} else if (rank >= static_cast<int32_t>(pCount)) {
+			rank = 2 * (static_cast<int32_t>(pCount) - 1) - rank;
+		}
+		rank = std::max(0, std::min(static_cast<int32_t>(pCount) - 1, rank));
+		if (rank == static_cast<int32_t>(m_rank[p])) {
+			rank = rank == 0 ? 1 : rank - 1;
+		}
+		return m_bySize[rank];
+	}
+};
+
+}
+
+#endif
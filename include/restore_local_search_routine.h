@@ -0,0 +1,52 @@
+#ifndef R12_RESTORE_LOCAL_SEARCH_ROUTINE_H
+#define R12_RESTORE_LOCAL_SEARCH_ROUTINE_H
+
+#include "common.h"
+#include "problem.h"
+#include "solution_info.h"
+#include "move.h"
+#include "exchange.h"
+#include "atomic_flag.h"
+#include "parameter_map.h"
+#include "local_search_routine.h"
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/random.hpp>
+
+namespace R12 {
+
+/*! Local search which tries to send moved processes back to their initial machine, either directly
+	or by exchanging them with a process currently on that machine. Moved processes are visited in
+	decreasing order of the process and machine move cost their return would save. */
+class RestoreLocalSearchRoutine : public LocalSearchRoutine {
+private:
+	class SavingCompare {
+	private:
+		const std::vector<uint64_t> & m_saving;
+	public:
+		SavingCompare(const std::vector<uint64_t> & saving) : m_saving(saving) {
+		}
+		bool operator()(const ProcessID p1, const ProcessID p2) const {
+			return m_saving[p1] > m_saving[p2];
+		}
+	};
+private: // parameters
+	uint32_t m_maxPasses;
+	uint32_t m_maxBlockers;
+private: // search state
+	std::vector<std::vector<ProcessID>> m_hosted;
+	std::vector<ProcessCount> m_slot;
+	std::vector<uint64_t> m_saving;
+	std::vector<ProcessID> m_order;
+private:
+	void buildHosted(const SolutionInfo & x);
+	void updateHosted(const ProcessID p, const MachineID src, const MachineID dst);
+	uint64_t saving(const SolutionInfo & x, const ProcessID p) const;
+public:
+	virtual void configure(const ParameterMap & parameters);
+	virtual void search(SolutionInfo & x);
+};
+
+}
+
+#endif
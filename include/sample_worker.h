@@ -0,0 +1,170 @@
+#ifndef R12_SAMPLE_WORKER_H
+#define R12_SAMPLE_WORKER_H
+
+#include "common.h"
+#include "problem.h"
+#include "solution_info.h"
+#include "move.h"
+#include "exchange.h"
+#include "move_verifier.h"
+#include "exchange_verifier.h"
+#include "evaluation_cache.h"
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <boost/random.hpp>
+
+namespace R12 {
+
+/*! State of one worker collecting improving samples for a sampling local search routine.
+	During the collection all workers read the same solution, each with its own verifiers, generator and evaluation cache;
+	the routine then reduces the best samples of the workers and commits the winner. */
+class SampleWorker {
+public:
+	/*! Improving move (method 0) or exchange (method 1) retained for batch commits. */
+	struct Candidate {
+		uint8_t method;
+		Move move;
+		Exchange exchange;
+		uint64_t obj;
+		Candidate() : method(0), move(0, 0, 0), exchange(0, 0, 0, 0), obj(0) {
+		}
+	};
+	/*! Orders candidates by objective: as a heap, the worst retained candidate is on top. */
+	struct CandidateCompare {
+		bool operator()(const Candidate & a, const Candidate & b) const {
+			return a.obj < b.obj;
+		}
+	};
+private:
+	boost::mt19937 m_ownRng;
+	boost::mt19937 * m_rng;
+	std::unique_ptr<MoveVerifier> m_mv;
+	std::unique_ptr<ExchangeVerifier> m_ev;
+public:
+	EvaluationCache cache;
+	// quota of the current iteration
+	uint64_t maxTrials;
+	uint64_t maxSamples;
+	// outcome of the current iteration
+	uint64_t trials;
+	uint64_t samples;
+	uint8_t bestMethod;
+	Move bestMove;
+	Exchange bestExchange;
+	uint64_t bestObj;
+	// best improving samples of the current iteration, at most keep of them
+	uint32_t keep;
+	std::vector<Candidate> candidates;
+	// statistics
+	uint64_t moveFeasibleEvalCount;
+	uint64_t moveObjectiveEvalCount;
+	uint64_t exchangeFeasibleEvalCount;
+	uint64_t exchangeObjectiveEvalCount;
+public:
+	SampleWorker()
+	: m_rng(&m_ownRng), maxTrials(0), maxSamples(0), trials(0), samples(0), bestMethod(0),
+	  bestMove(0, 0, 0), bestExchange(0, 0, 0, 0), bestObj(0), keep(0),
+	  moveFeasibleEvalCount(0), moveObjectiveEvalCount(0), exchangeFeasibleEvalCount(0), exchangeObjectiveEvalCount(0) {
+	}
+	/*! Binds the verifiers to the solution searched by the routine. */
+	void bind(SolutionInfo & x) {
+		m_mv.reset(new MoveVerifier(x));
+		m_ev.reset(new ExchangeVerifier(x));
+	}
+	/*! Uses the given generator, e.g. the one of the routine when there is a single worker. */
+	void useRng(boost::mt19937 & rng) {
+		m_rng = &rng;
+	}
+	/*! Uses a private generator with the given seed. */
+	void seed(const uint32_t seed) {
+		m_ownRng.seed(seed);
+		m_rng = &m_ownRng;
+	}
+	boost::mt19937 & rng() {
+		return *m_rng;
+	}
+	const MoveVerifier & mv() const {
+		return *m_mv;
+	}
+	const ExchangeVerifier & ev() const {
+		return *m_ev;
+	}
+	/*! Starts an iteration from a solution with the given objective. */
+	void start(const uint64_t xObj, const uint64_t trialQuota, const uint64_t sampleQuota) {
+		maxTrials = trialQuota;
+		maxSamples = sampleQuota;
+		trials = 0;
+		samples = 0;
+		bestObj = xObj;
+		candidates.clear();
+	}
+	bool done() const {
+		return trials >= maxTrials || samples >= maxSamples;
+	}
+	/*! Records an improving move. */
+	void offer(const Move & move, const uint64_t obj) {
+		++samples;
+		if (obj < bestObj) {
+			bestMethod = 0;
+			bestMove = move;
+			bestObj = obj;
+		}
+		if (keep > 0) {
+			Candidate candidate;
+			candidate.move = move;
+			candidate.obj = obj;
+			retain(candidate);
+		}
+	}
+	/*! Records an improving exchange. */
+	void offer(const Exchange & exchange, const uint64_t obj) {
+		++samples;
+		if (obj < bestObj) {
+			bestMethod = 1;
+			bestExchange = exchange;
+			bestObj = obj;
+		}
+		if (keep > 0) {
+			Candidate candidate;
+			candidate.method = 1;
+			candidate.exchange = exchange;
+			candidate.obj = obj;
+			retain(candidate);
+		}
+	}
+	/*! Keeps the candidate if it is among the best keep samples seen so far. */
+	void retain(const Candidate & candidate) {
+		if (candidates.size() < keep) {
+			candidates.push_back(candidate);
+			std::push_heap(candidates.begin(), candidates.end(), CandidateCompare());
+		} else if (candidate.obj < candidates.front().obj) {
+			std::pop_heap(candidates.begin(), candidates.end(), CandidateCompare());
+			candidates.back() = candidate;
+			std::push_heap(candidates.begin(), candidates.end(), CandidateCompare());
+		}
+	}
+	/*! Splits a total among the workers, the first ones getting the remainder. */
+	static uint64_t share(const uint64_t total, const uint32_t workers, const uint32_t w) {
+		return total / workers + (w < total % workers ? 1 : 0);
+	}
+	/*! Returns the index of the worker with the best sample, ties broken by worker index, and sums trials and samples. */
+	static uint32_t reduce(const std::vector<SampleWorker> & workers, uint64_t & trials, uint64_t & samples) {
+		uint32_t best = 0;
+		trials = 0;
+		samples = 0;
+		for (uint32_t w = 0; w < workers.size(); ++w) {
+			trials += workers[w].trials;
+			samples += workers[w].samples;
+			if (workers[w].samples > 0 && (workers[best].samples == 0 || workers[w].bestObj < workers[best].bestObj)) {
+				best = w;
+			}
+		}
+		return best;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef R12_SCHEDULER_H
+#define R12_SCHEDULER_H
+
+#include "common.h"
+#include "heuristic.h"
+#include "solution_pool.h"
+#include <vector>
+#include <pthread.h>
+#include <boost/cstdint.hpp>
+
+namespace R12 {
+
+/*! Shares the time of the task runtime among the heuristics of a portfolio according to their contributions.
+	A scheduling thread periodically measures how fast each heuristic decreases the best objective of its pool,
+	and suspends the heuristics far behind the most productive one: their slots go to the heuristics still running
+	and to the workers of their parallel loops. Suspended heuristics are resumed after a period which doubles
+	every time they are suspended again, since their contribution may depend on the solutions found by the others. */
+class Scheduler {
+private:
+	struct Record {
+		Heuristic * heuristic;
+		const SolutionPool * pool;
+		// improvement counted at the previous epoch and decayed improvement per second
+		uint64_t improvement;
+		double rate;
+		// times suspended, end of the current suspension and end of the probation after a resume, in seconds from the start
+		uint32_t suspensions;
+		double resumeAt;
+		double probationUntil;
+	};
+private:
+	std::vector<Record> m_records;
+	double m_timeLimit;
+	timespec m_startTime;
+	pthread_t m_thread;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond;
+	bool m_running;
+	bool m_stopEvent;
+	// statistics
+	uint64_t m_suspensionCount;
+private:
+	Scheduler(const Scheduler &);
+	Scheduler & operator=(const Scheduler &);
+	static void * doSchedule(void * arg);
+	void loop();
+	double elapsed() const;
+	void rebalance(const double epoch);
+public:
+	/*! Creates a scheduler for a portfolio running for timeLimit seconds. */
+	Scheduler(const double timeLimit);
+	~Scheduler();
+	/*! Adds a heuristic, whose contributions are measured on the pool it pushes to. */
+	void add(Heuristic & heuristic, const SolutionPool & pool);
+	/*! Starts the scheduling thread, after the heuristics have been started. */
+	void start();
+	/*! Stops the scheduling thread and resumes all the suspended heuristics. */
+	void stop();
+	uint64_t suspensionCount() const {
+		return m_suspensionCount;
+	}
+};
+
+}
+
+#endif
@@ -10,6 +10,8 @@
 #include "parameter_map.h"
 #include "local_search_routine.h"
 #include "problem_info.h"
+#include "sample_worker.h"
+#include "task_runtime.h"
 #include <vector>
 #include <memory>
 #include <boost/cstdint.hpp>
@@ -17,19 +19,39 @@
 
 namespace R12 {
 
+/*! Commits the best of a batch of improving moves and exchanges, scanning runs of consecutive processes and machines from random starting points.
+	With threads greater than one, the trials and samples of each iteration are split among workers of the task runtime. */
 class SequentialLocalSearchRoutine : public LocalSearchRoutine {
 private:
 	typedef boost::random::uniform_smallint<uint8_t> MethodDist;
 	typedef boost::random::uniform_smallint<ProcessID> ProcessDist;
 	typedef boost::random::uniform_smallint<MachineID> MachineDist;
+	class CollectBody : public ParallelBody {
+	private:
+		SequentialLocalSearchRoutine & m_routine;
+		const SolutionInfo & m_x;
+		const uint64_t & m_xObj;
+	public:
+		CollectBody(SequentialLocalSearchRoutine & routine, const SolutionInfo & x, const uint64_t & xObj)
+		: m_routine(routine), m_x(x), m_xObj(xObj) {
+		}
+		virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) {
+			for (uint32_t w = begin; w < end; ++w) {
+				m_routine.collect(m_routine.m_workers[w], m_x, m_xObj);
+			}
+		}
+	};
 private: // constructed during initialization
 	ProcessDist m_pDist;
 	MachineDist m_mDist;
+	std::vector<SampleWorker> m_workers;
 private: // parameters
 	uint64_t m_maxTrials;
 	uint64_t m_maxSamples;
+	uint32_t m_threads;
 private:
 	uint64_t defaultMaxTrials();
+	void collect(SampleWorker & worker, const SolutionInfo & x, const uint64_t xObj);
 public:
 	virtual void configure(const ParameterMap & parameters);
 	virtual void search(SolutionInfo & x);
@@ -6,6 +6,8 @@
 #include "problem.h"
 #include "move_verifier.h"
 #include "exchange_verifier.h"
+#include "SA_local_search_routine.h"
+#include "temperature_calibration.h"
 #include <boost/random.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
 #include <math.h>
@@ -24,6 +26,7 @@ class SimulatedAnnealing : public Heuristic
 private:
 
 	std::unique_ptr<SolutionInfo> m_bestSolution;
+	std::unique_ptr<SALocalSearchRoutine> SAls;
 
 	#ifdef TRACE_SA
 	uint64_t moveCount;
@@ -32,6 +35,9 @@ private:
 	boost::mt19937 m_rng;
 	ParameterMap SAlsParameters;
 	uint32_t iteration;
+	// inner loop statistics of all the runs
+	uint64_t m_iterations;
+	double m_searchSeconds;
 
 	#ifdef TRACE_SA
 	void printTemperature () { std::cout << "Temperature at iteration " << iteration << " equal to: " << Temperature << std::endl;}
@@ -42,6 +48,8 @@ private:
 	long double MaxTemperature;
 	long double ReduceParameterTemperature;
 	bool ReadPool;
+	uint64_t CalibrationSamples;
+	double CalibrationTime;
 	
 	inline void configure();
 	inline void initTemperature () { Temperature = MaxTemperature;}
@@ -60,6 +68,9 @@ public:
 	virtual void run();
 	virtual const std::vector<MachineID> & bestSolution() const { return m_bestSolution->solution(); }
 	virtual uint64_t bestObjective() const { return m_bestSolution->objective(); }
+	/*! Returns the moves and exchanges evaluated by the inner loop. */
+	uint64_t iterations() const { return m_iterations; }
+	double iterationsPerSecond() const { return m_searchSeconds > 0.0 ? m_iterations / m_searchSeconds : 0.0; }
 };
 
 }
@@ -9,6 +9,7 @@
 #include "atomic_flag.h"
 #include "parameter_map.h"
 #include "local_search_routine.h"
+#include "evaluation_cache.h"
 #include "problem_info.h"
 #include <vector>
 #include <memory>
@@ -25,6 +26,7 @@ private:
 private: // constructed during initialization
 	ProcessDist m_pDist;
 	MachineDist m_mDist;
+	EvaluationCache m_cache;
 	std::unique_ptr<ProblemInfo> m_problemInfo;
 private: // parameters
 	uint64_t m_maxTrials;
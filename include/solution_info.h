@@ -4,6 +4,7 @@
 #include "problem.h"
 #include <vector>
 #include <algorithm>
+#include <limits>
 #include <iostream>
 
 namespace R12 {
@@ -23,6 +24,8 @@ private:
 	std::vector<std::vector<ProcessCount>> m_locationPresence;
 	std::vector<std::vector<ProcessCount>> m_neighborhoodPresence;
 	std::vector<ProcessCount> m_movedProcesses;
+	std::vector<ProcessID> m_moved;
+	std::vector<ProcessCount> m_movedIndex;
 	std::vector<uint64_t> m_loadCosts;
 	std::vector<uint64_t> m_balanceCosts;
 	uint64_t m_processMoveCost;
@@ -32,6 +35,9 @@ private:
 	void initializeContainers();
 	void initialize();
 	void initializeSolutionDelta();
+	static ProcessCount notMoved() {
+		return std::numeric_limits<ProcessCount>::max();
+	}
 public:
 	void computeServiceMoveCost() {
 		m_serviceMoveCost = *std::max_element(m_movedProcesses.begin(), m_movedProcesses.end());
@@ -86,6 +92,22 @@ public:
 	void setNeighborhoodPresence(ServiceID s, NeighborhoodID n, ProcessCount value) {
 		m_neighborhoodPresence[s][n] = value;
 	}
+	/*! Updates the set of moved processes after process p has been assigned to a new machine. */
+	void updateMoved(ProcessID p) {
+		const bool moved = m_solution[p] != initial()[p];
+		const ProcessCount idx = m_movedIndex[p];
+		if (moved && idx == notMoved()) {
+			m_movedIndex[p] = m_moved.size();
+			m_moved.push_back(p);
+		} else if (!moved && idx != notMoved()) {
+			// swap with the last element
+			const ProcessID last = m_moved.back();
+			m_moved[idx] = last;
+			m_movedIndex[last] = idx;
+			m_moved.pop_back();
+			m_movedIndex[p] = notMoved();
+		}
+	}
 	/*! Sets the number of processes of service s moved from their original assignment. */
 	void setMovedProcesses(ServiceID s, ProcessCount value) {
 		m_movedProcesses[s] = value;
@@ -138,6 +160,18 @@ public:
 	ProcessCount neighborhoodPresence(ServiceID s, NeighborhoodID n) const {
 		return m_neighborhoodPresence[s][n];
 	}
+	/*! Returns the number of processes not on their initial machine. */
+	ProcessCount movedCount() const {
+		return m_moved.size();
+	}
+	/*! Returns the i-th process not on its initial machine, in no particular order. */
+	ProcessID moved(ProcessCount i) const {
+		return m_moved[i];
+	}
+	/*! Returns true if process p is not on its initial machine. */
+	bool isMoved(ProcessID p) const {
+		return m_movedIndex[p] != notMoved();
+	}
 	/*! Returns sthe number of processes of service s moved from their original assignment. */
 	ProcessCount movedProcesses(ServiceID s) const {
 		return m_movedProcesses[s];
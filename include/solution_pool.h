@@ -4,12 +4,16 @@
 #include "common.h"
 #include "solution_delta.h"
 #include <set>
+#include <algorithm>
+#include <map>
 #include <memory>
 #include <vector>
 #include <queue>
 #include <utility>
 #include <stdexcept>
 #include <iostream>
+#include <limits>
+#include <sched.h>
 #include <boost/version.hpp>
 #include <boost/random.hpp>
 #include <pthread.h>
@@ -115,6 +119,22 @@ public:
 		}
 	};
 	typedef std::shared_ptr<Subscription> SubscriptionPtr;
+	typedef uint32_t SourceID;
+private:
+	/*! Cell of the ingestion ring: free for the producer claiming position p when its sequence is p,
+		ready for the consumer when it is p + 1. */
+	struct Cell {
+		uint64_t sequence;
+		SourceID source;
+		uint64_t obj;
+		SolutionPtr ptr;
+	};
+	/*! Solution waiting for insertion. */
+	struct Pending {
+		SourceID source;
+		uint64_t obj;
+		SolutionPtr ptr;
+	};
 private:
 	uint32_t m_hqMinBestDelta;
 	double m_hdMaxBestObjRatio;
@@ -127,13 +147,156 @@ private:
 	mutable pthread_rwlock_t m_subscriptionLock;
 	std::vector<SubscriptionPtr> m_subscriptions;
 	mutable boost::taus88 m_gen;
+	// left-right publication of the best entry: push writes the inactive slot, waits for its readers to leave and then flips
+	// the active index, so that best never blocks behind push; the objective is published separately for polling
+	Entry m_bestSlots[2];
+	mutable uint32_t m_bestReaders[2];
+	uint32_t m_bestActive;
+	uint64_t m_bestObj;
+	// bounded multi-producer single-consumer ring of pushed solutions, drained by the pool thread
+	std::vector<Cell> m_ring;
+	uint64_t m_ringMask;
+	uint64_t m_enqueuePos;
+	uint64_t m_dequeuePos;
+	std::vector<Pending> m_batch;
+	pthread_t m_thread;
+	bool m_async;
+	pthread_mutex_t m_ingestMutex;
+	pthread_cond_t m_ingestCond;
+	uint32_t m_sleeping;
+	bool m_stopEvent;
+	// pushes dropped because a later push of the same source was at least as good
+	uint64_t m_coalescedCount;
+	// total decrease of the best objective due to each source, protected by the lock
+	std::map<SourceID, uint64_t> m_improvements;
 private:
-	Entry makeEntry(uint64_t obj, const std::vector<MachineID> & solution) {
-		SolutionPtr ptr(new std::vector<MachineID>(solution));
+	static SourceID & threadSourceSlot() {
+		static __thread SourceID source = 0;
+		return source;
+	}
+	/*! Identifies the calling thread, i.e. the heuristic running on it. */
+	static SourceID threadSource() {
+		SourceID & source = threadSourceSlot();
+		if (source == 0) {
+			source = newSource();
+		}
+		return source;
+	}
+	bool enqueue(const SourceID source, const uint64_t obj, const SolutionPtr & ptr) {
+		uint64_t pos = m_enqueuePos;
+		Cell * cell;
+		while (true) {
+			cell = &m_ring[pos & m_ringMask];
+			__sync_synchronize();
+			const int64_t diff = static_cast<int64_t>(cell->sequence - pos);
+			if (diff == 0) {
+				if (__sync_bool_compare_and_swap(&m_enqueuePos, pos, pos + 1)) {
+					break;
+				}
+				pos = m_enqueuePos;
+			} else if (diff < 0) {
+				// the ring is full
+				return false;
+			} else {
+				pos = m_enqueuePos;
+			}
+		}
+		cell->source = source;
+		cell->obj = obj;
+		cell->ptr = ptr;
+		__sync_synchronize();
+		cell->sequence = pos + 1;
+		// wake the pool thread if it went to sleep before seeing this cell
+		if (__sync_fetch_and_add(&m_sleeping, 0) != 0) {
+			pthread_mutex_lock(&m_ingestMutex);
+			pthread_cond_signal(&m_ingestCond);
+			pthread_mutex_unlock(&m_ingestMutex);
+		}
+		return true;
+	}
+	bool dequeue(Pending & pending) {
+		Cell & cell = m_ring[m_dequeuePos & m_ringMask];
+		__sync_synchronize();
+		if (cell.sequence != m_dequeuePos + 1) {
+			return false;
+		}
+		pending.source = cell.source;
+		pending.obj = cell.obj;
+		pending.ptr.swap(cell.ptr);
+		__sync_synchronize();
+		cell.sequence = m_dequeuePos + m_ring.size();
+		++m_dequeuePos;
+		return true;
+	}
+	/*! Inserts the drained solutions, skipping those beaten by a later push of the same heuristic. */
+	void ingest() {
+		pthread_rwlock_wrlock(&m_lock);
+		for (std::size_t i = 0; i < m_batch.size(); ++i) {
+			bool dominated = false;
+			for (std::size_t j = i + 1; j < m_batch.size() && !dominated; ++j) {
+				dominated = m_batch[j].source == m_batch[i].source && m_batch[j].obj <= m_batch[i].obj;
+			}
+			if (dominated) {
+				++m_coalescedCount;
+			} else {
+				push(makeEntry(m_batch[i].obj, m_batch[i].ptr), m_batch[i].source);
+			}
+		}
+		pthread_rwlock_unlock(&m_lock);
+		m_batch.clear();
+	}
+	static void * doIngest(void * arg) {
+		static_cast<SolutionPool*>(arg)->ingestLoop();
+		return 0;
+	}
+	void ingestLoop() {
+		while (true) {
+			Pending pending;
+			while (dequeue(pending)) {
+				m_batch.push_back(pending);
+			}
+			if (m_batch.size() > 0) {
+				ingest();
+				continue;
+			}
+			pthread_mutex_lock(&m_ingestMutex);
+			m_sleeping = 1;
+			__sync_synchronize();
+			// producers check the flag after publishing their cell: look again before sleeping
+			const bool empty = m_ring[m_dequeuePos & m_ringMask].sequence != m_dequeuePos + 1;
+			if (empty && m_stopEvent) {
+				m_sleeping = 0;
+				pthread_mutex_unlock(&m_ingestMutex);
+				break;
+			}
+			if (empty) {
+				pthread_cond_wait(&m_ingestCond, &m_ingestMutex);
+			}
+			m_sleeping = 0;
+			pthread_mutex_unlock(&m_ingestMutex);
+		}
+	}
+	void publishBest() {
+		const Entry & best = *m_hqEntries.begin();
+		if (m_bestObj != std::numeric_limits<uint64_t>::max() && best.ptr() == m_bestSlots[m_bestActive].ptr()) {
+			return;
+		}
+		const uint32_t next = 1 - m_bestActive;
+		// readers still on the inactive slot pinned it before the previous flip
+		while (__sync_fetch_and_add(&m_bestReaders[next], 0) > 0) {
+			sched_yield();
+		}
+		m_bestSlots[next] = best;
+		__sync_synchronize();
+		m_bestActive = next;
+		m_bestObj = best.obj();
+		__sync_synchronize();
+	}
+	Entry makeEntry(uint64_t obj, const SolutionPtr & ptr) {
 		if (m_hqEntries.size() == 0) {
 			return Entry(obj, 0, ptr);
 		} else {
-			return Entry(obj, delta(*(m_hqEntries.begin()->ptr()), solution), ptr);
+			return Entry(obj, delta(*(m_hqEntries.begin()->ptr()), *ptr), ptr);
 		}
 	}
 	bool pushHighQuality(const Entry & entry) {
@@ -182,11 +345,12 @@ private:
 		}
 		return isHighDiversity;
 	}
-	std::pair<bool,bool> push(const Entry & entry) {
+	std::pair<bool,bool> push(const Entry & entry, const SourceID source) {
 		bool isHighQuality = false;
 		bool isHighDiversity = false;
 		// if this is the new best
 		if (m_hqEntries.size() > 0 && entry.obj() < m_hqEntries.begin()->obj()) {
+			m_improvements[source] += m_hqEntries.begin()->obj() - entry.obj();
 			isHighQuality = true;
 			isHighDiversity = false;
 			std::vector<Entry> reinsertList;
@@ -220,10 +384,14 @@ private:
 			}
 			pthread_rwlock_unlock(&m_subscriptionLock);
 		}
+		if (isHighQuality) {
+			publishBest();
+		}
 		return std::pair<bool,bool>(isHighQuality, isHighDiversity);
 	}
 public:
-	SolutionPool(std::size_t maxHighQuality, std::size_t maxHighDiversity, ProcessCount hqMinBestDelta, double hdMaxBestObjRatio) {
+	/*! Creates an empty pool; the ingestion ring holds ringCapacity solutions, rounded up to a power of two. */
+	SolutionPool(std::size_t maxHighQuality, std::size_t maxHighDiversity, ProcessCount hqMinBestDelta, double hdMaxBestObjRatio, std::size_t ringCapacity = 64) {
 		int err;
 		err = pthread_rwlock_init(&m_lock, 0);
 		if (err != 0) {
@@ -238,20 +406,58 @@ public:
 		m_maxHighDiversity = maxHighDiversity;
 		m_hqMinBestDelta = hqMinBestDelta;
 		m_hdMaxBestObjRatio = hdMaxBestObjRatio;
+		m_bestReaders[0] = 0;
+		m_bestReaders[1] = 0;
+		m_bestActive = 0;
+		m_bestObj = std::numeric_limits<uint64_t>::max();
+		std::size_t capacity = 1;
+		while (capacity < ringCapacity) {
+			capacity *= 2;
+		}
+		m_ring.resize(capacity);
+		for (std::size_t i = 0; i < capacity; ++i) {
+			m_ring[i].sequence = i;
+		}
+		m_ringMask = capacity - 1;
+		m_enqueuePos = 0;
+		m_dequeuePos = 0;
+		m_async = false;
+		m_sleeping = 0;
+		m_stopEvent = false;
+		m_coalescedCount = 0;
+		pthread_mutex_init(&m_ingestMutex, 0);
+		pthread_cond_init(&m_ingestCond, 0);
 	}
 	~SolutionPool() {
+		stop();
+		pthread_cond_destroy(&m_ingestCond);
+		pthread_mutex_destroy(&m_ingestMutex);
 		pthread_rwlock_destroy(&m_lock);
 		pthread_rwlock_destroy(&m_subscriptionLock);
 	}
-	/*! Retrieves the best entry. Returns true on success. */
+	/*! Returns the objective of the best entry, or the maximum value when the pool is empty. Lock-free, meant for polling. */
+	uint64_t bestObjective() const {
+		__sync_synchronize();
+		return m_bestObj;
+	}
+	/*! Retrieves the best entry. Returns true on success. Lock-free: never waits for a concurrent push. */
 	bool best(Entry & entry) const {
-		pthread_rwlock_rdlock(&m_lock);
-		bool available = m_hqEntries.size() > 0;
-		if (available) {
-			entry = (*m_hqEntries.begin());
+		if (bestObjective() == std::numeric_limits<uint64_t>::max()) {
+			return false;
 		}
-		pthread_rwlock_unlock(&m_lock);
-		return available;
+		// pin the active slot, retrying if it was flipped in the meantime
+		uint32_t slot;
+		while (true) {
+			slot = m_bestActive;
+			__sync_fetch_and_add(&m_bestReaders[slot], 1);
+			if (slot == m_bestActive) {
+				break;
+			}
+			__sync_fetch_and_sub(&m_bestReaders[slot], 1);
+		}
+		entry = m_bestSlots[slot];
+		__sync_fetch_and_sub(&m_bestReaders[slot], 1);
+		return true;
 	}
 	/*! Retrieves the worst high-quality entry. Returns true on success. */
 	bool worst(Entry & entry) const {
@@ -291,12 +497,72 @@ public:
 		pthread_rwlock_unlock(&m_lock);
 		return available;
 	}
-	/*! Proposes a solution for insertion in the pool.
-	    The first element of the pair is true if the solution was added to the high-quality pool.
-	    The second element of the pair is true if the solution was added to the high-diversity pool. */
-	std::pair<bool,bool> push(uint64_t obj, const std::vector<MachineID> & solution) {
+	/*! Returns a source identifier distinct from those of all threads and of previous calls. */
+	static SourceID newSource() {
+		static SourceID nextSource = 0;
+		return __sync_add_and_fetch(&nextSource, 1);
+	}
+	/*! Starts the pool thread: from now on pushes are queued and inserted asynchronously. */
+	void start() {
+		if (m_async) {
+			return;
+		}
+		m_stopEvent = false;
+		int err = pthread_create(&m_thread, 0, &SolutionPool::doIngest, this);
+		if (err != 0) {
+			throw std::runtime_error("Unable to start the solution pool thread");
+		}
+		m_async = true;
+	}
+	/*! Inserts the queued solutions and stops the pool thread: from now on pushes are inserted synchronously. */
+	void stop() {
+		if (!m_async) {
+			return;
+		}
+		pthread_mutex_lock(&m_ingestMutex);
+		m_stopEvent = true;
+		pthread_cond_signal(&m_ingestCond);
+		pthread_mutex_unlock(&m_ingestMutex);
+		pthread_join(m_thread, 0);
+		m_async = false;
+		// solutions queued by pushes racing with the stop
+		Pending pending;
+		while (dequeue(pending)) {
+			m_batch.push_back(pending);
+		}
+		if (m_batch.size() > 0) {
+			ingest();
+		}
+	}
+	/*! Returns the number of pushes dropped because a later push of the same heuristic was at least as good. */
+	uint64_t coalescedCount() const {
+		return m_coalescedCount;
+	}
+	/*! Proposes a solution for insertion in the pool, on behalf of the heuristic running on the calling thread.
+		When the pool thread runs, the solution is queued and inserted later, after dropping it if the same heuristic
+		pushes a solution at least as good in the meantime; it is inserted synchronously if the ring is full. */
+	void push(uint64_t obj, const std::vector<MachineID> & solution) {
+		push(obj, solution, threadSource());
+	}
+	/*! Proposes a solution for insertion in the pool on behalf of the given source. */
+	void push(uint64_t obj, const std::vector<MachineID> & solution, const SourceID source) {
+		SolutionPtr ptr(new std::vector<MachineID>(solution));
+		if (m_async && enqueue(source, obj, ptr)) {
+			return;
+		}
 		pthread_rwlock_wrlock(&m_lock);
-		std::pair<bool,bool> result = push(makeEntry(obj, solution));
+		push(makeEntry(obj, ptr), source);
+		pthread_rwlock_unlock(&m_lock);
+	}
+	/*! Makes the pushes of the calling thread count on behalf of the given source. */
+	static void bindThreadSource(const SourceID source) {
+		threadSourceSlot() = source;
+	}
+	/*! Returns how much the pushes of the given source decreased the best objective so far. */
+	uint64_t improvement(const SourceID source) const {
+		pthread_rwlock_rdlock(&m_lock);
+		auto itr = m_improvements.find(source);
+		const uint64_t result = itr == m_improvements.end() ? 0 : itr->second;
 		pthread_rwlock_unlock(&m_lock);
 		return result;
 	}
@@ -311,7 +577,7 @@ public:
 	/*! Unsubscribe for notification of new solutions inserted in the pool. */
 	void unsubscribe(const SubscriptionPtr subPtr) {
 		pthread_rwlock_wrlock(&m_subscriptionLock);
-		std::remove(m_subscriptions.begin(), m_subscriptions.end(), subPtr);
+		m_subscriptions.erase(std::remove(m_subscriptions.begin(), m_subscriptions.end(), subPtr), m_subscriptions.end());
 		pthread_rwlock_unlock(&m_subscriptionLock);
 	}
 	/*! Interrupts all subscribers waiting for notification. */
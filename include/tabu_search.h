@@ -2,21 +2,30 @@
 #define R12_TABU_SEARCH_H
 
 #include <boost/random/taus88.hpp>
-#include <deque>
-#include <unordered_set>
+#include <memory>
 #include <vector>
 
 #include "common.h"
 #include "heuristic.h"
+#include "solution_info.h"
+#include "move_verifier.h"
 
 namespace R12
 {
 
+/*! Tabu search over single process moves. At every iteration a sample of random moves is evaluated and the best admissible one
+	is committed, even when it worsens the objective: a move is admissible when it is not tabu or when it leads to a new incumbent
+	(aspiration). Moving a process away from a machine forbids moving it back for a random tenure, stored as the iteration
+	until which the (process, machine) attribute is tabu; on large instances the attributes are hashed into a table of bounded size.
+	The incumbent is copied and pushed to the pool only when the search leaves it.
+	Parameters: samples (feasible moves evaluated per iteration), tenure (minimum tabu tenure, the maximum is 1.5 times as large)
+	and read_pool (restarts from the best solution of the pool when better). */
 class TabuSearch : public Heuristic {
 public:
 	TabuSearch() : best_objective(0) {}
 	~TabuSearch() {}
 	void run();
+	void runFromSolution(SolutionInfo & info);
 	const std::vector<MachineID>& bestSolution() const { return best_solution; }
 	uint64_t bestObjective() const { return best_objective; }
 private:
@@ -24,10 +33,18 @@ private:
 	uint64_t best_objective;
 
 	boost::random::taus88 randomizer;
-	std::unordered_set<ProcessID> tabu_processes;
-	std::deque<ProcessID> tabu_processes_order;
-	std::unordered_set<MachineID> tabu_machines;
-	std::deque<MachineID> tabu_machines_order;
+	std::unique_ptr<SolutionInfo> current;
+	std::unique_ptr<MoveVerifier> verifier;
+	// iteration until which each attribute is tabu
+	std::vector<uint64_t> tabu_until;
+	uint64_t tabu_mask;
+	bool tabu_hashed;
+	uint64_t iteration;
+
+	// parameters
+	uint32_t m_samples;
+	uint32_t m_tenure;
+	bool m_readPool;
 private:
 	TabuSearch(const TabuSearch&);
 	TabuSearch& operator=(const TabuSearch&);
@@ -35,10 +52,14 @@ private:
 	// XXX: don't call this methods before having initialized the
 	// randomizer with the seed
 	inline ProcessID pickProcess();
-	inline MachineID pickMachine();
+	inline MachineID pickDestination(MachineID src);
+	inline uint64_t attribute(ProcessID p, MachineID m) const;
+	void initTabu();
+	void clearTabu();
+	void restart(const std::vector<MachineID> & solution);
+	void saveIncumbent();
 };
 
 }
 
 #endif // R12_TABU_SEARCH_H
-
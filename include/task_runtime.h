@@ -0,0 +1,118 @@
+#ifndef R12_TASK_RUNTIME_H
+#define R12_TASK_RUNTIME_H
+
+#include "common.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <pthread.h>
+#include <ctime>
+#include <boost/cstdint.hpp>
+
+namespace R12 {
+
+/*! Body of a parallel loop: processes the indices in [begin, end) on behalf of the given worker. */
+class ParallelBody {
+public:
+	virtual void operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) = 0;
+	virtual ~ParallelBody() {
+	}
+};
+
+/*! Process-wide runtime sharing a fixed number of execution slots, normally one per core, among heuristics and their parallel loops.
+	Heuristics hold a slot while they run and hand it over at regular intervals when other heuristics are waiting for one.
+	Parallel loops are split into chunks: the calling thread claims chunks until none is left, while helper tickets are
+	pushed on per-worker deques, from which idle workers pop or steal them and, if a slot is free, join the loop. */
+class TaskRuntime {
+private:
+	struct LoopJob {
+		ParallelBody * body;
+		uint32_t count;
+		uint32_t chunk;
+		uint32_t workers;
+		// claimed indices, completed indices and joined workers, updated atomically
+		uint32_t next;
+		uint32_t done;
+		uint32_t joined;
+	};
+	typedef std::shared_ptr<LoopJob> JobPtr;
+	struct WorkerQueue {
+		pthread_mutex_t mutex;
+		std::deque<JobPtr> jobs;
+	};
+	struct WorkerArg {
+		TaskRuntime * runtime;
+		uint32_t worker;
+	};
+private:
+	uint32_t m_threads;
+	std::vector<pthread_t> m_handles;
+	std::vector<WorkerArg> m_args;
+	std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_workCond;
+	pthread_cond_t m_slotCond;
+	// tickets queued on the deques, protected by the mutex
+	uint32_t m_pending;
+	uint32_t m_nextQueue;
+	bool m_shutdown;
+	// slots are granted in ticket order, protected by the mutex
+	uint32_t m_freeSlots;
+	uint64_t m_nextTicket;
+	uint64_t m_serving;
+	// time a slot is kept before yielding to waiting heuristics
+	double m_quantum;
+private:
+	TaskRuntime();
+	TaskRuntime(const TaskRuntime &);
+	TaskRuntime & operator=(const TaskRuntime &);
+	static void * doWork(void * arg);
+	void work(const uint32_t worker);
+	bool popJob(const uint32_t worker, JobPtr & job);
+	void pushJob(const JobPtr & job);
+	static void runChunks(LoopJob & job, const uint32_t worker);
+	bool tryAcquireSlot();
+	void stopWorkers();
+public:
+	~TaskRuntime();
+	/*! Returns the runtime of the process. */
+	static TaskRuntime & instance();
+	/*! Starts the workers; threads is the number of slots, one slot is used when never called. */
+	void init(const uint32_t threads);
+	/*! Returns the number of execution slots. */
+	uint32_t threads() const {
+		return m_threads;
+	}
+	/*! Waits for an execution slot for the calling thread. */
+	void acquireSlot();
+	/*! Releases the slot held by the calling thread. */
+	void releaseSlot();
+	/*! Hands over the slot of the calling thread if it has been held for a full quantum and other threads are waiting.
+		Cheap enough to be called at every iteration of a heuristic. */
+	void yieldSlot();
+	/*! Runs body over [0, count) with at most workers threads, the caller included, and returns when all indices have been processed.
+		Worker indices passed to the body are below workers. Chunks contain chunk indices, zero picks a few chunks per worker. */
+	void parallelFor(const uint32_t count, ParallelBody & body, const uint32_t workers, const uint32_t chunk = 0);
+	/*! Releases the slot of the calling thread for the lifetime of the object, e.g. around a blocking wait. */
+	class BlockingRegion {
+	private:
+		bool m_held;
+	public:
+		BlockingRegion();
+		~BlockingRegion();
+	};
+	/*! Holds a slot for the calling thread for the lifetime of the object. */
+	class SlotGuard {
+	public:
+		SlotGuard() {
+			TaskRuntime::instance().acquireSlot();
+		}
+		~SlotGuard() {
+			TaskRuntime::instance().releaseSlot();
+		}
+	};
+};
+
+}
+
+#endif
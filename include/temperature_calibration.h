@@ -0,0 +1,25 @@
+#ifndef R12_TEMPERATURE_CALIBRATION_H
+#define R12_TEMPERATURE_CALIBRATION_H
+
+#include "common.h"
+#include "solution_info.h"
+#include "atomic_flag.h"
+#include <boost/cstdint.hpp>
+#include <boost/random.hpp>
+
+namespace R12 {
+
+// Feasible samples and seconds used to calibrate the initial temperature
+const static uint64_t DefaultCalibrationSamples = 100000;
+const static double DefaultCalibrationTime = 1.0;
+// Trials per requested sample after which the calibration gives up, when almost no move is feasible
+const static uint64_t CalibrationTrialFactor = 100;
+
+/*! Returns the largest objective change among random feasible moves and exchanges of x, as the initial temperature of simulated annealing.
+	Sampling stops after the given feasible samples, after CalibrationTrialFactor trials per sample, after the given seconds
+	or when the flag is set. Returns the objective of x if no feasible sample is found. */
+uint64_t calibrateTemperature(SolutionInfo & x, boost::mt19937 & rng, const uint64_t samples, const double seconds, const AtomicFlag & flag);
+
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include "move.h"
 #include "exchange.h"
 #include "advisor.h"
+#include "requirement_buckets.h"
 #include <vector>
 #include <memory>
 #include <boost/cstdint.hpp>
@@ -25,9 +26,11 @@ private:
 	ProcessDist m_pDist;
 	MachineDist m_mDist;
 	std::unique_ptr<Advisor> m_advisor;
+	std::unique_ptr<RequirementBuckets> m_buckets;
 private: // options
 	bool m_useAdvisor;
 	bool m_useDynamicAdvisor;
+	bool m_useBuckets;
 	uint64_t m_kMin;
 	uint64_t m_kMax;
 	uint64_t m_maxTrialsLS;
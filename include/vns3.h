@@ -3,26 +3,46 @@
 
 #include "common.h"
 #include "heuristic.h"
+#include "local_search_routine.h"
+#include "shake_routine.h"
+#include "operator_bandit.h"
 #include "move.h"
 #include "exchange.h"
 #include <vector>
 #include <memory>
+#include <string>
 #include <boost/cstdint.hpp>
 #include <boost/random.hpp>
 
 namespace R12 {
 
+/*! Variable neighborhood search built from a shake routine and a local search routine.
+	The ls and shake parameters name a routine, a list of routines separated by slashes, or adaptive for all of them:
+	with more than one routine, each iteration picks the routines with a bandit rewarding the objective improvement per second
+	(parameters bandit_c for the exploration and bandit_decay for the memory), and the learned weights are printed at the end.
+	The lcopt and bcopt parameters repair the load and balance costs of the initial solution first, with opt_threads workers. */
 class VNS3 : public Heuristic {
 private:
 	std::unique_ptr<SolutionInfo> m_best;
 	std::unique_ptr<SolutionInfo> m_current;
 	boost::mt19937 m_rng;
+	std::vector<std::unique_ptr<LocalSearchRoutine>> m_ls;
+	std::vector<std::unique_ptr<ShakeRoutine>> m_shake;
+	std::vector<std::string> m_lsNames;
+	std::vector<std::string> m_shakeNames;
+	OperatorBandit m_lsBandit;
+	OperatorBandit m_shakeBandit;
 private: // parameters
 	uint64_t m_kMin;
 	uint64_t m_kMax;
 	uint64_t m_kStep;
+private:
+	void prepare();
+	void search();
+	void printWeights() const;
 public:
 	virtual void run();
+	virtual void runFromSolution(SolutionInfo & info);
 	virtual const std::vector<MachineID> & bestSolution() const {
 		return m_best->solution();
 	}
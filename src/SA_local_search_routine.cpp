@@ -1,5 +1,9 @@
 #include "SA_local_search_routine.h"
 #include "SA_constants.h"
+#include <cmath>
+#include <ctime>
+#include <limits>
+#include <algorithm>
 
 using namespace R12;
 
@@ -64,9 +68,30 @@ void SALocalSearchRoutine::configure(const ParameterMap & parameters) {
 	MinTemperature = parameters.param<long double>("min_t", MinTemp);
 	IProbMove = parameters.param<long double>("i_prob", InitProb);
 	MinProbMove = parameters.param<long double>("min_prob", MinProb);
+	m_cache.init(instance(), parameters.param<uint32_t>("cacheBits", 0));
+	m_fastRng.seed(static_cast<uint32_t>(rng()()));
+	m_thresholds.resize(ThresholdTableSize);
+	m_iterations = 0;
+	m_seconds = 0.0;
 }
 
 
+void SALocalSearchRoutine::commit(MoveVerifier & mverifier, ExchangeVerifier & exverifier, bool isMove, const Move & move, const Exchange & exmove)
+{
+	// cache hits skip the objective evaluation that fills the verifier diffs
+	if (isMove) {
+		if (m_cache.enabled())
+			mverifier.objective(move);
+		mverifier.commit(move);
+		m_cache.update(move);
+	} else {
+		if (m_cache.enabled())
+			exverifier.objective(exmove);
+		exverifier.commit(exmove);
+		m_cache.update(exmove);
+	}
+}
+
 long double SALocalSearchRoutine::Probability(long double MaxT, long double T)
 {
 	long double Prob = (IProbMove * (log(T) - log(MinTemperature))/(log(MaxT) - log(MinTemperature)));
@@ -75,79 +100,89 @@ long double SALocalSearchRoutine::Probability(long double MaxT, long double T)
 	return Prob;
 }
 
+void SALocalSearchRoutine::fillThresholds(double temperature)
+{
+	// a worsening delta d is accepted when d <= -T ln(u), and since d is integer the threshold can be floored
+	boost::random::uniform_01<double> uniform;
+	const double maxThreshold = static_cast<double>(std::numeric_limits<int64_t>::max() / 2);
+	for (uint32_t i = 0; i < ThresholdTableSize; ++i) {
+		double threshold = -temperature * std::log(1.0 - uniform(m_fastRng));
+		m_thresholds[i] = static_cast<int64_t>(std::floor(std::min(threshold, maxThreshold)));
+	}
+}
 
 void SALocalSearchRoutine::SA_search(SolutionInfo & info, uint64_t bestObjective, long double MaxT, long double T)
 {
 		enum Op { MoveOp, ExchangeOp };
 		ExchangeVerifier exverifier(info);
 		MoveVerifier mverifier(info);
-		SolutionInfo InitSolution(instance(),initial());
-		uint64_t InitObjective = InitSolution.objective();
-			
+
+		timespec startTime;
+		clock_gettime(CLOCK_MONOTONIC, &startTime);
+
 		BestMoveTemperature = -1;
 		bool feasible=false;
-		long double prob_move = IProbMove;
-
-		boost::uniform_01<boost::mt19937,long double> dist_delta(rng());
-		boost::uniform_01<boost::mt19937,long double> method(rng());
+		uint64_t evaluated = 0;
+		// the Metropolis test compares the worsening with a precomputed -T ln(u), so it is an integer compare
+		fillThresholds(static_cast<double>(T));
+		const double moveProbability = static_cast<double>(Probability(MaxT, T));
+		const ProcessCount pCount = instance().processes().size();
+		const MachineCount mCount = instance().machines().size();
+
+		boost::random::uniform_01<double> uniform;
 		Op op  = MoveOp;
 		Move move(0,0,0);
 		Exchange exmove(0,0,0,0);
 			
-		ProcessID p = m_pDist(rng());	
-		MachineID dst = m_mDist(rng());	
-		ProcessID p1 = m_pDist(rng());
+		ProcessID p = m_pDist(m_fastRng);
+		MachineID dst = m_mDist(m_fastRng);
+		ProcessID p1 = m_pDist(m_fastRng);
 		ProcessID p2;
 
 		do
 		{
-			p2 = m_pDist(rng());
+			p2 = m_pDist(m_fastRng);
 		} while (p1==p2);
 	
 		iteration = 0;
-		long double ActualProb = Probability(MaxT, T);
-
-		#ifdef TRACE_SALS
-		//std::cout << "Probability to make a move: " << ActualProb << std::endl;
-		#endif
 
 		while (!IterationEnd(iteration))
 		{
 			++iteration;
 			feasible = false;
-			prob_move = method();
+			const int64_t threshold = m_thresholds[m_fastRng() & (ThresholdTableSize - 1)];
 		
-			if(prob_move  < ActualProb )
+			if(uniform(m_fastRng) < moveProbability)
 			{
 				op = MoveOp;
-				p = (p+1)  % instance().processes().size();
+				if (++p == pCount) p = 0;
 				MachineID src = info.solution()[p];
 
 				do
 				{
-					dst = (dst+1)  % instance().machines().size();
+					if (++dst == mCount) dst = 0;
 				}
 				while(src==dst);
 		
 				move = Move(p,src,dst);
-				feasible = mverifier.feasible(move);		
+				feasible = m_cache.evaluate(mverifier, move, bestObjective, evaluated);
 			}
 			else
 			{		
 				op = ExchangeOp;		
 				
-				p1 = (p1 + 1)  % instance().processes().size();
+				if (++p1 == pCount) p1 = 0;
 				MachineID m1 = info.solution()[p1];
 				MachineID m2;
 				do
 				{
-					p2 = (p2 + 1) % instance().processes().size();
+					if (++p2 == pCount) p2 = 0;
 					m2 = info.solution()[p2];
 				}
 				while (m1==m2);
 
 				exmove = Exchange(m1,p1,m2,p2);
-				feasible = exverifier.feasible(exmove);
+				feasible = m_cache.evaluate(exverifier, exmove, bestObjective, evaluated);
 				
 			}
 
@@ -157,46 +192,26 @@ void SALocalSearchRoutine::SA_search(SolutionInfo & info, uint64_t bestObjective
 
 			if (feasible) 
 			{
-				int64_t new_objective;
-				if (op == MoveOp)
-					new_objective = mverifier.objective(move);
-				else
-					new_objective = exverifier.objective(exmove);
-
-				int64_t diffobjective = new_objective  - bestObjective;
+				int64_t diffobjective = static_cast<int64_t>(evaluated) - static_cast<int64_t>(bestObjective);
 				if (diffobjective < 0) 
 				{	
 					BestMoveTemperature = T;
-
-					bestObjective = new_objective;
-
-					if (op == MoveOp)
-						mverifier.commit(move);
-					else
-						exverifier.commit(exmove);
-			
+					bestObjective = evaluated;
+					commit(mverifier, exverifier, op == MoveOp, move, exmove);
 				}	
-				else
-				{	
-					
-					//if(new_objective<=InitObjective)
-					{
-						long double delta = dist_delta();
-						if(delta < exp(-(static_cast<long double>(diffobjective)/T)))
-						{
-							bestObjective = new_objective;
-							if (op == MoveOp)
-								mverifier.commit(move);
-							else
-								exverifier.commit(exmove);
-						}
-					}
+				else if (diffobjective <= threshold)
+				{
+					bestObjective = evaluated;
+					commit(mverifier, exverifier, op == MoveOp, move, exmove);
 				}
 				#ifdef CHECK_SALS
-				printCostFunctionError(new_objective,result);
+				printCostFunctionError(evaluated,result);
 				#endif
 			}
+		}// end process loop
 
-			
-		}// end process loop	
-}
\ No newline at end of file
+		timespec endTime;
+		clock_gettime(CLOCK_MONOTONIC, &endTime);
+		m_iterations += iteration;
+		m_seconds += static_cast<double>(endTime.tv_sec - startTime.tv_sec) + static_cast<double>(endTime.tv_nsec - startTime.tv_nsec) * 1e-9;
+}
@@ -3,6 +3,7 @@
 // standard library headers
 #include <string>
 #include <iostream>
+#include <unistd.h>
 // boost headers
 #include <boost/program_options.hpp>
 
@@ -43,6 +44,10 @@ bool Arguments::parse(int argc, char ** argv) {
 			"The program outputs the team identifier. The syntax \"-name\" is also recognized.")
 		("heuristic,h", program_options::value<string>(),
 			"The name of the heuristic algorithm.")
+		("threads", program_options::value<uint32_t>(),
+			"The number of threads shared by the heuristics. Defaults to the number of cores.")
+		("static-schedule",
+			"Runs every heuristic until the time limit, instead of suspending those which stopped improving the best solution.")
 		("analyze,a",
 			"Displays information about the problem and its solution, then exits.");
 	program_options::positional_options_description pdesc;
@@ -108,6 +113,15 @@ bool Arguments::parse(int argc, char ** argv) {
 		} else {
 			heuristicName = DEFAULT_HEURISTIC;
 		}
+
+		if (vm.count("threads") > 0) {
+			threads = vm["threads"].as<uint32_t>();
+		} else {
+			long cores = sysconf(_SC_NPROCESSORS_ONLN);
+			threads = cores > 0 ? static_cast<uint32_t>(cores) : 1;
+		}
+
+		staticSchedule = vm.count("static-schedule") > 0;
 	}
 
 	if (vm.count("problem-instance") > 0) {
@@ -1,6 +1,4 @@
 #include "balance_cost_optimizer.h"
-#include "move_verifier.h"
-#include "exchange_verifier.h"
 #include "vector_comparer.h"
 #include "pair_comparer.h"
 #include <vector>
@@ -11,15 +9,8 @@ using namespace R12;
 
 #define TRACE_BCOPT 1
 
-std::vector<ProcessID> listProcesses(const MachineID m, const std::vector<MachineID> & x) {
-	std::vector<ProcessID> processes;
-	for (ProcessID p = 0; p < x.size(); ++p) {
-		if (x[p] == m) {
-			processes.push_back(p);
-		}
-	}
-	return processes;
-}
+// below this number of candidate exchanges a step is evaluated by the calling thread alone
+#define BCOPT_MIN_PARALLEL_CANDIDATES 4096
 
 int64_t computeSignedBalanceCost(const BalanceCost & balance, const Machine & machine,
 								 const uint32_t u1, const uint32_t u2) {
@@ -29,8 +20,115 @@ int64_t computeSignedBalanceCost(const BalanceCost & balance, const Machine & ma
 	return cost;
 }
 
+BalanceCostOptimizer::BalanceCostOptimizer(const uint32_t threads)
+: m_threads(std::max(1u, std::min(threads, TaskRuntime::instance().threads()))), m_workers(m_threads) {
+}
+
+void BalanceCostOptimizer::index(SolutionInfo & x) {
+	const Problem & instance = x.instance();
+	const ProcessCount pCount = instance.processes().size();
+	const MachineCount mCount = instance.machines().size();
+	m_procByMachine.assign(mCount, std::vector<ProcessID>());
+	m_position.resize(pCount);
+	for (ProcessID p = 0; p < pCount; ++p) {
+		std::vector<ProcessID> & processes = m_procByMachine[x.solution()[p]];
+		m_position[p] = processes.size();
+		processes.push_back(p);
+	}
+	for (uint32_t w = 0; w < m_workers.size(); ++w) {
+		m_workers[w].ev.reset(new ExchangeVerifier(x));
+	}
+}
+
+void BalanceCostOptimizer::evaluate(Worker & worker, const Problem & instance, const BalanceCost & balance,
+									const MachineID m1, const uint32_t begin, const uint32_t end) {
+	const ResourceID r1 = balance.resource1();
+	const ResourceID r2 = balance.resource2();
+	const std::vector<ProcessID> & p_of_m1 = m_procByMachine[m1];
+	for (uint32_t j = begin; j < end; ++j) {
+		const MachineID m2 = m_negative[j];
+		const std::vector<ProcessID> & p_of_m2 = m_procByMachine[m2];
+		for (ProcessCount j1 = 0; j1 < p_of_m1.size(); ++j1) {
+			const ProcessID p1 = p_of_m1[j1];
+			const Process & process1 = instance.processes()[p1];
+			int64_t req11 = process1.requirement(r1);
+			int64_t req12 = process1.requirement(r2);
+			for (ProcessCount j2 = 0; j2 < p_of_m2.size(); ++j2) {
+				const ProcessID p2 = p_of_m2[j2];
+				const Process & process2 = instance.processes()[p2];
+				int64_t req21 = process2.requirement(r1);
+				int64_t req22 = process2.requirement(r2);
+				int64_t delta1 = req11 - req21;
+				int64_t delta2 = req12 - req22;
+				if (balance.target() * delta1 - delta2 < 0) {
+					// the exchange reduces the balance cost due to machine m1
+					Exchange exchange(m1, p1, m2, p2);
+					if (worker.ev->feasible(exchange)) {
+						uint64_t obj = worker.ev->objective(exchange);
+						if (obj < worker.bestObj) {
+							worker.bestObj = obj;
+							worker.bestExchange = exchange;
+							worker.bestIndex = j;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+bool BalanceCostOptimizer::bestExchange(const SolutionInfo & x, const BalanceCost & balance, const MachineID m1, Exchange & exchange) {
+	const uint32_t count = m_negative.size();
+	// processes per machine estimate the exchanges evaluated for each machine with a negative balance cost
+	const uint64_t perMachine = x.instance().processes().size() / x.instance().machines().size() + 1;
+	const uint64_t candidates = static_cast<uint64_t>(count) * m_procByMachine[m1].size() * perMachine;
+	const uint32_t workers = candidates < BCOPT_MIN_PARALLEL_CANDIDATES ? 1 : std::min(m_threads, count);
+	for (uint32_t w = 0; w < workers; ++w) {
+		m_workers[w].bestObj = x.objective();
+		m_workers[w].bestIndex = count;
+	}
+	if (workers == 1) {
+		evaluate(m_workers[0], x.instance(), balance, m1, 0, count);
+	} else {
+		EvaluateBody body(*this, x.instance(), balance, m1);
+		TaskRuntime::instance().parallelFor(count, body, workers);
+	}
+	// workers claim increasing indices: on ties the first candidate in machine order wins, as in a serial scan
+	const Worker * best = &m_workers[0];
+	for (uint32_t w = 1; w < workers; ++w) {
+		const Worker & worker = m_workers[w];
+		if (worker.bestObj < best->bestObj || (worker.bestObj == best->bestObj && worker.bestIndex < best->bestIndex)) {
+			best = &worker;
+		}
+	}
+	if (best->bestObj < x.objective()) {
+		exchange = best->bestExchange;
+		return true;
+	}
+	return false;
+}
+
+void BalanceCostOptimizer::relocate(const ProcessID p, const MachineID src, const MachineID dst) {
+	std::vector<ProcessID> & from = m_procByMachine[src];
+	const ProcessID last = from.back();
+	from[m_position[p]] = last;
+	m_position[last] = m_position[p];
+	from.pop_back();
+	std::vector<ProcessID> & to = m_procByMachine[dst];
+	m_position[p] = to.size();
+	to.push_back(p);
+}
+
+void BalanceCostOptimizer::commit(const Exchange & exchange) {
+	ExchangeVerifier & ev = *m_workers[0].ev;
+	ev.objective(exchange);
+	ev.commit(exchange);
+	relocate(exchange.p1(), exchange.m1(), exchange.m2());
+	relocate(exchange.p2(), exchange.m2(), exchange.m1());
+}
+
 void BalanceCostOptimizer::optimizeBalance(SolutionInfo & x,
-										   const BalanceCostID b) const {
+										   const BalanceCostID b) {
 	typedef std::pair<MachineID,int64_t> MBC;
 	const Problem & instance = x.instance();
 	const BalanceCost & balance = instance.balanceCosts()[b];
@@ -79,58 +177,21 @@ void BalanceCostOptimizer::optimizeBalance(SolutionInfo & x,
 	// We look for a pair of processes (p1,p2) such that:
 	// - p1 in P2 such that M(p1) in MP
 	// - p2 in P1 such that M(p2) in MN
-	ExchangeVerifier ev(x);
+	m_negative.clear();
+	for (MachineCount i2 = 0; i2 < sortedNegative.size(); ++i2) {
+		m_negative.push_back(sortedNegative[i2].first);
+	}
 	for (MachineCount i1 = 0; i1 < sortedPositive.size(); ++i1) {
 		const MachineID m1 = sortedPositive[i1].first;
 		const int64_t initialCost1 = sortedPositive[i1].second;
-		const Machine machine1 = x.instance().machines()[m1];
-		std::vector<ProcessID> p_of_m1 = listProcesses(m1, x.solution());
+		const Machine & machine1 = instance.machines()[m1];
 		int64_t cost1 = initialCost1;
-		while (cost1 > 0) {
-			uint64_t bestObj = x.objective();
-			Exchange bestExchange(0, 0, 0, 0);
-			for (MachineCount i2 = 0; i2 < sortedNegative.size(); ++i2) {
-				const MachineID m2 = sortedNegative[i2].first;
-				std::vector<ProcessID> p_of_m2 = listProcesses(m2, x.solution());
-				for (ProcessCount j1 = 0; j1 < p_of_m1.size(); ++j1) {
-					const ProcessID p1 = p_of_m1[j1];
-					const Process & process1 = x.instance().processes()[p1];
-					int64_t req11 = process1.requirement(r1);
-					int64_t req12 = process1.requirement(r2);
-					for (ProcessCount j2 = 0; j2 < p_of_m2.size(); ++j2) {
-						const ProcessID p2 = p_of_m2[j2];
-						const Process & process2 = x.instance().processes()[p2];
-						int64_t req21 = process2.requirement(r1);
-						int64_t req22 = process2.requirement(r2);
-						int64_t delta1 = req11 - req21;
-						int64_t delta2 = req12 - req22;
-						if (balance.target() * delta1 - delta2 < 0) {
-							// the exchange is feasible
-							// because it reduces the balance cost
-							// due to machine m1
-							Exchange exchange(m1, p1, m2, p2);
-							if (ev.feasible(exchange)) {
-								uint64_t obj = ev.objective(exchange);
-								if (obj < bestObj) {
-									bestObj = obj;
-									bestExchange = exchange;
-								}
-							}
-						}
-					}
-				}
-			}
-			if (bestObj < x.objective()) {
-				ev.objective(bestExchange);
-				ev.commit(bestExchange);
-				auto pItr = std::find(p_of_m1.begin(), p_of_m1.end(), bestExchange.p1());
-				p_of_m1.erase(pItr);
-				uint32_t u1 = x.usage(m1, r1);
-				uint32_t u2 = x.usage(m1, r2);
-				cost1 = computeSignedBalanceCost(balance, machine1, u1, u2);
-			} else {
-				break;
-			}
+		Exchange exchange(0, 0, 0, 0);
+		while (cost1 > 0 && bestExchange(x, balance, m1, exchange)) {
+			commit(exchange);
+			uint32_t u1 = x.usage(m1, r1);
+			uint32_t u2 = x.usage(m1, r2);
+			cost1 = computeSignedBalanceCost(balance, machine1, u1, u2);
 		}
 		#if TRACE_BCOPT >= 2
 		std::cout << "Signed balance cost " << b << " due to machine " << m1;
@@ -139,12 +200,13 @@ void BalanceCostOptimizer::optimizeBalance(SolutionInfo & x,
 	}
 }
 
-void BalanceCostOptimizer::optimize(SolutionInfo & x) const {
+void BalanceCostOptimizer::optimize(SolutionInfo & x) {
 	const Problem & instance = x.instance();
 	const BalanceCostCount bCount = instance.balanceCosts().size();
 	#if TRACE_BCOPT >= 1
 	writeCostComposition(x);
 	#endif
+	index(x);
 	std::vector<uint64_t> weightedBalanceCosts(bCount);
 	std::vector<BalanceCostID> sortedBalances(bCount);
 	for (BalanceCostID b = 0; b < bCount; ++b) {
@@ -23,6 +23,7 @@ void BatchVerifier::update(const Move & move) {
 	if (src != dst) {
 		// change solution and invalidate cache
 		info().solution()[p] = dst;
+		info().updateMoved(p);
 		m_feasibleCached = false;
 		m_objectiveCached = false;
 		// get dataa
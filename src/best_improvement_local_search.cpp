@@ -17,7 +17,7 @@ using namespace R12;
 #include "verifier.h"
 #endif
 
-#ifdef TRACE_BILS
+#if defined(TRACE_BILS) || defined(CHECK_BILS)
 #include <iostream>
 #endif
 
@@ -28,6 +28,56 @@ void BestImprovementLocalSearch::run() {
 	signalCompletion();
 }
 
+void BestImprovementLocalSearch::ScanBody::operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) {
+	const Problem & instance = m_ls.instance();
+	MoveVerifier & v = *m_verifiers[worker];
+	Candidate & candidate = m_candidates[worker];
+	#ifdef CHECK_BILS
+	Verifier verifier;
+	verifier.setExitOnFirstViolation(true);
+	#endif
+	for (ProcessID p = begin; p < end; ++p) {
+		MachineID src = m_info.solution()[p];
+		for (MachineID m = 0; m < instance.machines().size(); ++m) {
+			if (src != m) {
+				++candidate.moveCount;
+				Move move(p, src, m);
+				bool feasible = v.feasible(move);
+				#ifdef CHECK_BILS
+				std::vector<MachineID> newSolution = m_info.solution();
+				newSolution[p] = m;
+				Verifier::Result result = verifier.verify(instance, m_ls.initial(), newSolution);
+				if (feasible != result.feasible()) {
+					std::stringstream msg;
+					msg << "Best improvement local search - Wrong feasibility at move " << move;
+					std::cout << msg.str() << std::endl;
+					throw std::runtime_error(msg.str());
+				}
+				#endif
+				if (feasible) {
+					uint64_t objective = v.objective(move);
+					#ifdef CHECK_BILS
+					if (objective != result.objective()) {
+						std::stringstream msg;
+						msg << "Best improvement local search - Wrong objective at move " << move;
+						std::cout << msg.str() << std::endl;
+						throw std::runtime_error(msg.str());
+					}
+					#endif
+					if (candidate.better(move, objective)) {
+						candidate.move = move;
+						candidate.obj = objective;
+					}
+				}
+			}
+		} // end machine loop
+		// the flag is read directly, since interrupted() is not meant to be called concurrently
+		if (m_ls.flag().read()) {
+			break;
+		}
+	} // end process loop
+}
+
 void BestImprovementLocalSearch::runFromSolution(SolutionInfo & info) {
 	MoveVerifier v(info);
 	m_bestObjective = info.objective();
@@ -40,6 +90,16 @@ void BestImprovementLocalSearch::runFromSolution(SolutionInfo & info) {
 	}
 	
 	#endif
+	// each worker evaluates moves with its own verifier, the solution is only read during a scan
+	TaskRuntime & runtime = TaskRuntime::instance();
+	m_threads = param<uint32_t>("threads", runtime.threads());
+	const uint32_t workers = std::max(1u, std::min(m_threads, runtime.threads()));
+	std::vector<std::unique_ptr<MoveVerifier>> verifiers(workers);
+	for (uint32_t t = 0; t < workers; ++t) {
+		verifiers[t].reset(new MoveVerifier(info));
+	}
+	std::vector<Candidate> candidates(workers);
+	ScanBody body(*this, info, verifiers, candidates);
 	// start local search
 	bool continueLocalSearch = true;
 	uint32_t iteration = 0;
@@ -52,52 +112,27 @@ void BestImprovementLocalSearch::runFromSolution(SolutionInfo & info) {
 		}
 		#endif
 		continueLocalSearch = false;
-		Move topMove(0, 0, 0);
-		uint64_t topObj = m_bestObjective;
-		for (ProcessID p = 0; p < instance().processes().size(); ++p) {
-			MachineID src = info.solution()[p]; 
-			for (MachineID m = 0; m < instance().machines().size(); ++m) {
-				if (src != m) {
-					++moveCount;
-					Move move(p, src, m);
-					bool feasible = v.feasible(move);
-					#ifdef CHECK_BILS
-					std::vector<MachineID> newSolution = info.solution();
-					newSolution[p] = m;
-					Verifier::Result result = verifier.verify(instance(), initial(), newSolution);
-					if (feasible != result.feasible()) {
-						std::stringstream msg;
-						msg << "Best improvement local search - Wrong feasibility at iteration" << iteration << ", move " << moveCount;
-						std::cout << msg.str() << std::endl;
-						throw std::runtime_error(msg.str());
-					}
-					#endif
-					if (feasible) {
-						uint64_t objective = v.objective(move);
-						#ifdef CHECK_BILS
-						if (objective != result.objective()) {
-							std::stringstream msg;
-							msg << "Best improvement local search - Wrong objective at iteration " << iteration << ", move " << moveCount;
-							std::cout << msg.str() << std::endl;
-							throw std::runtime_error(msg.str());
-						}
-						#endif
-						if (objective < topObj) {
-							continueLocalSearch = true;
-							topMove = move;
-							topObj = objective;
-						}
-					}
-				}
-			} // end machine loop
-			if (interrupted()) {
-				break;
+		for (uint32_t t = 0; t < candidates.size(); ++t) {
+			candidates[t].move = Move(0, 0, 0);
+			candidates[t].obj = m_bestObjective;
+		}
+		runtime.parallelFor(instance().processes().size(), body, workers);
+		// reduce to the best move among workers
+		Candidate top;
+		top.obj = m_bestObjective;
+		for (uint32_t t = 0; t < candidates.size(); ++t) {
+			moveCount += candidates[t].moveCount;
+			candidates[t].moveCount = 0;
+			if (top.better(candidates[t].move, candidates[t].obj)) {
+				top.move = candidates[t].move;
+				top.obj = candidates[t].obj;
 			}
-		} // end process loop
-		// make the best move for this process
+		}
+		continueLocalSearch = top.obj < m_bestObjective;
+		// make the best move
 		if (continueLocalSearch) {
-			m_bestObjective = v.objective(topMove);
-			v.commit(topMove);
+			m_bestObjective = v.objective(top.move);
+			v.commit(top.move);
 			#ifdef CHECK_BILS
 			if (!info.check()) {
 				std::stringstream msg;
@@ -118,4 +153,3 @@ void BestImprovementLocalSearch::runFromSolution(SolutionInfo & info) {
 	std::cout << "Best improvement local search - " << iteration << " iterations and " << moveCount << " moves evalutated" << std::endl;
 	#endif
 }
-
@@ -0,0 +1,173 @@
+#include "compatibility.h"
+
+#include <algorithm>
+
+using namespace R12;
+
+namespace {
+
+// machines per block: the usable capacities of a block stay in cache while a block of processes is scanned
+const MachineCount machineBlock = 2048;
+const ProcessCount processBlock = 64;
+
+struct SharedEntry {
+	const Problem * instance;
+	const std::vector<MachineID> * initial;
+	std::weak_ptr<const Compatibility> comp;
+};
+
+pthread_mutex_t sharedMutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<SharedEntry> sharedEntries;
+
+}
+
+Compatibility::Compatibility(const Problem & instance, const std::vector<MachineID> & initial, const uint32_t threads)
+: m_instance(instance), m_initial(initial), m_threads(std::max(1u, threads)), m_compCount(0), m_countReady(0) {
+	const ProcessCount pCount = instance.processes().size();
+	const MachineCount mCount = instance.machines().size();
+	const ResourceCount rCount = instance.resources().size();
+	pthread_mutex_init(&m_mutex, 0);
+	m_comp.resize(pCount);
+	m_compReady.resize(pCount, 0);
+	// usable capacity is reduced by the initial usage of transient resources
+	m_usable.resize(rCount * mCount);
+	for (ResourceID r = 0; r < rCount; ++r) {
+		for (MachineID m = 0; m < mCount; ++m) {
+			m_usable[r * mCount + m] = instance.machines()[m].capacity(r);
+		}
+	}
+	const std::vector<ResourceID> & transient = instance.transientResources();
+	for (ProcessID p = 0; p < pCount; ++p) {
+		const Process & process = instance.processes()[p];
+		const MachineID m = initial[p];
+		for (auto itr = transient.begin(); itr != transient.end(); ++itr) {
+			const ResourceID r = *itr;
+			m_usable[r * mCount + m] -= process.requirement(r);
+		}
+	}
+}
+
+Compatibility::~Compatibility() {
+	pthread_mutex_destroy(&m_mutex);
+}
+
+std::shared_ptr<const Compatibility> Compatibility::shared(const Problem & instance, const std::vector<MachineID> & initial, const uint32_t threads) {
+	pthread_mutex_lock(&sharedMutex);
+	std::shared_ptr<const Compatibility> comp;
+	for (auto itr = sharedEntries.begin(); itr != sharedEntries.end(); ++itr) {
+		if (itr->instance == &instance && itr->initial == &initial) {
+			comp = itr->comp.lock();
+			if (!comp) {
+				comp.reset(new Compatibility(instance, initial, threads));
+				itr->comp = comp;
+			}
+			break;
+		}
+	}
+	if (!comp) {
+		comp.reset(new Compatibility(instance, initial, threads));
+		SharedEntry entry;
+		entry.instance = &instance;
+		entry.initial = &initial;
+		entry.comp = comp;
+		sharedEntries.push_back(entry);
+	}
+	pthread_mutex_unlock(&sharedMutex);
+	return comp;
+}
+
+void Compatibility::scanBlock(const ProcessID p, const MachineID mBegin, const MachineID mEnd, uint8_t * mask) const {
+	const MachineCount mCount = m_instance.machines().size();
+	const Process & process = m_instance.processes()[p];
+	const uint32_t n = mEnd - mBegin;
+	for (uint32_t i = 0; i < n; ++i) {
+		mask[i] = 1;
+	}
+	// branch-free inner loop over contiguous capacities, vectorized by the compiler
+	for (ResourceID r = 0; r < m_instance.resources().size(); ++r) {
+		const uint32_t req = process.requirement(r);
+		const uint32_t * usable = &m_usable[r * mCount + mBegin];
+		for (uint32_t i = 0; i < n; ++i) {
+			mask[i] &= static_cast<uint8_t>(req <= usable[i]);
+		}
+	}
+	const MachineID im = m_initial[p];
+	if (im >= mBegin && im < mEnd) {
+		mask[im - mBegin] = 1;
+	}
+}
+
+void Compatibility::countRange(const ProcessID pBegin, const ProcessID pEnd) const {
+	const MachineCount mCount = m_instance.machines().size();
+	std::vector<uint8_t> mask(machineBlock);
+	for (uint32_t pb = pBegin; pb < pEnd; pb += processBlock) {
+		const uint32_t pbEnd = std::min<uint32_t>(pEnd, pb + processBlock);
+		for (uint32_t p = pb; p < pbEnd; ++p) {
+			m_count[p] = 0;
+		}
+		for (uint32_t mb = 0; mb < mCount; mb += machineBlock) {
+			const uint32_t mbEnd = std::min<uint32_t>(mCount, mb + machineBlock);
+			for (uint32_t p = pb; p < pbEnd; ++p) {
+				scanBlock(p, mb, mbEnd, &mask[0]);
+				MachineCount count = 0;
+				for (uint32_t i = 0; i < mbEnd - mb; ++i) {
+					count += mask[i];
+				}
+				m_count[p] += count;
+			}
+		}
+	}
+}
+
+void Compatibility::CountBody::operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) {
+	// indices are process blocks
+	const ProcessCount pCount = m_comp.m_instance.processes().size();
+	m_comp.countRange(begin * processBlock, std::min<uint32_t>(pCount, end * processBlock));
+}
+
+void Compatibility::buildList(const ProcessID p) const {
+	const MachineCount mCount = m_instance.machines().size();
+	std::vector<MachineID> comp;
+	std::vector<uint8_t> mask(machineBlock);
+	for (uint32_t mb = 0; mb < mCount; mb += machineBlock) {
+		const uint32_t mbEnd = std::min<uint32_t>(mCount, mb + machineBlock);
+		scanBlock(p, mb, mbEnd, &mask[0]);
+		for (uint32_t i = 0; i < mbEnd - mb; ++i) {
+			if (mask[i]) {
+				comp.push_back(mb + i);
+			}
+		}
+	}
+	CHECK(comp.size() >= 1);
+	pthread_mutex_lock(&m_mutex);
+	if (!m_compReady[p]) {
+		m_comp[p].swap(comp);
+		__atomic_store_n(&m_compReady[p], 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void Compatibility::buildCounts() const {
+	pthread_mutex_lock(&m_mutex);
+	if (!m_countReady) {
+		const ProcessCount pCount = m_instance.processes().size();
+		m_count.resize(pCount);
+		// split process blocks among the workers of the runtime
+		CountBody body(*this);
+		const uint32_t blocks = (pCount + processBlock - 1) / processBlock;
+		TaskRuntime::instance().parallelFor(blocks, body, m_threads);
+		m_compCount = 0;
+		for (ProcessID p = 0; p < pCount; ++p) {
+			CHECK(m_count[p] >= 1);
+			m_compCount += m_count[p];
+		}
+		// processes sorted by compatibility
+		m_pByCompCount.resize(pCount);
+		for (ProcessID p = 0; p < pCount; ++p) {
+			m_pByCompCount[p] = p;
+		}
+		std::sort(m_pByCompCount.begin(), m_pByCompCount.end(), CompatibleCountCompare(m_count));
+		__atomic_store_n(&m_countReady, 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
@@ -0,0 +1,412 @@
+#include "decomposition.h"
+
+#include "heuristic_factory.h"
+#include "verifier.h"
+#include "task_runtime.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <ctime>
+#include <cmath>
+#include <iostream>
+
+//#define TRACE_DECOMPOSITION
+
+using namespace R12;
+
+namespace {
+
+// state of a service with respect to a cluster
+const uint8_t SERVICE_ABSENT = 0;
+const uint8_t SERVICE_FIXED = 1;
+const uint8_t SERVICE_FREE = 2;
+
+const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+}
+
+void Decomposition::run() {
+	try {
+		SolutionInfo start(instance(), initial());
+		runFromSolution(start);
+	} catch (std::exception & e) {
+		signalError(e.what());
+		return;
+	}
+	signalCompletion();
+}
+
+void Decomposition::runFromSolution(SolutionInfo & info) {
+	m_subName = param<std::string>("sub", "vns3");
+	m_clusters = std::max(1u, param<uint32_t>("clusters", TaskRuntime::instance().threads()));
+	m_roundTime = param<double>("round", 5.0);
+	m_rng.seed(seed());
+	m_best.reset(new SolutionInfo(info));
+	m_neighborhoods.clear();
+	for (NeighborhoodID n = 0; n < instance().neighborhoodCount(); ++n) {
+		m_neighborhoods.push_back(n);
+	}
+	#ifdef TRACE_DECOMPOSITION
+	uint32_t round = 0;
+	#endif
+	uint32_t idleRounds = 0;
+	while (!interrupted() && remaining() > 0) {
+		#ifdef TRACE_DECOMPOSITION
+		++round;
+		#endif
+		std::vector<std::vector<MachineID>> clusters;
+		partition(clusters);
+		std::vector<std::unique_ptr<SubProblem>> subs;
+		for (uint32_t c = 0; c < clusters.size(); ++c) {
+			std::unique_ptr<SubProblem> sub(new SubProblem);
+			if (build(c, clusters[c], *sub)) {
+				subs.push_back(std::move(sub));
+			}
+		}
+		// give up when no partition leaves processes free to move
+		if (subs.empty()) {
+			if (++idleRounds == 10) {
+				break;
+			}
+			continue;
+		}
+		idleRounds = 0;
+		solve(subs);
+		#ifdef TRACE_DECOMPOSITION
+		const uint64_t before = m_best->objective();
+		#endif
+		merge(subs);
+		#ifdef TRACE_DECOMPOSITION
+		std::cout << "Decomposition - Round " << round << ": " << subs.size() << " clusters, ";
+		std::cout << before << " -> " << m_best->objective() << std::endl;
+		#endif
+	}
+	info = *m_best;
+}
+
+void Decomposition::partition(std::vector<std::vector<MachineID>> & clusters) {
+	// a new random order of the neighborhoods at every round rotates the partition
+	for (uint32_t i = m_neighborhoods.size(); i > 1; --i) {
+		boost::random::uniform_int_distribution<uint32_t> dist(0, i - 1);
+		std::swap(m_neighborhoods[i - 1], m_neighborhoods[dist(m_rng)]);
+	}
+	const uint32_t count = std::min<uint32_t>(m_clusters, m_neighborhoods.size());
+	clusters.assign(count, std::vector<MachineID>());
+	m_machineCluster.assign(instance().machines().size(), NONE);
+	// each neighborhood goes to the cluster with fewer machines
+	for (auto itr = m_neighborhoods.begin(); itr != m_neighborhoods.end(); ++itr) {
+		uint32_t smallest = 0;
+		for (uint32_t c = 1; c < count; ++c) {
+			if (clusters[c].size() < clusters[smallest].size()) {
+				smallest = c;
+			}
+		}
+		const std::vector<MachineID> & machines = instance().machinesByNeighborhood(*itr);
+		for (auto m = machines.begin(); m != machines.end(); ++m) {
+			m_machineCluster[*m] = smallest;
+			clusters[smallest].push_back(*m);
+		}
+	}
+}
+
+bool Decomposition::build(const uint32_t cluster, const std::vector<MachineID> & machines, SubProblem & sub) {
+	const Problem & inst = instance();
+	const std::vector<MachineID> & x = m_best->solution();
+	const std::vector<MachineID> & x0 = initial();
+	const ResourceCount rCount = inst.resources().size();
+	const ServiceCount sCount = inst.services().size();
+	const ProcessCount pCount = inst.processes().size();
+	const Problem::DependencyGraph & dep = inst.dependency();
+	// services on the cluster are free unless some of their processes there come from another cluster
+	m_serviceFree.assign(sCount, SERVICE_ABSENT);
+	for (ProcessID p = 0; p < pCount; ++p) {
+		if (m_machineCluster[x[p]] == cluster) {
+			const ServiceID s = inst.processes()[p].service();
+			if (m_serviceFree[s] == SERVICE_ABSENT) {
+				m_serviceFree[s] = SERVICE_FREE;
+			}
+			if (m_machineCluster[x0[p]] != cluster) {
+				m_serviceFree[s] = SERVICE_FIXED;
+			}
+		}
+	}
+	// the spread must be met by the processes outside the cluster, or by those inside on their own
+	std::vector<uint32_t> spreadMin(sCount, 0);
+	std::vector<uint32_t> locationStamp(inst.locationCount(), NONE);
+	for (ServiceID s = 0; s < sCount; ++s) {
+		if (m_serviceFree[s] != SERVICE_FREE) {
+			continue;
+		}
+		const std::vector<ProcessID> & processes = inst.processesByService(s);
+		uint32_t outside = 0;
+		uint32_t inside = 0;
+		for (auto p = processes.begin(); p != processes.end(); ++p) {
+			const LocationID l = inst.machines()[x[*p]].location();
+			if (m_machineCluster[x[*p]] != cluster && locationStamp[l] != 2u * s) {
+				locationStamp[l] = 2u * s;
+				++outside;
+			}
+		}
+		for (auto p = processes.begin(); p != processes.end(); ++p) {
+			const LocationID l = inst.machines()[x[*p]].location();
+			if (m_machineCluster[x[*p]] == cluster && locationStamp[l] != 2u * s + 1) {
+				locationStamp[l] = 2u * s + 1;
+				++inside;
+			}
+		}
+		spreadMin[s] = outside >= inst.services()[s].spreadMin() ? 0 : inst.services()[s].spreadMin();
+		if (inside < spreadMin[s]) {
+			m_serviceFree[s] = SERVICE_FIXED;
+		}
+	}
+	// a dependency with a fixed service on the cluster fixes the free one, until nothing changes
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (ServiceID s = 0; s < sCount; ++s) {
+			if (m_serviceFree[s] != SERVICE_FREE) {
+				continue;
+			}
+			auto out = boost::out_edges(s, dep);
+			for (auto d = out.first; d != out.second && m_serviceFree[s] == SERVICE_FREE; ++d) {
+				if (m_serviceFree[boost::target(*d, dep)] == SERVICE_FIXED) {
+					m_serviceFree[s] = SERVICE_FIXED;
+				}
+			}
+			auto in = boost::in_edges(s, dep);
+			for (auto d = in.first; d != in.second && m_serviceFree[s] == SERVICE_FREE; ++d) {
+				if (m_serviceFree[boost::source(*d, dep)] == SERVICE_FIXED) {
+					m_serviceFree[s] = SERVICE_FIXED;
+				}
+			}
+			changed = changed || m_serviceFree[s] != SERVICE_FREE;
+		}
+	}
+	// index machines, services and processes of the cluster
+	m_machineIndex.assign(inst.machines().size(), NONE);
+	sub.machines = machines;
+	for (MachineID i = 0; i < machines.size(); ++i) {
+		m_machineIndex[machines[i]] = i;
+	}
+	m_serviceIndex.assign(sCount, NONE);
+	std::vector<ServiceID> services;
+	for (ServiceID s = 0; s < sCount; ++s) {
+		if (m_serviceFree[s] == SERVICE_FREE) {
+			m_serviceIndex[s] = services.size();
+			services.push_back(s);
+		}
+	}
+	sub.processes.clear();
+	sub.initial.clear();
+	sub.solution.clear();
+	// usage of the fixed processes, current and transient, is taken off the capacities
+	std::vector<int64_t> fixedUsage(machines.size() * rCount, 0);
+	std::vector<int64_t> transientUsage(machines.size() * rCount, 0);
+	// usage of the free processes, which the capacities must keep allowing
+	std::vector<int64_t> freeUsage(machines.size() * rCount, 0);
+	for (ProcessID p = 0; p < pCount; ++p) {
+		const Process & process = inst.processes()[p];
+		const bool free = m_serviceFree[process.service()] == SERVICE_FREE && m_machineCluster[x[p]] == cluster;
+		if (free) {
+			sub.processes.push_back(p);
+			sub.initial.push_back(m_machineIndex[x0[p]]);
+			sub.solution.push_back(m_machineIndex[x[p]]);
+			for (ResourceID r = 0; r < rCount; ++r) {
+				freeUsage[m_machineIndex[x[p]] * rCount + r] += process.requirement(r);
+				if (x0[p] != x[p] && inst.resources()[r].transient()) {
+					freeUsage[m_machineIndex[x0[p]] * rCount + r] += process.requirement(r);
+				}
+			}
+			continue;
+		}
+		if (m_machineCluster[x[p]] == cluster) {
+			for (ResourceID r = 0; r < rCount; ++r) {
+				fixedUsage[m_machineIndex[x[p]] * rCount + r] += process.requirement(r);
+			}
+		}
+		if (m_machineCluster[x0[p]] == cluster && x0[p] != x[p]) {
+			for (ResourceID r = 0; r < rCount; ++r) {
+				transientUsage[m_machineIndex[x0[p]] * rCount + r] += process.requirement(r);
+			}
+		}
+	}
+	if (sub.processes.empty()) {
+		return false;
+	}
+	// capacities of the cluster machines
+	std::vector<int64_t> capacity(machines.size() * rCount);
+	for (MachineID i = 0; i < machines.size(); ++i) {
+		const Machine & machine = inst.machines()[machines[i]];
+		for (ResourceID r = 0; r < rCount; ++r) {
+			capacity[i * rCount + r] = static_cast<int64_t>(machine.capacity(r)) - fixedUsage[i * rCount + r];
+			if (inst.resources()[r].transient()) {
+				capacity[i * rCount + r] -= transientUsage[i * rCount + r];
+			}
+		}
+		// the transient usage also lowers the availability of the first resource of a balance cost:
+		// lowering that of the second resource accordingly keeps the balance cost unchanged
+		for (auto b = inst.balanceCosts().begin(); b != inst.balanceCosts().end(); ++b) {
+			if (inst.resources()[b->resource1()].transient()) {
+				capacity[i * rCount + b->resource2()] -= static_cast<int64_t>(b->target()) * transientUsage[i * rCount + b->resource1()];
+			}
+		}
+		for (ResourceID r = 0; r < rCount; ++r) {
+			capacity[i * rCount + r] = std::max(capacity[i * rCount + r], freeUsage[i * rCount + r]);
+		}
+	}
+	// encode the cluster in the format of the challenge
+	std::vector<uint32_t> raw;
+	raw.push_back(rCount);
+	for (ResourceID r = 0; r < rCount; ++r) {
+		raw.push_back(inst.resources()[r].transient() ? 1 : 0);
+		raw.push_back(inst.resources()[r].weightLoadCost());
+	}
+	std::vector<uint32_t> neighborhoodIndex(inst.neighborhoodCount(), NONE);
+	std::vector<uint32_t> locationIndex(inst.locationCount(), NONE);
+	uint32_t neighborhoods = 0;
+	uint32_t locations = 0;
+	raw.push_back(machines.size());
+	for (MachineID i = 0; i < machines.size(); ++i) {
+		const Machine & machine = inst.machines()[machines[i]];
+		if (neighborhoodIndex[machine.neighborhood()] == NONE) {
+			neighborhoodIndex[machine.neighborhood()] = neighborhoods++;
+		}
+		if (locationIndex[machine.location()] == NONE) {
+			locationIndex[machine.location()] = locations++;
+		}
+		raw.push_back(neighborhoodIndex[machine.neighborhood()]);
+		raw.push_back(locationIndex[machine.location()]);
+		for (ResourceID r = 0; r < rCount; ++r) {
+			raw.push_back(static_cast<uint32_t>(capacity[i * rCount + r]));
+		}
+		for (ResourceID r = 0; r < rCount; ++r) {
+			const int64_t safety = static_cast<int64_t>(machine.safetyCapacity(r)) - fixedUsage[i * rCount + r];
+			raw.push_back(static_cast<uint32_t>(std::max<int64_t>(0, safety)));
+		}
+		for (MachineID j = 0; j < machines.size(); ++j) {
+			raw.push_back(inst.machineMoveCost(machines[i], machines[j]));
+		}
+	}
+	raw.push_back(services.size());
+	for (auto s = services.begin(); s != services.end(); ++s) {
+		raw.push_back(spreadMin[*s]);
+		const std::size_t countPos = raw.size();
+		raw.push_back(0);
+		auto out = boost::out_edges(*s, dep);
+		for (auto d = out.first; d != out.second; ++d) {
+			const ServiceID t = boost::target(*d, dep);
+			if (m_serviceFree[t] == SERVICE_FREE) {
+				raw.push_back(m_serviceIndex[t]);
+				++raw[countPos];
+			}
+		}
+	}
+	raw.push_back(sub.processes.size());
+	for (auto p = sub.processes.begin(); p != sub.processes.end(); ++p) {
+		const Process & process = inst.processes()[*p];
+		raw.push_back(m_serviceIndex[process.service()]);
+		for (ResourceID r = 0; r < rCount; ++r) {
+			raw.push_back(process.requirement(r));
+		}
+		raw.push_back(process.movementCost());
+	}
+	raw.push_back(inst.balanceCosts().size());
+	for (auto b = inst.balanceCosts().begin(); b != inst.balanceCosts().end(); ++b) {
+		raw.push_back(b->resource1());
+		raw.push_back(b->resource2());
+		raw.push_back(b->target());
+		raw.push_back(b->weight());
+	}
+	raw.push_back(inst.weightProcessMoveCost());
+	raw.push_back(inst.weightServiceMoveCost());
+	raw.push_back(inst.weightMachineMoveCost());
+	sub.instance.reset(new Problem(Problem::parse(raw)));
+	sub.start.reset(new SolutionInfo(*sub.instance, sub.initial, sub.solution));
+	sub.startObjective = sub.start->objective();
+	return true;
+}
+
+void Decomposition::solve(std::vector<std::unique_ptr<SubProblem>> & subs) {
+	m_roundFlag.reset();
+	for (auto itr = subs.begin(); itr != subs.end(); ++itr) {
+		SubProblem & sub = **itr;
+		sub.pool.reset(new SolutionPool(20, 5, 2, 1.1));
+		sub.pool->push(sub.startObjective, sub.solution);
+		sub.heuristic.reset(makeHeuristic(m_subName));
+		sub.heuristic->init(*sub.instance, sub.initial, m_rng(), m_roundFlag, *sub.pool, config());
+	}
+	// the round ends with the heuristic, at the latest
+	const double seconds = std::min(m_roundTime, remaining());
+	timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	const double whole = std::floor(seconds);
+	deadline.tv_sec += static_cast<time_t>(whole);
+	deadline.tv_nsec += static_cast<long>((seconds - whole) * 1e9);
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec += 1;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	for (auto itr = subs.begin(); itr != subs.end(); ++itr) {
+		(*itr)->heuristic->start(deadline, *(*itr)->start);
+	}
+	{
+		// the clusters run on the slots of the runtime, this thread only waits
+		TaskRuntime::BlockingRegion region;
+		for (auto itr = subs.begin(); itr != subs.end(); ++itr) {
+			(*itr)->heuristic->wait();
+		}
+		m_roundFlag.write();
+		for (auto itr = subs.begin(); itr != subs.end(); ++itr) {
+			(*itr)->heuristic->join();
+		}
+	}
+	for (auto itr = subs.begin(); itr != subs.end(); ++itr) {
+		if ((*itr)->heuristic->error()) {
+			throw std::runtime_error("Cluster heuristic failed: " + (*itr)->heuristic->errorMessage());
+		}
+	}
+}
+
+void Decomposition::apply(const SubProblem & sub, std::vector<MachineID> & solution) const {
+	const std::vector<MachineID> & best = sub.heuristic->bestSolution();
+	for (ProcessID i = 0; i < sub.processes.size(); ++i) {
+		solution[sub.processes[i]] = sub.machines[best[i]];
+	}
+}
+
+bool Decomposition::merge(std::vector<std::unique_ptr<SubProblem>> & subs) {
+	Verifier verifier;
+	// all improved clusters at once
+	std::vector<SubProblem*> improved;
+	std::vector<MachineID> merged(m_best->solution());
+	for (auto itr = subs.begin(); itr != subs.end(); ++itr) {
+		if ((*itr)->heuristic->bestObjective() < (*itr)->startObjective) {
+			apply(**itr, merged);
+			improved.push_back(itr->get());
+		}
+	}
+	if (improved.empty()) {
+		return false;
+	}
+	Verifier::Result result = verifier.verify(instance(), initial(), merged);
+	if (result.feasible() && result.objective() < m_best->objective()) {
+		m_best.reset(new SolutionInfo(instance(), initial(), merged));
+		pool().push(m_best->objective(), m_best->solution());
+		return true;
+	}
+	// the approximations of the clusters did not hold together: merge them one at a time
+	bool accepted = false;
+	for (auto itr = improved.begin(); itr != improved.end(); ++itr) {
+		std::vector<MachineID> candidate(m_best->solution());
+		apply(**itr, candidate);
+		result = verifier.verify(instance(), initial(), candidate);
+		if (result.feasible() && result.objective() < m_best->objective()) {
+			m_best.reset(new SolutionInfo(instance(), initial(), candidate));
+			accepted = true;
+		}
+	}
+	if (accepted) {
+		pool().push(m_best->objective(), m_best->solution());
+	}
+	return accepted;
+}
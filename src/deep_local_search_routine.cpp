@@ -3,6 +3,7 @@
 #include "move_verifier.h"
 #include "exchange_verifier.h"
 #include <cmath>
+#include <algorithm>
 
 //#define TRACE_DLSR
 
@@ -14,24 +15,24 @@ uint64_t DeepLocalSearchRoutine::defaultMaxTrials() {
 	return static_cast<uint64_t>(pCount * (std::log10(pCount) + std::log10(mCount)));
 }
 
-Move DeepLocalSearchRoutine::randomMove(const SolutionInfo & x) {
+Move DeepLocalSearchRoutine::randomMove(const SolutionInfo & x, boost::mt19937 & rng) {
 	ProcessID p;
 	MachineID src;
 	MachineID dst;
 	do {
-		p = m_pDist(rng());
+		p = m_pDist(rng);
 		src = x.solution()[p];
-		dst = m_mDist(rng());
+		dst = dstSampler().sample(p, rng);
 	} while (src == dst);
 	Move move(p, src, dst);
 	return move;
 }
 
-Exchange DeepLocalSearchRoutine::randomExchange(const SolutionInfo & x) {
+Exchange DeepLocalSearchRoutine::randomExchange(const SolutionInfo & x, boost::mt19937 & rng) {
 	ProcessID p1, p2;
 	do {
-		p1 = m_pDist(rng());
-		p2 = m_pDist(rng());
+		p1 = m_pDist(rng);
+		p2 = m_pDist(rng);
 	} while (p1 == p2);
 	MachineID m1 = x.solution()[p1];
 	MachineID m2 = x.solution()[p2];
@@ -41,97 +42,130 @@ Exchange DeepLocalSearchRoutine::randomExchange(const SolutionInfo & x) {
 
 void DeepLocalSearchRoutine::configure(const ParameterMap & parameters) {
 	m_pDist = ProcessDist(0, instance().processes().size() - 1);
-	m_mDist = MachineDist(0, instance().machines().size() - 1);
 	m_maxTrials = parameters.param<uint64_t>("maxTrials", defaultMaxTrials());
 	m_maxSamples = parameters.param<uint64_t>("maxSamples", 1000);
+	m_threads = parameters.param<uint32_t>("threads", TaskRuntime::instance().threads());
+	m_threads = std::max(1u, std::min(m_threads, TaskRuntime::instance().threads()));
+	m_workers.resize(m_threads);
+	const uint32_t cacheBits = parameters.param<uint32_t>("cacheBits", 0);
+	for (uint32_t w = 0; w < m_threads; ++w) {
+		m_workers[w].cache.init(instance(), cacheBits);
+	}
+	m_moveFeasibleEvalCount = 0;
+	m_moveObjectiveEvalCount = 0;
+	m_moveCommitCount = 0;
+	m_exchangeFeasibleEvalCount = 0;
+	m_exchangeObjectiveEvalCount = 0;
+	m_exchangeCommitCount = 0;
+}
+
+void DeepLocalSearchRoutine::collect(SampleWorker & worker, const SolutionInfo & x, const uint64_t xObj) {
+	MethodDist methodDist(0, 1);
+	while (!worker.done()) {
+		++worker.trials;
+		uint8_t method = methodDist(worker.rng());
+		if (method == 0) {
+			Move move = randomMove(x, worker.rng());
+			uint64_t obj;
+			bool feasible = worker.cache.evaluate(worker.mv(), move, xObj, obj);
+			++worker.moveFeasibleEvalCount;
+			if (feasible) {
+				++worker.moveObjectiveEvalCount;
+				if (obj < xObj) {
+					worker.offer(move, obj);
+				}
+			}
+		} else if (method == 1) {
+			Exchange exchange = randomExchange(x, worker.rng());
+			uint64_t obj;
+			bool feasible = worker.cache.evaluate(worker.ev(), exchange, xObj, obj);
+			++worker.exchangeFeasibleEvalCount;
+			if (feasible) {
+				++worker.exchangeObjectiveEvalCount;
+				if (obj < xObj) {
+					worker.offer(exchange, obj);
+				}
+			}
+		} else {
+			CHECK(false);
+		}
+	}
 }
 
 void DeepLocalSearchRoutine::search(SolutionInfo & x) {
 	MoveVerifier mv(x);
 	ExchangeVerifier ev(x);
-	MethodDist methodDist(0, 1);
+	const uint32_t workers = m_workers.size();
+	for (uint32_t w = 0; w < workers; ++w) {
+		m_workers[w].bind(x);
+		m_workers[w].cache.reset();
+	}
+	// a single worker draws from the routine generator, as the serial search did
+	if (workers == 1) {
+		m_workers[0].useRng(rng());
+	}
 	uint64_t it = 0;
 	uint64_t xObj = x.objective();
-	uint8_t bestMethod = 0;
-	Move bestMove(0, 0, 0);
-	Exchange bestExchange(0, 0, 0, 0);
-	uint64_t bestObj = xObj;
+	CollectBody body(*this, x, xObj);
+	dstSampler().refresh(x);
 	while (!interrupted()) {
 		++it;
-		// perform one iteration
-		uint64_t trials = 0;
-		uint64_t samples = 0;
-		while (trials < m_maxTrials && samples < m_maxSamples) {
-			++trials;
-			uint8_t method = methodDist(rng());
-			if (method == 0) {
-				Move move = randomMove(x);
-				bool feasible = mv.feasible(move);
-				++m_moveFeasibleEvalCount;
-				if (feasible) {
-					uint64_t obj = mv.objective(move);
-					++m_moveObjectiveEvalCount;
-					if (obj < xObj) {
-						++samples;
-						if (obj < bestObj) {
-							// this is now the best sample
-							bestMethod = 0;
-							bestMove = move;
-							bestObj = obj;
-						}
-					}
-				}
-			} else if (method == 1) {
-				Exchange exchange = randomExchange(x);
-				bool feasible = ev.feasible(exchange);
-				++m_exchangeFeasibleEvalCount;
-				if (feasible) {
-					uint64_t obj = ev.objective(exchange);
-					++m_exchangeObjectiveEvalCount;
-					if (obj < xObj) {
-						++samples;
-						if (obj < bestObj) {
-							// this is now the best sample
-							bestMethod = 1;
-							bestExchange = exchange;
-							bestObj = obj;
-						}
-					}
-				}
-			} else {
-				CHECK(false);
+		// perform one iteration: workers sample the same solution
+		for (uint32_t w = 0; w < workers; ++w) {
+			if (workers > 1) {
+				m_workers[w].seed(rng()());
 			}
+			m_workers[w].start(xObj, SampleWorker::share(m_maxTrials, workers, w), SampleWorker::share(m_maxSamples, workers, w));
 		}
+		TaskRuntime::instance().parallelFor(workers, body, workers, 1);
+		uint64_t trials;
+		uint64_t samples;
+		const SampleWorker & best = m_workers[SampleWorker::reduce(m_workers, trials, samples)];
 		// iteration completed
 		// check if stuck in local minimum
-		if (samples == 0 && trials == m_maxTrials) {
+		if (samples == 0) {
 			#ifdef TRACE_DLSR
 			std::cout << "Iteration " << it << " failed, exiting local search" << std::endl;
 			#endif
 			break;
 		}
-		// check if iteration completed
-		if (samples == m_maxSamples || trials == m_maxTrials) {
-			#ifdef TRACE_DLSR
-			std::cout << "Iteration " << it;
-			std::cout << ": collected " << samples << " samples";
-			std::cout << " in " << trials << " trials.";
-			std::cout << " Best sample objective: " << bestObj << std::endl;
-			#endif
-			// perform the best move or the best exchange
-			if (bestMethod == 0) {
-				mv.objective(bestMove);
-				mv.commit(bestMove);
-				++m_moveCommitCount;
-			} else if (bestMethod == 1) {
-				ev.objective(bestExchange);
-				ev.commit(bestExchange);
-				++m_exchangeCommitCount;
-			} else {
-				CHECK(false);
+		#ifdef TRACE_DLSR
+		std::cout << "Iteration " << it;
+		std::cout << ": collected " << samples << " samples";
+		std::cout << " in " << trials << " trials.";
+		std::cout << " Best sample objective: " << best.bestObj << std::endl;
+		#endif
+		// perform the best move or the best exchange
+		if (best.bestMethod == 0) {
+			mv.objective(best.bestMove);
+			mv.commit(best.bestMove);
+			for (uint32_t w = 0; w < workers; ++w) {
+				m_workers[w].cache.update(best.bestMove);
 			}
-			// update objective of current solution
-			xObj = bestObj;
+			++m_moveCommitCount;
+		} else if (best.bestMethod == 1) {
+			ev.objective(best.bestExchange);
+			ev.commit(best.bestExchange);
+			for (uint32_t w = 0; w < workers; ++w) {
+				m_workers[w].cache.update(best.bestExchange);
+			}
+			++m_exchangeCommitCount;
+		} else {
+			CHECK(false);
 		}
+		dstSampler().update();
+		// update objective of current solution
+		xObj = best.bestObj;
+	}
+	for (uint32_t w = 0; w < workers; ++w) {
+		SampleWorker & worker = m_workers[w];
+		m_moveFeasibleEvalCount += worker.moveFeasibleEvalCount;
+		m_moveObjectiveEvalCount += worker.moveObjectiveEvalCount;
+		m_exchangeFeasibleEvalCount += worker.exchangeFeasibleEvalCount;
+		m_exchangeObjectiveEvalCount += worker.exchangeObjectiveEvalCount;
+		worker.moveFeasibleEvalCount = 0;
+		worker.moveObjectiveEvalCount = 0;
+		worker.exchangeFeasibleEvalCount = 0;
+		worker.exchangeObjectiveEvalCount = 0;
 	}
 }
@@ -3,29 +3,31 @@
 #include "move_verifier.h"
 #include "exchange_verifier.h"
 #include <cmath>
+#include <limits>
+#include <algorithm>
 
 #define TRACE_DEEP_SHAKE_ROUTINE
 
 using namespace R12;
 
-Move DeepShakeRoutine::randomMove(const SolutionInfo & x) {
+Move DeepShakeRoutine::randomMove(const SolutionInfo & x, boost::mt19937 & rng) {
 	ProcessID p;
 	MachineID src;
 	MachineID dst;
 	do {
-		p = m_pDist(rng());
+		p = m_pDist(rng);
 		src = x.solution()[p];
-		dst = m_mDist(rng());
+		dst = dstSampler().sample(p, rng);
 	} while (src == dst);
 	Move move(p, src, dst);
 	return move;
 }
 
-Exchange DeepShakeRoutine::randomExchange(const SolutionInfo & x) {
+Exchange DeepShakeRoutine::randomExchange(const SolutionInfo & x, boost::mt19937 & rng) {
 	ProcessID p1, p2;
 	do {
-		p1 = m_pDist(rng());
-		p2 = m_pDist(rng());
+		p1 = m_pDist(rng);
+		p2 = m_pDist(rng);
 	} while (p1 == p2);
 	MachineID m1 = x.solution()[p1];
 	MachineID m2 = x.solution()[p2];
@@ -35,9 +37,78 @@ Exchange DeepShakeRoutine::randomExchange(const SolutionInfo & x) {
 
 void DeepShakeRoutine::configure(const ParameterMap & parameters) {
 	m_pDist = ProcessDist(0, instance().processes().size() - 1);
-	m_mDist = MachineDist(0, instance().machines().size() - 1);
 	m_maxTrials = parameters.param<uint64_t>("maxTrials", 1000);
 	m_samples = parameters.param<uint64_t>("samples", 100);
+	m_threads = parameters.param<uint32_t>("threads", TaskRuntime::instance().threads());
+	m_threads = std::max(1u, std::min(m_threads, TaskRuntime::instance().threads()));
+	m_workers.resize(m_threads);
+	m_seeds.resize(m_samples);
+}
+
+void DeepShakeRoutine::SampleBody::operator()(const uint32_t begin, const uint32_t end, const uint32_t worker) {
+	for (uint32_t sample = begin; sample < end; ++sample) {
+		m_routine.buildSample(m_routine.m_workers[worker], m_xStart, m_k, sample);
+	}
+}
+
+void DeepShakeRoutine::buildSample(Worker & worker, const SolutionInfo & xStart, const uint64_t k, const uint64_t sample) {
+	// reuse the buffer of the worker instead of allocating a new solution
+	if (!worker.x) {
+		worker.x.reset(new SolutionInfo(xStart));
+	} else {
+		*worker.x = xStart;
+	}
+	SolutionInfo & x = *worker.x;
+	Counters & counters = worker.counters;
+	boost::mt19937 rng(m_seeds[sample]);
+	boost::uniform_int<int> methodDist(0, 1);
+	MoveVerifier mv(x);
+	ExchangeVerifier ev(x);
+	for (uint64_t i = 0; i < k; ++i) {
+		bool found = false;
+		// try to make move i
+		uint64_t trials = 0;
+		while (trials < m_maxTrials && !flag().read() && !found) {
+			++trials;
+			int method = methodDist(rng);
+			if (method == 0) {
+				Move move = randomMove(x, rng);
+				bool feasible = mv.feasible(move);
+				++counters.moveFeasibleEvalCount;
+				if (feasible) {
+					mv.objective(move);
+					++counters.moveObjectiveEvalCount;
+					mv.commit(move);
+					++counters.moveCommitCount;
+					found = true;
+				}
+			} else if (method == 1) {
+				Exchange exchange = randomExchange(x, rng);
+				bool feasible = ev.feasible(exchange);
+				++counters.exchangeFeasibleEvalCount;
+				if (feasible) {
+					ev.objective(exchange);
+					++counters.exchangeObjectiveEvalCount;
+					ev.commit(exchange);
+					++counters.exchangeCommitCount;
+					found = true;
+				}
+			} else {
+				CHECK(false);
+			}
+		}
+		// end of move i
+		if (!found) {
+			break;
+		}
+	}
+	// keep the best sample of the worker, ties broken by sample order
+	uint64_t obj = x.objective();
+	if (obj < worker.bestObj || (obj == worker.bestObj && sample < worker.bestSample)) {
+		worker.bestObj = obj;
+		worker.bestSample = sample;
+		worker.x.swap(worker.best);
+	}
 }
 
 void DeepShakeRoutine::shake(SolutionInfo & xStart, const uint64_t k) {
@@ -45,60 +116,39 @@ void DeepShakeRoutine::shake(SolutionInfo & xStart, const uint64_t k) {
 	#ifdef TRACE_DEEP_SHAKE_ROUTINE
 	std::cout << "Shake " << k << " starts from objective: " << startObj << std::endl;
 	#endif
-	boost::uniform_int<int> methodDist(0, 1);
-	uint64_t bestObj = std::numeric_limits<uint64_t>::max();
-	std::vector<MachineID> bestSolution;
+	dstSampler().refresh(xStart);
+	// seeds are drawn in sample order from the routine generator
 	for (uint64_t sample = 0; sample < m_samples; ++sample) {
-		SolutionInfo x(xStart);
-		MoveVerifier mv(x);
-		ExchangeVerifier ev(x);
-		uint64_t completed = 0;
-		for (uint64_t i = 0; i < k; ++i) {
-			bool found = false;
-			// try to make move i
-			uint64_t trials = 0;
-			while (trials < m_maxTrials && !interrupted() && !found) {
-				++trials;
-				int method = methodDist(rng());
-				if (method == 0) {
-					Move move = randomMove(x);
-					bool feasible = mv.feasible(move);
-					++m_moveFeasibleEvalCount;
-					if (feasible) {
-						mv.objective(move);
-						++m_moveObjectiveEvalCount;
-						mv.commit(move);
-						++m_moveCommitCount;
-						found = true;
-					}
-				} else if (method == 1) {
-					Exchange exchange = randomExchange(x);
-					bool feasible = ev.feasible(exchange);
-					++m_exchangeFeasibleEvalCount;
-					if (feasible) {
-						ev.objective(exchange);
-						++m_exchangeObjectiveEvalCount;
-						ev.commit(exchange);
-						++m_exchangeCommitCount;
-						found = true;
-					}
-				} else {
-					CHECK(false);
-				}
+		m_seeds[sample] = rng()();
+	}
+	for (uint32_t w = 0; w < m_workers.size(); ++w) {
+		m_workers[w].bestObj = std::numeric_limits<uint64_t>::max();
+		m_workers[w].bestSample = m_samples;
+	}
+	SampleBody body(*this, xStart, k);
+	TaskRuntime::instance().parallelFor(m_samples, body, m_threads, 1);
+	// reduce to the best sample and copy it directly
+	Worker * best = 0;
+	for (uint32_t w = 0; w < m_workers.size(); ++w) {
+		Worker & worker = m_workers[w];
+		m_counters.moveFeasibleEvalCount += worker.counters.moveFeasibleEvalCount;
+		m_counters.moveObjectiveEvalCount += worker.counters.moveObjectiveEvalCount;
+		m_counters.moveCommitCount += worker.counters.moveCommitCount;
+		m_counters.exchangeFeasibleEvalCount += worker.counters.exchangeFeasibleEvalCount;
+		m_counters.exchangeObjectiveEvalCount += worker.counters.exchangeObjectiveEvalCount;
+		m_counters.exchangeCommitCount += worker.counters.exchangeCommitCount;
+		worker.counters = Counters();
+		if (worker.bestSample < m_samples) {
+			if (best == 0 || worker.bestObj < best->bestObj || (worker.bestObj == best->bestObj && worker.bestSample < best->bestSample)) {
+				best = &worker;
 			}
-			// end of move i
-			if (!found) {
-				completed = i;
-				break;
-			}	
-		}
-		uint64_t obj = x.objective();
-		if (obj < bestObj) {
-			bestObj = obj;
-			bestSolution = x.solution();
 		}
 	}
-	xStart = SolutionInfo(instance(), initial(), bestSolution);
+	uint64_t bestObj = startObj;
+	if (best != 0) {
+		bestObj = best->bestObj;
+		xStart = *best->best;
+	}
 	#ifdef TRACE_DEEP_SHAKE_ROUTINE
 	int64_t diff = static_cast<int64_t>(bestObj) - static_cast<int64_t>(startObj);
 	std::cout << "Shake " << k << ": accepting best of " << m_samples;
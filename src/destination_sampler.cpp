@@ -0,0 +1,121 @@
+#include "destination_sampler.h"
+
+#include <stdexcept>
+
+using namespace R12;
+
+MoveCostDestinationSampler::MoveCostDestinationSampler(const Problem & instance, const std::vector<MachineID> & initial, const double bias)
+: m_instance(instance), m_initial(initial), m_bias(bias) {
+	m_tableIndex.resize(instance.machines().size(), UINT32_MAX);
+	m_tables.reserve(instance.machines().size());
+	pthread_mutex_init(&m_mutex, 0);
+}
+
+MoveCostDestinationSampler::~MoveCostDestinationSampler() {
+	pthread_mutex_destroy(&m_mutex);
+}
+
+uint32_t MoveCostDestinationSampler::buildTable(const MachineID origin) {
+	const MachineCount mCount = m_instance.machines().size();
+	pthread_mutex_lock(&m_mutex);
+	// another thread may have built it in the meantime
+	if (m_tableIndex[origin] != UINT32_MAX) {
+		const uint32_t index = m_tableIndex[origin];
+		pthread_mutex_unlock(&m_mutex);
+		return index;
+	}
+	// hash the move cost row of the origin
+	uint64_t hash = 14695981039346656037ULL;
+	for (MachineID dst = 0; dst < mCount; ++dst) {
+		hash ^= m_instance.machineMoveCost(origin, dst);
+		hash *= 1099511628211ULL;
+	}
+	// reuse the table of an origin with an identical row
+	for (uint32_t i = 0; i < m_tables.size(); ++i) {
+		if (m_tableHash[i] != hash) {
+			continue;
+		}
+		const MachineID other = m_tableOrigin[i];
+		bool equal = true;
+		for (MachineID dst = 0; dst < mCount && equal; ++dst) {
+			equal = m_instance.machineMoveCost(origin, dst) == m_instance.machineMoveCost(other, dst);
+		}
+		if (equal) {
+			m_tableIndex[origin] = i;
+			pthread_mutex_unlock(&m_mutex);
+			return i;
+		}
+	}
+	// cheap destinations are more likely, but every destination has positive weight
+	const double weight = m_bias * m_instance.weightMachineMoveCost();
+	std::vector<double> weights(mCount);
+	for (MachineID dst = 0; dst < mCount; ++dst) {
+		weights[dst] = 1.0 / (1.0 + weight * m_instance.machineMoveCost(origin, dst));
+	}
+	const uint32_t index = m_tables.size();
+	m_tables.push_back(AliasTable(weights));
+	m_tableOrigin.push_back(origin);
+	m_tableHash.push_back(hash);
+	// publish the index only once the table is complete
+	__sync_synchronize();
+	m_tableIndex[origin] = index;
+	pthread_mutex_unlock(&m_mutex);
+	return index;
+}
+
+CapacityDestinationSampler::CapacityDestinationSampler(const Problem & instance, const uint32_t period)
+: m_instance(instance), m_x(0), m_period(period), m_updates(0) {
+	const MachineCount mCount = instance.machines().size();
+	const ResourceCount rCount = instance.resources().size();
+	// express residual capacities relative to the average capacity of each resource
+	m_resourceScale.resize(rCount);
+	for (ResourceID r = 0; r < rCount; ++r) {
+		double total = 0.0;
+		for (MachineID m = 0; m < mCount; ++m) {
+			total += instance.machines()[m].capacity(r);
+		}
+		m_resourceScale[r] = total > 0.0 ? mCount / total : 0.0;
+	}
+	// uniform until the first refresh
+	m_weights.assign(mCount, 1.0);
+	m_table.build(m_weights);
+}
+
+void CapacityDestinationSampler::rebuild() {
+	const MachineCount mCount = m_instance.machines().size();
+	const ResourceCount rCount = m_instance.resources().size();
+	for (MachineID m = 0; m < mCount; ++m) {
+		const Machine & machine = m_instance.machines()[m];
+		double residual = 0.0;
+		for (ResourceID r = 0; r < rCount; ++r) {
+			uint32_t used = m_x->usage(m, r);
+			if (m_instance.resources()[r].transient()) {
+				used += m_x->transient(m, r);
+			}
+			if (used < machine.capacity(r)) {
+				residual += (machine.capacity(r) - used) * m_resourceScale[r];
+			}
+		}
+		// full machines keep a small weight so that exchanges through them remain possible
+		m_weights[m] = 0.01 + residual / rCount;
+	}
+	m_table.build(m_weights);
+	m_updates = 0;
+}
+
+DestinationSampler * R12::makeDestinationSampler(const Problem & instance,
+												 const std::vector<MachineID> & initial,
+												 const ParameterMap & parameters) {
+	std::string name = parameters.param<std::string>("dst", "uniform");
+	if (name.compare("uniform") == 0) {
+		return new UniformDestinationSampler(instance);
+	} else if (name.compare("cost") == 0) {
+		double bias = parameters.param<double>("dstBias", 1.0);
+		return new MoveCostDestinationSampler(instance, initial, bias);
+	} else if (name.compare("capacity") == 0) {
+		uint32_t period = parameters.param<uint32_t>("dstPeriod", 100);
+		return new CapacityDestinationSampler(instance, period);
+	} else {
+		throw std::runtime_error("Invalid destination sampler");
+	}
+}
@@ -1,8 +1,8 @@
 #include "els.h"
-#include "batch_verifier.h"
+#include "exchange.h"
 #include <vector>
 #include <algorithm>
-#include <set>
+#include <cstdlib>
 
 // #define TRACE_ELS
 
@@ -29,58 +29,105 @@ inline int64_t ELS::distance(const SolutionInfo & info, const MachineID m) const
 	return d;
 }
 
-inline int64_t ELS::distance(const SolutionInfo & info, const MachineID m, const ProcessID pOut, const ProcessID pIn) const {
-	int64_t d = 0;
-	const Machine & machine = info.instance().machines()[m];
-	const Process & processOut = info.instance().processes()[pOut];
-	const Process & processIn = info.instance().processes()[pIn];
-	bool outside = false;
-	for (ResourceID r = 0; r < info.instance().resources().size(); ++r) {
-		const Resource & resource = info.instance().resources()[r];
-		int64_t usage = static_cast<int64_t>(info.usage(m, r));
-		usage -= processOut.requirement(r);
-		usage += processIn.requirement(r);
-		int64_t sc = static_cast<int64_t>(machine.safetyCapacity(r));
-		if (usage > sc) outside = true;
-		d += resource.weightLoadCost() * std::abs(usage - sc);
+void ELS::preparePartner(const SolutionInfo & info, const MachineID m2) {
+	const std::vector<ProcessID> & procs = m_procByMachine[m2];
+	const uint32_t count = procs.size();
+	const Machine & machine = info.instance().machines()[m2];
+	const ResourceCount rCount = info.instance().resources().size();
+	m_partnerReq.resize(rCount * count);
+	m_partnerBase.resize(rCount * count);
+	for (ResourceID r = 0; r < rCount; ++r) {
+		const int64_t slack = static_cast<int64_t>(info.usage(m2, r)) - static_cast<int64_t>(machine.safetyCapacity(r));
+		for (uint32_t j = 0; j < count; ++j) {
+			const int64_t req = info.instance().processes()[procs[j]].requirement(r);
+			m_partnerReq[r * count + j] = req;
+			m_partnerBase[r * count + j] = slack - req;
+		}
 	}
-	if (outside) {
-		d = -d;
+	m_newDistance1.resize(count);
+	m_newDistance2.resize(count);
+	m_outside1.resize(count);
+	m_outside2.resize(count);
+}
+
+/*
+* Computes the distances of m1 and of the partner machine after exchanging p1 with each process of the partner.
+*/
+void ELS::computeDistances(const SolutionInfo & info, const MachineID m1, const ProcessID p1, const uint32_t count) {
+	const Machine & machine = info.instance().machines()[m1];
+	const Process & process = info.instance().processes()[p1];
+	const ResourceCount rCount = info.instance().resources().size();
+	std::fill(m_newDistance1.begin(), m_newDistance1.end(), 0);
+	std::fill(m_newDistance2.begin(), m_newDistance2.end(), 0);
+	std::fill(m_outside1.begin(), m_outside1.end(), 0);
+	std::fill(m_outside2.begin(), m_outside2.end(), 0);
+	int64_t * d1 = &m_newDistance1[0];
+	int64_t * d2 = &m_newDistance2[0];
+	uint8_t * o1 = &m_outside1[0];
+	uint8_t * o2 = &m_outside2[0];
+	for (ResourceID r = 0; r < rCount; ++r) {
+		const int64_t w = info.instance().resources()[r].weightLoadCost();
+		const int64_t req1 = process.requirement(r);
+		const int64_t base1 = static_cast<int64_t>(info.usage(m1, r)) - req1 - static_cast<int64_t>(machine.safetyCapacity(r));
+		const int64_t * req2 = &m_partnerReq[r * count];
+		const int64_t * base2 = &m_partnerBase[r * count];
+		// branch-free loop over contiguous arrays, vectorized by the compiler
+		for (uint32_t j = 0; j < count; ++j) {
+			const int64_t t1 = base1 + req2[j];
+			const int64_t t2 = base2[j] + req1;
+			d1[j] += w * (t1 < 0 ? -t1 : t1);
+			d2[j] += w * (t2 < 0 ? -t2 : t2);
+			o1[j] |= t1 > 0;
+			o2[j] |= t2 > 0;
+		}
 	}
-	return d;
+	for (uint32_t j = 0; j < count; ++j) {
+		if (o1[j]) d1[j] = -d1[j];
+		if (o2[j]) d2[j] = -d2[j];
+	}
+}
+
+void ELS::moveProcess(const ProcessID p, const MachineID src, const MachineID dst) {
+	std::vector<ProcessID> & from = m_procByMachine[src];
+	const uint32_t pos = m_position[p];
+	from[pos] = from.back();
+	m_position[from[pos]] = pos;
+	from.pop_back();
+	m_position[p] = m_procByMachine[dst].size();
+	m_procByMachine[dst].push_back(p);
+}
+
+void ELS::removeMachine(std::vector<MachineID> & machines, const MachineID m) {
+	machines.erase(std::remove(machines.begin(), machines.end(), m), machines.end());
 }
 
 void ELS::runFromSolution(SolutionInfo & info) {
 	m_bestObjective = info.objective();
-	m_bestSolution = info.solution();
 	// set seed
 	srand(seed());
-	// build vectors of machines below and above safety capacity
+	const MachineCount mCount = info.instance().machines().size();
+	// cache distances and build vectors of machines below and above safety capacity
 	std::vector<MachineID> mbsc;
 	std::vector<MachineID> masc;
-	for (MachineID m = 0; m < info.instance().machines().size(); ++m) {
-		const Machine & machine = info.instance().machines()[m];
-		bool above = false;
-		for (ResourceID r = 0; r < info.instance().resources().size(); ++r) {
-			if (info.usage(m, r) > machine.safetyCapacity(r)) {
-				above = true;
-				break;
-			}
-		}
-		if (above) {
+	m_distance.resize(mCount);
+	for (MachineID m = 0; m < mCount; ++m) {
+		m_distance[m] = distance(info, m);
+		if (m_distance[m] < 0) {
 			masc.push_back(m);
 		} else {
 			mbsc.push_back(m);
 		}
 	}
-	// initialize per-machine process set
-	std::vector<std::set<ProcessID>> procByMachine(info.instance().machines().size());
+	// initialize per-machine process arrays
+	m_procByMachine.assign(mCount, std::vector<ProcessID>());
+	m_position.resize(info.instance().processes().size());
 	for (ProcessID p = 0; p < info.instance().processes().size(); ++p) {
 		MachineID m = info.solution()[p];
-		procByMachine[m].insert(p);
+		m_position[p] = m_procByMachine[m].size();
+		m_procByMachine[m].push_back(p);
 	}
-	// initialize batch verifier
-	BatchVerifier bv(info);
+	// the solution stays feasible, so exchanges are evaluated incrementally and never rolled back
+	ExchangeVerifier ev(info);
 	// start local search
 	bool continueLocalSearch = true;
 	uint64_t it = 0;
@@ -90,69 +137,66 @@ void ELS::runFromSolution(SolutionInfo & info) {
 		// shuffle vectors
 		std::random_shuffle(mbsc.begin(), mbsc.end());
 		std::random_shuffle(masc.begin(), masc.end());
-		for (auto bitr = mbsc.begin(); bitr != mbsc.end(); ++bitr) {
-			for (auto aitr = masc.begin(); aitr != masc.end(); ++aitr) {
-				MachineID m1 = *aitr;
-				MachineID m2 = *bitr;
-				int64_t m1Distance = distance(info, m1);
-				int64_t m2Distance = distance(info, m2);
-				for (auto p1Itr = procByMachine[m1].begin(); p1Itr != procByMachine[m1].end(); ++p1Itr) {
-					for (auto p2Itr = procByMachine[m2].begin(); p2Itr != procByMachine[m2].end(); ++p2Itr) {
-						ProcessID p1 = *p1Itr;
-						ProcessID p2 = *p2Itr;
-						int64_t m1NewDistance = distance(info, m1, p1, p2);
-						int64_t m2NewDistance = distance(info, m2, p2, p1);
-						if (std::abs(m1NewDistance) < std::abs(m1Distance) && std::abs(m2NewDistance) < std::abs(m2Distance)) {
+		// indices rather than iterators, since a commit edits both vectors before the loops end
+		for (uint32_t b = 0; b < mbsc.size() && !continueLocalSearch; ++b) {
+			const MachineID m2 = mbsc[b];
+			const int64_t m2Distance = std::abs(m_distance[m2]);
+			const uint32_t count = m_procByMachine[m2].size();
+			if (count == 0) {
+				continue;
+			}
+			preparePartner(info, m2);
+			for (uint32_t a = 0; a < masc.size() && !continueLocalSearch; ++a) {
+				const MachineID m1 = masc[a];
+				const int64_t m1Distance = std::abs(m_distance[m1]);
+				const std::vector<ProcessID> & procs1 = m_procByMachine[m1];
+				for (uint32_t i = 0; i < procs1.size() && !continueLocalSearch; ++i) {
+					const ProcessID p1 = procs1[i];
+					computeDistances(info, m1, p1, count);
+					for (uint32_t j = 0; j < count; ++j) {
+						if (std::abs(m_newDistance1[j]) >= m1Distance || std::abs(m_newDistance2[j]) >= m2Distance) {
+							continue;
+						}
+						const ProcessID p2 = m_procByMachine[m2][j];
+						#ifdef TRACE_ELS
+						std::cout << "ELS - Distance reduction exchanging " << p1 << "@" << m1 << " and " << p2 << "@" << m2 << std::endl;
+						#endif
+						Exchange exchange(m1, p1, m2, p2);
+						if (!ev.feasible(exchange) || ev.objective(exchange) >= m_bestObjective) {
 							#ifdef TRACE_ELS
-							std::cout << "ELS - Distance reduction exchanging " << p1 << "@" << m1 << " and " << p2 << "@" << m2 << std::endl;
+							std::cout << "ELS - Exchange is unfeasible or not improving" << std::endl;
 							#endif
-							// exchange processes
-							Move move1(p1, m1, m2);
-							Move move2(p2, m2, m1);
-							bv.update(move1);
-							bv.update(move2);
-							if (bv.feasible() && bv.objective() < m_bestObjective) {
-								#ifdef TRACE_ELS
-								std::cout << "ELS - Applying exchange, objective " << bv.objective() << std::endl;
-								#endif
-								m_bestObjective = bv.objective();
-								m_bestSolution = bv.solution();
-								continueLocalSearch = true;
-								procByMachine[m1].erase(p1Itr);
-								procByMachine[m2].erase(p2Itr);
-								procByMachine[m1].insert(p2);
-								procByMachine[m2].insert(p1);
-								if (m1NewDistance < 0) {
-									std::remove(masc.begin(), masc.end(), m1);
-									mbsc.push_back(m1);
-								}
-								if (m2NewDistance > 0) {
-									std::remove(mbsc.begin(), mbsc.end(), m2);
-									masc.push_back(m2);
-								}
-							} else {
-								#ifdef TRACE_ELS
-								std::cout << "ELS - Exchange is unfeasible" << std::endl;
-								#endif
-								bv.rollback(move1);
-								bv.rollback(move2);
-							}
+							continue;
+						}
+						ev.commit(exchange);
+						m_bestObjective = info.objective();
+						#ifdef TRACE_ELS
+						std::cout << "ELS - Applying exchange, objective " << m_bestObjective << std::endl;
+						#endif
+						continueLocalSearch = true;
+						moveProcess(p1, m1, m2);
+						moveProcess(p2, m2, m1);
+						m_distance[m1] = m_newDistance1[j];
+						m_distance[m2] = m_newDistance2[j];
+						if (m_distance[m1] >= 0) {
+							removeMachine(masc, m1);
+							mbsc.push_back(m1);
 						}
-						if (continueLocalSearch) {
-							break;
+						if (m_distance[m2] < 0) {
+							removeMachine(mbsc, m2);
+							masc.push_back(m2);
 						}
+						break;
 					}
-					if (continueLocalSearch || interrupted()) {
+					if (interrupted()) {
 						break;
 					}
 				}
-				if (continueLocalSearch || interrupted()) {
-					break;
-				}
 			}
-			if (continueLocalSearch || interrupted()) {
+			if (interrupted()) {
 				break;
 			}
 		}
 	}
+	m_bestSolution = info.solution();
 }
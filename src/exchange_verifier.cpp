@@ -395,6 +395,8 @@ void ExchangeVerifier::commit(const Exchange & exchange) {
 	// exchange processes
 	info().solution()[p1] = m2;
 	info().solution()[p2] = m1;
+	info().updateMoved(p1);
+	info().updateMoved(p2);
 	// update usage and transient usage
 	for (ResourceID r = 0; r < instance().resources().size(); ++r) {
 		const Resource & resource = instance().resources()[r];
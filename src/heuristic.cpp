@@ -12,6 +12,7 @@ void Heuristic::init(const Problem & instance, const std::vector<MachineID> & in
 	m_flagPtr = &flag;
 	m_poolPtr = &pool;
 	m_params.init(config);
+	m_config = config;
 }
 
 void Heuristic::signalCompletion() {
@@ -49,12 +50,54 @@ void Heuristic::start(const timespec & deadline) {
 	if (err != 0) throw std::runtime_error("Heuristic: pthread_create failed");
 }
 
+void Heuristic::start(const timespec & deadline, SolutionInfo & info) {
+	m_fromPtr = &info;
+	start(deadline);
+}
+
 void Heuristic::join() {
 	int err = pthread_join(m_thread, 0);
 	if (err != 0) throw std::runtime_error("Heuristic: pthread_join failed");
 	m_runningAsync = false;
 }
 
+bool Heuristic::completed() const {
+	pthread_mutex_lock(&m_completedMutex);
+	const bool result = m_completed;
+	pthread_mutex_unlock(&m_completedMutex);
+	return result;
+}
+
+void Heuristic::suspend() {
+	pthread_mutex_lock(&m_suspendMutex);
+	__atomic_store_n(&m_suspended, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&m_suspendMutex);
+}
+
+void Heuristic::resume() {
+	pthread_mutex_lock(&m_suspendMutex);
+	__atomic_store_n(&m_suspended, 0, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&m_suspendCond);
+	pthread_mutex_unlock(&m_suspendMutex);
+}
+
+void Heuristic::waitResume() const {
+	TaskRuntime::BlockingRegion region;
+	pthread_mutex_lock(&m_suspendMutex);
+	// the flag is not signaled, so it is polled a few times per second
+	while (m_suspended != 0 && !flag().read()) {
+		timespec timeout;
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timeout.tv_nsec += 100000000;
+		if (timeout.tv_nsec >= 1000000000) {
+			timeout.tv_nsec -= 1000000000;
+			++timeout.tv_sec;
+		}
+		pthread_cond_timedwait(&m_suspendCond, &m_suspendMutex, &timeout);
+	}
+	pthread_mutex_unlock(&m_suspendMutex);
+}
+
 bool Heuristic::wait() {
 	pthread_mutex_lock(&m_completedMutex);
 	int err = 0;
@@ -14,6 +14,8 @@
 #include "linear_solver.h"
 #include "random_move_ls.h"
 #include "vns3.h"
+#include "decomposition.h"
+#include "parallel_tempering.h"
 
 using namespace R12;
 
@@ -48,6 +50,10 @@ Heuristic * R12::makeHeuristic(const std::string & name) {
 		return new RandomMoveLS();
 	} else if (name.compare("vns3") == 0) {
 		return new VNS3();
+	} else if (name.compare("decomposition") == 0) {
+		return new Decomposition();
+	} else if (name.compare("parallel_tempering") == 0) {
+		return new ParallelTempering();
 	} else {
 		throw std::runtime_error("Unknown heuristic");
 	}
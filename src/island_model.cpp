@@ -0,0 +1,200 @@
+#include "island_model.h"
+
+#include <cmath>
+#include <ctime>
+#include <stdexcept>
+#include <iostream>
+
+//#define TRACE_ISLANDS
+
+using namespace R12;
+
+IslandModel::IslandModel(SolutionPool & global, const uint32_t islands, const ParameterMap & parameters, const uint32_t seed,
+	ProcessCount hqMinBestDelta, double hdMaxBestObjRatio)
+: m_global(global), m_rng(seed), m_running(false), m_stopEvent(false), m_migrationCount(0), m_migrantCount(0) {
+	CHECK(islands > 0);
+	m_topology = parseTopology(parameters.param<std::string>("topology", "ring"));
+	m_interval = parameters.param<double>("interval", 5.0);
+	m_migrants = parameters.param<uint32_t>("migrants", 2);
+	const std::size_t elite = parameters.param<std::size_t>("elite", 20);
+	const std::size_t diverse = parameters.param<std::size_t>("diverse", 5);
+	for (uint32_t i = 0; i < islands; ++i) {
+		m_pools.push_back(std::unique_ptr<SolutionPool>(new SolutionPool(elite, diverse, hqMinBestDelta, hdMaxBestObjRatio)));
+		m_sources.push_back(SolutionPool::newSource());
+	}
+	m_forwarded.assign(islands, UINT64_MAX);
+	// the torus has as many rows as the largest divisor not greater than the square root
+	m_rows = static_cast<uint32_t>(std::sqrt(static_cast<double>(islands)));
+	while (islands % m_rows != 0) {
+		--m_rows;
+	}
+	m_cols = islands / m_rows;
+	pthread_mutex_init(&m_mutex, 0);
+	pthread_cond_init(&m_cond, 0);
+}
+
+IslandModel::~IslandModel() {
+	stop();
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+IslandModel::Topology IslandModel::parseTopology(const std::string & name) {
+	if (name.compare("ring") == 0) {
+		return RING;
+	} else if (name.compare("torus") == 0) {
+		return TORUS;
+	} else if (name.compare("random") == 0) {
+		return RANDOM;
+	} else {
+		throw std::runtime_error("Unknown island topology: " + name);
+	}
+}
+
+void IslandModel::start() {
+	// seed every island with the solutions of the global pool
+	SolutionPool::Entry entry;
+	if (m_global.best(entry)) {
+		for (uint32_t i = 0; i < m_pools.size(); ++i) {
+			m_pools[i]->push(entry.obj(), *entry.ptr(), m_sources[i]);
+		}
+	}
+	for (uint32_t i = 0; i < m_pools.size(); ++i) {
+		m_pools[i]->start();
+	}
+	m_stopEvent = false;
+	int err = pthread_create(&m_thread, 0, &IslandModel::doMigrate, this);
+	if (err != 0) {
+		throw std::runtime_error("IslandModel: pthread_create failed");
+	}
+	m_running = true;
+}
+
+void IslandModel::stop() {
+	if (!m_running) {
+		return;
+	}
+	pthread_mutex_lock(&m_mutex);
+	m_stopEvent = true;
+	pthread_cond_signal(&m_cond);
+	pthread_mutex_unlock(&m_mutex);
+	pthread_join(m_thread, 0);
+	m_running = false;
+	for (uint32_t i = 0; i < m_pools.size(); ++i) {
+		m_pools[i]->stop();
+	}
+	forward();
+	#ifdef TRACE_ISLANDS
+	std::cout << "Islands - " << m_migrationCount << " migrations, " << m_migrantCount << " migrants" << std::endl;
+	#endif
+}
+
+void * IslandModel::doMigrate(void * arg) {
+	static_cast<IslandModel*>(arg)->loop();
+	return 0;
+}
+
+void IslandModel::loop() {
+	pthread_mutex_lock(&m_mutex);
+	while (!m_stopEvent) {
+		timespec wakeup;
+		clock_gettime(CLOCK_REALTIME, &wakeup);
+		const double seconds = std::floor(m_interval);
+		wakeup.tv_sec += static_cast<time_t>(seconds);
+		wakeup.tv_nsec += static_cast<long>((m_interval - seconds) * 1e9);
+		if (wakeup.tv_nsec >= 1000000000L) {
+			wakeup.tv_sec += 1;
+			wakeup.tv_nsec -= 1000000000L;
+		}
+		int err = 0;
+		while (!m_stopEvent && err == 0) {
+			err = pthread_cond_timedwait(&m_cond, &m_mutex, &wakeup);
+		}
+		if (m_stopEvent) {
+			break;
+		}
+		pthread_mutex_unlock(&m_mutex);
+		migrate();
+		forward();
+		pthread_mutex_lock(&m_mutex);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void IslandModel::neighbors(const uint32_t island, std::vector<uint32_t> & result) {
+	result.clear();
+	const uint32_t count = m_pools.size();
+	if (count == 1) {
+		return;
+	}
+	if (m_topology == RING) {
+		result.push_back((island + 1) % count);
+	} else if (m_topology == TORUS) {
+		// right and lower neighbors, wrapping around
+		const uint32_t row = island / m_cols;
+		const uint32_t col = island % m_cols;
+		const uint32_t right = row * m_cols + (col + 1) % m_cols;
+		const uint32_t down = ((row + 1) % m_rows) * m_cols + col;
+		if (right != island) {
+			result.push_back(right);
+		}
+		if (down != island && down != right) {
+			result.push_back(down);
+		}
+	} else {
+		boost::random::uniform_int_distribution<uint32_t> dist(0, count - 2);
+		const uint32_t other = dist(m_rng);
+		result.push_back(other < island ? other : other + 1);
+	}
+}
+
+void IslandModel::migrate() {
+	std::vector<uint32_t> targets;
+	for (uint32_t i = 0; i < m_pools.size(); ++i) {
+		neighbors(i, targets);
+		// the best solution of the island followed by random elite ones
+		std::vector<SolutionPool::Entry> migrants;
+		SolutionPool::Entry entry;
+		if (m_pools[i]->best(entry)) {
+			migrants.push_back(entry);
+			for (uint32_t k = 1; k < m_migrants; ++k) {
+				if (m_pools[i]->randomHighQuality(entry)) {
+					migrants.push_back(entry);
+				}
+			}
+		}
+		for (auto t = targets.begin(); t != targets.end(); ++t) {
+			SolutionPool & target = *m_pools[*t];
+			SolutionPool::Entry worst;
+			const bool available = target.worst(worst);
+			for (auto m = migrants.begin(); m != migrants.end(); ++m) {
+				// only send a best solution better than that of the neighbor, and elite solutions better than its worst
+				if (m == migrants.begin() ? m->obj() < target.bestObjective() : (!available || m->obj() < worst.obj())) {
+					target.push(m->obj(), *m->ptr(), m_sources[i]);
+					++m_migrantCount;
+				}
+			}
+		}
+	}
+	++m_migrationCount;
+	#ifdef TRACE_ISLANDS
+	std::cout << "Islands - Migration " << m_migrationCount << ":";
+	for (uint32_t i = 0; i < m_pools.size(); ++i) {
+		std::cout << " " << m_pools[i]->bestObjective();
+	}
+	std::cout << std::endl;
+	#endif
+}
+
+void IslandModel::forward() {
+	for (uint32_t i = 0; i < m_pools.size(); ++i) {
+		const uint64_t obj = m_pools[i]->bestObjective();
+		if (obj < m_forwarded[i] && obj < m_global.bestObjective()) {
+			SolutionPool::Entry entry;
+			if (m_pools[i]->best(entry)) {
+				m_global.push(entry.obj(), *entry.ptr(), m_sources[i]);
+				m_forwarded[i] = entry.obj();
+			}
+		}
+	}
+}
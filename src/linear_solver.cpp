@@ -1,64 +1,176 @@
 #include <linear_solver.h>
 
+#include "verifier.h"
 #include <iostream>
-#include <sstream> 
+#include <sstream>
 #include <vector>
+#include <algorithm>
+#include <stdexcept>
 
-
+//#define TRACE_LINEAR_SOLVER
 
 using namespace R12;
 using namespace std;
 
-ServiceID LinearSolver::pickService(){
-	boost::random::uniform_int_distribution<ServiceID> distribution(0, instance().services().size() - 1);
-
-	ServiceID service;
-	uint32_t times = 0;
-	const uint16_t MAX_TIMES = n_services;
-	do{
-		service = distribution(randomizer);
-		++times;
-		if(times % 1000 == 0)
-			cout<<times<<endl;
-	} while(instance().processesByService(service).size() <= 1 && times <= MAX_TIMES);
-	
-	return service;
+LinearSolver::Selection LinearSolver::parseSelection(const std::string & name) {
+	if (name.compare("service") == 0) {
+		return SERVICE;
+	} else if (name.compare("pair") == 0) {
+		return PAIR;
+	} else if (name.compare("neighborhood") == 0) {
+		return NEIGHBORHOOD;
+	} else if (name.compare("mixed") == 0) {
+		return MIXED;
+	} else {
+		throw std::runtime_error("Linear solver: unknown selection");
+	}
+}
+
+void LinearSolver::indexMachines() {
+	m_processesByMachine.assign(n_machines, vector<ProcessID>());
+	for (ProcessID p = 0; p < n_processes; ++p) {
+		m_processesByMachine[m_best->solution()[p]].push_back(p);
+	}
 }
 
+/*
+* Keeps at most size random processes among the candidates.
+*/
+void LinearSolver::sample(vector<ProcessID> & candidates, vector<ProcessID> & freeProcesses) {
+	for (uint32_t i = 0; i < candidates.size() && i < m_size; ++i) {
+		boost::random::uniform_int_distribution<uint32_t> distribution(i, candidates.size() - 1);
+		std::swap(candidates[i], candidates[distribution(randomizer)]);
+		freeProcesses.push_back(candidates[i]);
+	}
+}
+
+void LinearSolver::selectService(vector<ProcessID> & freeProcesses) {
+	boost::random::uniform_int_distribution<ServiceID> distribution(0, n_services - 1);
+	vector<ProcessID> candidates(instance().processesByService(distribution(randomizer)));
+	sample(candidates, freeProcesses);
+}
+
+void LinearSolver::selectPair(vector<ProcessID> & freeProcesses) {
+	if (n_machines < 2) {
+		return;
+	}
+	boost::random::uniform_int_distribution<MachineID> distribution(0, n_machines - 1);
+	MachineID m1 = distribution(randomizer);
+	MachineID m2;
+	do {
+		m2 = distribution(randomizer);
+	} while (m1 == m2);
+	vector<ProcessID> candidates(m_processesByMachine[m1]);
+	candidates.insert(candidates.end(), m_processesByMachine[m2].begin(), m_processesByMachine[m2].end());
+	sample(candidates, freeProcesses);
+}
+
+void LinearSolver::selectNeighborhood(vector<ProcessID> & freeProcesses) {
+	boost::random::uniform_int_distribution<NeighborhoodID> distribution(0, n_neighborhoods - 1);
+	const vector<MachineID> & machines = instance().machinesByNeighborhood(distribution(randomizer));
+	vector<ProcessID> candidates;
+	for (uint32_t i = 0; i < machines.size(); ++i) {
+		candidates.insert(candidates.end(), m_processesByMachine[machines[i]].begin(), m_processesByMachine[machines[i]].end());
+	}
+	sample(candidates, freeProcesses);
+}
+
+void LinearSolver::select(vector<ProcessID> & freeProcesses) {
+	freeProcesses.clear();
+	Selection selection = m_selection;
+	if (selection == MIXED) {
+		boost::random::uniform_int_distribution<uint32_t> distribution(SERVICE, NEIGHBORHOOD);
+		selection = static_cast<Selection>(distribution(randomizer));
+	}
+	switch (selection) {
+	case SERVICE:
+		selectService(freeProcesses);
+		break;
+	case PAIR:
+		selectPair(freeProcesses);
+		break;
+	default:
+		selectNeighborhood(freeProcesses);
+		break;
+	}
+}
 
 void LinearSolver::run() {
+	try {
+		SolutionInfo start(instance(), initial());
+		runFromSolution(start);
+	} catch (std::exception & e) {
+		signalError(e.what());
+		return;
+	}
+	signalCompletion();
+}
+
+void LinearSolver::runFromSolution(SolutionInfo & info) {
 	randomizer.seed(seed());
 
-	
+	m_size = std::max(1u, param<uint32_t>("size", 8));
+	m_selection = parseSelection(param<std::string>("select", "mixed"));
+	m_time = param<double>("time", 2.0);
+	m_gap = param<double>("gap", 0.0);
+	m_readPool = param<bool>("read_pool", false);
+
 	n_processes = instance().processes().size();
 	n_machines = instance().machines().size();
-	n_resources = instance().resources().size();
 	n_services = instance().services().size();
 	n_neighborhoods = instance().neighborhoodCount();
-	n_locations = instance().locationCount();
-	n_balanceCosts = instance().balanceCosts().size();
-
-
-#ifdef LS_DEBUG	
-	cout << "Linear solver started" << endl;
-	cout << "Processes: " << n_processes << endl;
-	cout << "Machines: " << n_machines << endl;
-	cout << "Resources: " << n_resources << endl;
-	cout << "Services: " << n_services << endl;
-	cout << "Locations: " << n_locations << endl;
-	cout << "Balance costs: " << n_balanceCosts << endl;
-#endif
-
-	ServiceID service = pickService();
-	LinearSolverSubProblem subProblem(instance(), initial(), service);
-	
-	subProblem.solve();
-	
-	//pool().push(sol.objective(), sol.solution());
-	
-	//signalCompletion();
-
-
 
+	m_best.reset(new SolutionInfo(info));
+	m_subProblem.reset(new LinearSolverSubProblem(instance(), initial()));
+	indexMachines();
+	pool().push(m_best->objective(), m_best->solution());
+
+	glp_term_out(GLP_OFF);
+	Verifier verifier;
+	vector<ProcessID> freeProcesses;
+	vector<MachineID> candidate;
+	#ifdef TRACE_LINEAR_SOLVER
+	uint64_t iterations = 0;
+	uint64_t improvements = 0;
+	#endif
+	while (!interrupted() && remaining() > 0) {
+		if (m_readPool && pool().bestObjective() < m_best->objective()) {
+			SolutionPool::Entry entry;
+			if (pool().best(entry) && entry.obj() < m_best->objective()) {
+				m_best.reset(new SolutionInfo(instance(), initial(), *entry.ptr()));
+				indexMachines();
+			}
+		}
+		select(freeProcesses);
+		if (freeProcesses.empty()) {
+			continue;
+		}
+		#ifdef TRACE_LINEAR_SOLVER
+		++iterations;
+		#endif
+		m_subProblem->update(*m_best, freeProcesses);
+		if (!m_subProblem->solve(std::min(m_time, remaining()), m_gap, flag(), candidate)) {
+			continue;
+		}
+		// the program is exact, but only solutions verified on the whole instance are kept
+		Verifier::Result result = verifier.verify(instance(), initial(), candidate);
+		if (result.feasible() && result.objective() < m_best->objective()) {
+			m_best.reset(new SolutionInfo(instance(), initial(), candidate));
+			indexMachines();
+			pool().push(m_best->objective(), m_best->solution());
+			#ifdef TRACE_LINEAR_SOLVER
+			++improvements;
+			cout << "Linear solver - Improved to " << m_best->objective() << " freeing " << freeProcesses.size() << " processes" << endl;
+			#endif
+		}
+		#ifdef LS_DEBUG
+		if (!result.feasible() || result.objective() != static_cast<uint64_t>(m_subProblem->predictedObjective() + 0.5)) {
+			cout << "Linear solver - Predicted " << m_subProblem->predictedObjective() << ", verified " << result.objective()
+				<< (result.feasible() ? "" : " (infeasible)") << endl;
+		}
+		#endif
+	}
+	#ifdef TRACE_LINEAR_SOLVER
+	cout << "Linear solver - " << improvements << " improvements in " << iterations << " iterations" << endl;
+	#endif
 }
-
@@ -1,502 +1,493 @@
 #include <linear_solver_sub_problem.h>
 #include <glpk.h>
+#include <algorithm>
+#include <limits>
+#include <iostream>
 
 using namespace std;
 using namespace R12;
 
+LinearSolverSubProblem::LinearSolverSubProblem(const Problem & instance, const std::vector<MachineID> & initial)
+: m_instance(instance), m_initial(initial), m_current(0), modeled_objective(0.0), predicted_objective(0.0), lp(0) {
+	n_free_variables = 0;
+	n_processes = instance.processes().size();
+	n_machines = instance.machines().size();
+	n_resources = instance.resources().size();
+	n_services = instance.services().size();
+	n_neighborhoods = instance.neighborhoodCount();
+	n_locations = instance.locationCount();
+	n_balanceCosts = instance.balanceCosts().size();
+	free_by_service.resize(n_services);
+	x_by_machine.resize(n_machines);
+	machine_rows.assign(std::max(n_machines, std::max(n_locations, n_neighborhoods)), 0);
+	initGLPK();
+	addMachineRows();
+}
+
+LinearSolverSubProblem::~LinearSolverSubProblem() {
+	if (lp != 0) {
+		glp_delete_prob(lp);
+	}
+}
+
 /*
-* Returns the index of x_ij variable in the problem matrix. Process and machine values are assumed to start from 1
+* Rows of the machines: capacity (transient usage included for transient resources), load cost and balance cost.
+* Columns of the costs: load cost and balance cost of each machine, service move cost.
 */
-uint32_t LinearSolverSubProblem::getMatrixIndexForVariable(uint32_t process_index, MachineID machine){
-#ifdef LS_DEBUG
-	CHECK(process_index < n_free_variables);
-	CHECK(process_index >= 0 );	
-	CHECK(machine <= n_machines);
-	CHECK(machine > 0 );
-#endif
-	return process_index * n_machines + machine;
-	}
+uint32_t LinearSolverSubProblem::capacityRow(MachineID machine, ResourceID resource) const {
+	return 1 + machine * n_resources + resource;
+}
+
+uint32_t LinearSolverSubProblem::loadCostRow(MachineID machine, ResourceID resource) const {
+	return 1 + n_machines * n_resources + machine * n_resources + resource;
+}
+
+uint32_t LinearSolverSubProblem::balanceCostRow(MachineID machine, uint32_t balanceCost) const {
+	return 1 + 2 * n_machines * n_resources + machine * n_balanceCosts + balanceCost;
+}
+
+uint32_t LinearSolverSubProblem::loadCostCol(MachineID machine, ResourceID resource) const {
+	return 1 + machine * n_resources + resource;
+}
+
+uint32_t LinearSolverSubProblem::balanceCostCol(MachineID machine, uint32_t balanceCost) const {
+	return 1 + n_machines * n_resources + machine * n_balanceCosts + balanceCost;
+}
+
+uint32_t LinearSolverSubProblem::serviceMoveCostCol() const {
+	return 1 + n_machines * n_resources + n_machines * n_balanceCosts;
+}
 
 /*
-* Returns a vector containing processes of the given service.
-* Services starts with index 0.
+* Requirement of a free process in the capacity row of a machine: a transient resource is already counted on the initial machine
 */
-void LinearSolverSubProblem::getProcessesOfService(ServiceID service, std::vector<ProcessID> & processes){
-#ifdef LS_DEBUG
-	CHECK(service >= 0);
-	CHECK(service < n_services);
-#endif
-	for(ProcessID process = 0; process < n_processes; process++){
-		if(instance().processes()[process].service() == service)
-			processes.push_back(process);
+double LinearSolverSubProblem::capacityCoefficient(uint32_t process_index, MachineID machine, ResourceID resource) const {
+	ProcessID process = m_freeProcesses[process_index];
+	if(instance().resources()[resource].transient() && initial()[process] == machine)
+		return 0.0;
+	return instance().processes()[process].requirement(resource);
+}
+
+uint32_t LinearSolverSubProblem::fixedOnMachine(ServiceID service, MachineID machine) const {
+	uint32_t count = m_current->machinePresence(service, machine);
+	for (uint32_t i = 0; i < free_by_service[service].size(); i++) {
+		if (m_current->solution()[m_freeProcesses[free_by_service[service][i]]] == machine)
+			--count;
+	}
+	return count;
+}
+
+uint32_t LinearSolverSubProblem::fixedInLocation(ServiceID service, LocationID location) const {
+	uint32_t count = m_current->locationPresence(service, location);
+	for (uint32_t i = 0; i < free_by_service[service].size(); i++) {
+		if (instance().machines()[m_current->solution()[m_freeProcesses[free_by_service[service][i]]]].location() == location)
+			--count;
 	}
-	CHECK(processes.size() > 0);
+	return count;
 }
 
+uint32_t LinearSolverSubProblem::fixedInNeighborhood(ServiceID service, NeighborhoodID neighborhood) const {
+	uint32_t count = m_current->neighborhoodPresence(service, neighborhood);
+	for (uint32_t i = 0; i < free_by_service[service].size(); i++) {
+		if (instance().machines()[m_current->solution()[m_freeProcesses[free_by_service[service][i]]]].neighborhood() == neighborhood)
+			--count;
+	}
+	return count;
+}
+
+uint32_t LinearSolverSubProblem::fixedMoved(ServiceID service) const {
+	uint32_t count = m_current->movedProcesses(service);
+	for (uint32_t i = 0; i < free_by_service[service].size(); i++) {
+		if (m_current->isMoved(m_freeProcesses[free_by_service[service][i]]))
+			--count;
+	}
+	return count;
+}
+
+void LinearSolverSubProblem::addEntry(uint32_t row, uint32_t col, double val) {
+	if (val != 0.0) {
+		ia.push_back(row);
+		ja.push_back(col);
+		ar.push_back(val);
+	}
+}
+
+uint32_t LinearSolverSubProblem::addRow(int type, double lb, double ub) {
+	uint32_t row = glp_add_rows(lp, 1);
+	glp_set_row_bnds(lp, row, type, lb, ub);
+	return row;
+}
+
+void LinearSolverSubProblem::setBaseRowBounds(uint32_t row, int type, double lb, double ub) {
+	double bound = type == GLP_LO ? lb : ub;
+	// bounds start as NaN, which compares different from any value
+	if (!(base_row_bounds[row] == bound)) {
+		glp_set_row_bnds(lp, row, type, lb, ub);
+		base_row_bounds[row] = bound;
+	}
+}
 
 /*
-* Returns a vector containing machines of the given location
-* Locations starts with index 0
-*/	
-void LinearSolverSubProblem::getMachinesOfLocations(LocationID location, vector<MachineID>& machines){
-#ifdef LS_DEBUG
-	CHECK(location > 0);
-	CHECK(location <= n_locations);
-#endif
+* Adds the rows and the cost columns of the machines with the entries of the cost columns
+*/
+void LinearSolverSubProblem::addMachineRows(){
+	base_rows = 2 * n_machines * n_resources + n_machines * n_balanceCosts;
+	base_cols = n_machines * n_resources + n_machines * n_balanceCosts + 1;
+	glp_add_rows(lp, base_rows);
+	glp_add_cols(lp, base_cols);
+	base_row_bounds.assign(base_rows + 1, std::numeric_limits<double>::quiet_NaN());
+	ia.assign(1, 0);
+	ja.assign(1, 0);
+	ar.assign(1, 0.0);
 
 	for(MachineID machine = 0; machine < n_machines; machine++){
-		if(instance().machines()[machine].location() == location)
-			machines.push_back(machine);
+		// lc_rm >= usage of r on m - safety capacity of r on m
+		for(ResourceID resource = 0; resource < n_resources; resource++){
+			uint32_t lc_index = loadCostCol(machine, resource);
+			glp_set_col_kind(lp, lc_index, GLP_CV);
+			glp_set_col_bnds(lp, lc_index, GLP_LO, 0.0, 0.0);
+			glp_set_obj_coef(lp, lc_index, instance().resources()[resource].weightLoadCost());
+			addEntry(loadCostRow(machine, resource), lc_index, -1.0);
+		}
+		// bc_bm >= target * available r1 on m - available r2 on m
+		for(uint32_t balanceCost = 0; balanceCost < n_balanceCosts; balanceCost++){
+			uint32_t bc_index = balanceCostCol(machine, balanceCost);
+			glp_set_col_kind(lp, bc_index, GLP_CV);
+			glp_set_col_bnds(lp, bc_index, GLP_LO, 0.0, 0.0);
+			glp_set_obj_coef(lp, bc_index, instance().balanceCosts()[balanceCost].weight());
+			addEntry(balanceCostRow(machine, balanceCost), bc_index, 1.0);
+		}
 	}
-#ifdef LS_DEBUG
-	//CHECK(machines.size() > 0);
-#endif
+	// smc >= moved processes of each service
+	glp_set_col_kind(lp, serviceMoveCostCol(), GLP_CV);
+	glp_set_obj_coef(lp, serviceMoveCostCol(), instance().weightServiceMoveCost());
+	base_entries = ia.size() - 1;
 }
 
+/*
+* Sets the bounds of the rows of the machines from the fixed usage, only where they changed
+*/
+void LinearSolverSubProblem::updateMachineBounds(){
+	for(MachineID machine = 0; machine < n_machines; machine++){
+		const Machine & m = instance().machines()[machine];
+		for(ResourceID resource = 0; resource < n_resources; resource++){
+			double capacity = static_cast<double>(m.capacity(resource)) - fixed_usage[machine][resource];
+			if(instance().resources()[resource].transient())
+				capacity -= fixed_transient[machine][resource];
+			setBaseRowBounds(capacityRow(machine, resource), GLP_UP, 0.0, capacity);
+			double safety = static_cast<double>(m.safetyCapacity(resource)) - fixed_usage[machine][resource];
+			setBaseRowBounds(loadCostRow(machine, resource), GLP_UP, 0.0, safety);
+		}
+		for(uint32_t balanceCost = 0; balanceCost < n_balanceCosts; balanceCost++){
+			const BalanceCost & b = instance().balanceCosts()[balanceCost];
+			double available1 = static_cast<double>(m.capacity(b.resource1())) - fixed_usage[machine][b.resource1()];
+			double available2 = static_cast<double>(m.capacity(b.resource2())) - fixed_usage[machine][b.resource2()];
+			setBaseRowBounds(balanceCostRow(machine, balanceCost), GLP_LO, b.target() * available1 - available2, 0.0);
+		}
+	}
+}
 
 /*
-* Adds bin-packing constraints
+* Removes the variables and the rows of the previous free processes
 */
-void LinearSolverSubProblem::addPlacementConstraints(){
-	// adding variables x_ij
-	glp_add_cols(lp, n_free_variables * n_machines);
-	last_used_row = glp_add_rows(lp, n_free_variables);
-	
-	for(uint32_t free_process_index = 0; free_process_index <  n_free_variables; free_process_index++){
-		
-		int* col_indexes = new int[1 + n_machines];
-		double* col_vals = new double[1 + n_machines];
-		
-		for(MachineID machine = 1; machine <= n_machines; machine++){
-			int var_index = getMatrixIndexForVariable(free_process_index, machine);
-			
-			// x_ij is a binary variable
-			glp_set_col_kind(lp, var_index, GLP_BV);
-			col_indexes[machine] = var_index;			
-			col_vals[machine] = 1.0;
+void LinearSolverSubProblem::clearFreeProcesses(){
+	for(uint32_t i = 0; i < n_free_variables; i++){
+		free_by_service[instance().processes()[m_freeProcesses[i]].service()].clear();
+		for(uint32_t k = 0; k < x_machines[i].size(); k++){
+			x_by_machine[x_machines[i][k]].clear();
 		}
-		
-		int row = free_process_index + 1;
-		glp_set_mat_row(lp, row, n_machines, col_indexes, col_vals);
-		glp_set_row_bnds(lp, row, GLP_FX, 1.0, 0.0);
-		delete[] col_indexes;
-		delete[] col_vals;
 	}
+	uint32_t rows = glp_get_num_rows(lp);
+	if(rows > base_rows){
+		vector<int> num(1, 0);
+		for(uint32_t row = base_rows + 1; row <= rows; row++)
+			num.push_back(row);
+		glp_del_rows(lp, rows - base_rows, &num[0]);
+	}
+	uint32_t cols = glp_get_num_cols(lp);
+	if(cols > base_cols){
+		vector<int> num(1, 0);
+		for(uint32_t col = base_cols + 1; col <= cols; col++)
+			num.push_back(col);
+		glp_del_cols(lp, cols - base_cols, &num[0]);
+	}
+	ia.resize(base_entries + 1);
+	ja.resize(base_entries + 1);
+	ar.resize(base_entries + 1);
 }
 
-bool LinearSolverSubProblem::isFreeProcess(ProcessID process){
-	for(ProcessID p = 0; p < n_free_variables; p++){
-		if(m_freeProcesses[p] == process)
-			return true;
+/*
+* Adds the x_ij variables, only for the machines where the process fits alone, with their move costs, and the assignment constraints
+*/
+void LinearSolverSubProblem::addPlacementConstraints(){
+	double weightProcess = instance().weightProcessMoveCost();
+	double weightMachine = instance().weightMachineMoveCost();
+	x_machines.assign(n_free_variables, vector<MachineID>());
+	x_first_col.assign(n_free_variables, 0);
+
+	for(uint32_t free_process_index = 0; free_process_index < n_free_variables; free_process_index++){
+		ProcessID process = m_freeProcesses[free_process_index];
+		ServiceID service = instance().processes()[process].service();
+		vector<MachineID> & machines = x_machines[free_process_index];
+		for(MachineID machine = 0; machine < n_machines; machine++){
+			if(fixedOnMachine(service, machine) > 0)
+				continue;
+			bool fits = true;
+			for(ResourceID resource = 0; resource < n_resources && fits; resource++){
+				fits = capacityCoefficient(free_process_index, machine, resource) <= base_row_bounds[capacityRow(machine, resource)];
+			}
+			if(fits)
+				machines.push_back(machine);
+		}
+
+		MachineID initialMachine = initial()[process];
+		double processCost = weightProcess * instance().processes()[process].movementCost();
+		uint32_t first_col = glp_add_cols(lp, machines.size());
+		x_first_col[free_process_index] = first_col;
+		uint32_t row = addRow(GLP_FX, 1.0, 1.0);
+		for(uint32_t k = 0; k < machines.size(); k++){
+			// x_ij is a binary variable
+			uint32_t col = first_col + k;
+			glp_set_col_kind(lp, col, GLP_BV);
+			double cost = weightMachine * instance().machineMoveCost(initialMachine, machines[k]);
+			if(machines[k] != initialMachine)
+				cost += processCost;
+			glp_set_obj_coef(lp, col, cost);
+			addEntry(row, col, 1.0);
+			x_by_machine[machines[k]].push_back(std::make_pair(free_process_index, col));
+		}
+
+		if(m_current->isMoved(process))
+			modeled_objective += processCost;
+		modeled_objective += weightMachine * instance().machineMoveCost(initialMachine, m_current->solution()[process]);
 	}
-	return false;
 }
 
 /*
- * Capacity constraint for each machine
+ * Capacity constraint for each machine and resource
  */
 void LinearSolverSubProblem::addCapacityConstraints(){
-		
-	// add capacity constraints
-	last_used_row = glp_add_rows(lp, n_resources * n_machines);
-	for(ResourceID resource = 1; resource <= n_resources ; resource++){
-		for(MachineID machine = 1; machine <= n_machines; machine++){
-			int* col_indexes = new int[1 + n_free_variables];
-			double* col_vals = new double[1 + n_free_variables];
-			
-			for(uint32_t free_process_index = 0; free_process_index < n_free_variables; free_process_index++){
-				col_indexes[free_process_index + 1] = getMatrixIndexForVariable(free_process_index, machine);
-				ProcessID processID = m_freeProcesses[free_process_index];
-				col_vals[free_process_index + 1] = instance().processes()[processID].requirement(resource - 1);		
+	for(MachineID machine = 0; machine < n_machines; machine++){
+		const vector<pair<uint32_t, uint32_t>> & vars = x_by_machine[machine];
+		for(uint32_t k = 0; k < vars.size(); k++){
+			for(ResourceID resource = 0; resource < n_resources; resource++){
+				addEntry(capacityRow(machine, resource), vars[k].second, capacityCoefficient(vars[k].first, machine, resource));
 			}
-			
-			glp_set_mat_row(lp, last_used_row, n_free_variables, col_indexes, col_vals);
-			glp_set_row_bnds(lp, last_used_row, GLP_UP, 0.0, reduced_capacities[machine - 1][resource - 1]);
-			++last_used_row;
-			delete[] col_indexes;
-			delete[] col_vals;
 		}
 	}
 }
 
+/*
+ * Processes of the same service cannot be placed on the same machine:
+ * machines hosting a fixed process of the service have no variables, the others host at most one free process of the service
+ */
 void LinearSolverSubProblem::addConflictConstraints(){
-	// add conflict constraint
-	// i.e. processes of the same service anno be placed on the same machine
-	last_used_row = glp_add_rows(lp, n_machines);
-
-	for(MachineID machine = 1; machine <= n_machines; machine++){
-		int* col_indexes = new int[1 + n_free_variables];
-		double* col_vals = new double[1 + n_free_variables];
-
-		for(ProcessID free_process_index = 0; free_process_index < n_free_variables; free_process_index++){
-			col_indexes[free_process_index + 1] = getMatrixIndexForVariable(free_process_index, machine);
-			col_vals[free_process_index + 1] = 1.0;
+	for(ServiceID service = 0; service < n_services; service++){
+		const vector<uint32_t> & free = free_by_service[service];
+		if(free.size() < 2)
+			continue;
+		vector<MachineID> touched;
+		for(uint32_t i = 0; i < free.size(); i++){
+			const vector<MachineID> & machines = x_machines[free[i]];
+			for(uint32_t k = 0; k < machines.size(); k++){
+				if(machine_rows[machines[k]]++ == 0)
+					touched.push_back(machines[k]);
+			}
+		}
+		for(uint32_t t = 0; t < touched.size(); t++){
+			machine_rows[touched[t]] = machine_rows[touched[t]] > 1 ? addRow(GLP_UP, 0.0, 1.0) : 0;
 		}
-		glp_set_mat_row(lp, last_used_row, n_free_variables, col_indexes, col_vals);
-		glp_set_row_bnds(lp, last_used_row, GLP_UP, 0.0, 1.0);
-		last_used_row++;
-		delete[]  col_indexes;
-		delete[]  col_vals;
+		for(uint32_t i = 0; i < free.size(); i++){
+			const vector<MachineID> & machines = x_machines[free[i]];
+			for(uint32_t k = 0; k < machines.size(); k++){
+				if(machine_rows[machines[k]] != 0)
+					addEntry(machine_rows[machines[k]], x_first_col[free[i]] + k, 1.0);
+			}
 		}
+		for(uint32_t t = 0; t < touched.size(); t++){
+			machine_rows[touched[t]] = 0;
+		}
+	}
 }
 
-
+/*
+ * Entries of the free processes in the load cost rows
+ */
 void LinearSolverSubProblem::addLoadCostObjectiveFunction(){
-	//lc_rj
-	last_used_col = glp_add_cols(lp, n_machines * n_resources);
-	
-	for(ResourceID resource = 1; resource <= n_resources; resource++){
-		double resource_weight = instance().resources()[resource - 1].weightLoadCost();
-		
-		for(MachineID machine = 1; machine <= n_machines; machine++){
-			uint32_t lc_index = last_used_col++;
-
-			glp_set_col_kind(lp, lc_index, GLP_CV);
-			glp_set_col_bnds(lp, lc_index, GLP_LO, 0.0, 0.0);
-			
-			uint32_t size = n_free_variables + 1;
-			int* col_indexes = new int[1 + size];
-			double* col_vals = new double[1 + size];
-			
-			// compute utilization for machine m and resource r (sum over all processes)
-			for(ProcessID free_process_index = 0; free_process_index < n_free_variables; free_process_index++){
-				col_indexes[free_process_index + 1] = getMatrixIndexForVariable(free_process_index, machine);
-				col_vals[free_process_index + 1] = instance().processes()[free_process_index].requirement(resource - 1);
+	for(MachineID machine = 0; machine < n_machines; machine++){
+		const Machine & m = instance().machines()[machine];
+		const vector<pair<uint32_t, uint32_t>> & vars = x_by_machine[machine];
+		for(ResourceID resource = 0; resource < n_resources; resource++){
+			for(uint32_t k = 0; k < vars.size(); k++){
+				ProcessID process = m_freeProcesses[vars[k].first];
+				addEntry(loadCostRow(machine, resource), vars[k].second, instance().processes()[process].requirement(resource));
 			}
-			// -LC_rm
-			col_indexes[size] = lc_index;
-			col_vals[size] = -1.0;
-
-			uint32_t row = glp_add_rows(lp, 1);
-			glp_set_mat_row(lp, row, size, col_indexes, col_vals);
-			Machine m = instance().machines()[machine - 1];
-			double row_bound =  m.safetyCapacity(resource - 1) + m.capacity(resource - 1) - reduced_capacities[machine - 1][resource - 1];
-			glp_set_row_bnds(lp, row, GLP_UP, 0.0, row_bound);
-			glp_set_obj_coef(lp, lc_index, resource_weight);
-			delete[] col_indexes;
-			delete[] col_vals;
+			modeled_objective += static_cast<double>(instance().resources()[resource].weightLoadCost())
+				* _computeLoadCost(m_current->usage(machine, resource), m.safetyCapacity(resource));
 		}
 	}
 }
 
+/*
+ * Each service must use at least spreadMin locations: binary variables mark the locations without fixed processes
+ * which are used by free processes
+ */
 void LinearSolverSubProblem::addSpreadConstraints(){
-	// add spread constraints
-	// slack variable (i.e. processes of s in location l)
-	last_used_col = glp_add_cols(lp, n_locations);
-	last_used_row = glp_add_rows(lp, n_locations);
-	
-	for(LocationID location = 1; location <= n_locations; location++){
-		vector<MachineID> machinesOfLocation;
-		getMachinesOfLocations(location, machinesOfLocation);
-		int rowSize = 1 + n_free_variables * machinesOfLocation.size(); /* + 1 */
-		int* col_indexes = new int[1 + rowSize];
-		double* col_vals = new double[1 + rowSize];
-		int column_index = 1;
-		for(ProcessID process = 0; process < n_free_variables; process++){
-			for(MachineID machine = 1; machine <= machinesOfLocation.size(); machine++){
-				col_indexes[column_index] = getMatrixIndexForVariable(process, machine);
-				col_vals[column_index] = 1.0;
-				column_index++;
+	for(ServiceID service = 0; service < n_services; service++){
+		const vector<uint32_t> & free = free_by_service[service];
+		if(free.empty())
+			continue;
+		uint32_t fixed_locations = 0;
+		vector<LocationID> open_locations;
+		for(LocationID location = 0; location < n_locations; location++){
+			if(fixedInLocation(service, location) > 0)
+				++fixed_locations;
+			else
+				open_locations.push_back(location);
+		}
+		uint32_t spread_min = instance().services()[service].spreadMin();
+		if(fixed_locations >= spread_min)
+			continue;
+
+		// y_l <= processes of the service in l
+		uint32_t first_col = glp_add_cols(lp, open_locations.size());
+		uint32_t spread_row = addRow(GLP_LO, spread_min - fixed_locations, 0.0);
+		for(uint32_t l = 0; l < open_locations.size(); l++){
+			uint32_t y_index = first_col + l;
+			glp_set_col_kind(lp, y_index, GLP_BV);
+			machine_rows[open_locations[l]] = addRow(GLP_UP, 0.0, 0.0);
+			addEntry(machine_rows[open_locations[l]], y_index, 1.0);
+			addEntry(spread_row, y_index, 1.0);
+		}
+		for(uint32_t i = 0; i < free.size(); i++){
+			const vector<MachineID> & machines = x_machines[free[i]];
+			for(uint32_t k = 0; k < machines.size(); k++){
+				uint32_t row = machine_rows[instance().machines()[machines[k]].location()];
+				if(row != 0)
+					addEntry(row, x_first_col[free[i]] + k, -1.0);
 			}
 		}
-		col_indexes[column_index] = last_used_col;
-		col_vals[column_index] = -1.0;
-		glp_set_mat_row(lp, last_used_row, rowSize, col_indexes, col_vals);
-		glp_set_row_bnds(lp, last_used_row, GLP_FX, 0.0, 0.0);
-		glp_set_col_bnds(lp, last_used_col, GLP_LO, 0.0, 0.0);
-		glp_set_col_kind(lp, last_used_col, GLP_CV);
-		last_used_row++;
-		last_used_col++;
-		delete[] col_indexes;
-		delete[] col_vals;
-	}	
-
-
-	//add variables to transform the slack variable to a binary variable
-	uint32_t services_locations = n_locations;
-	last_used_col = glp_add_cols(lp, services_locations);
-	int sl_start_index = last_used_col;
-
-	for(LocationID location = 1; location <= n_locations; location++){
-			glp_set_col_kind(lp, last_used_col, GLP_BV);
-			int* ind1 = new int[1 + 2];
-			double* vals1 = new double[1 + 2];
-			ind1[1] = last_used_col - services_locations;
-			vals1[1] = -n_free_variables;
-			ind1[2] = last_used_col;
-			vals1[2] = 1.0;
-			uint32_t last_row = glp_add_rows(lp, 1);
-			glp_set_mat_row(lp, last_row, 2, ind1, vals1);
-			glp_set_row_bnds(lp, last_row, GLP_LO, 0.0, 0.0);
-			
-			int* ind2 = new int[1 + 2];
-			double* vals2 = new double[1 + 2];
-			ind2[1] = last_used_col - services_locations;
-			vals2[1] = 1.0;
-			ind2[2] = last_used_col;
-			vals2[2] = -n_free_variables;
-			last_row = glp_add_rows(lp, 1);
-			glp_set_mat_row(lp, last_row, 2, ind2, vals2);
-			glp_set_row_bnds(lp, last_row, GLP_LO, 0.0, 0.0);			
-			last_used_col++;
-
-			delete[] ind1;
-			delete[] vals1;
-			delete[] ind2;
-			delete[] vals2;		
-	}
-	
-
-	int* ind = new int[1 + n_locations];
-	double* vals = new double[1 + n_locations];
-		
-	for(LocationID location = 1; location <= n_locations; location++){
-		ind[location] = sl_start_index + (location - 1);
-		vals[location] = 1.0;
+		for(uint32_t l = 0; l < open_locations.size(); l++){
+			machine_rows[open_locations[l]] = 0;
+		}
 	}
-	int row = glp_add_rows(lp, 1);
-	glp_set_mat_row(lp, row, n_locations, ind, vals);
-	glp_set_row_bnds(lp, row, GLP_LO, instance().services()[lockedService()].spreadMin(), 0.0);
-	delete[] ind;
-	delete[] vals;
-
 }
 
 
 void LinearSolverSubProblem::addDependencyConstraints(){
-	// get dependencies for the locked service
-	auto deps = boost::out_edges(lockedService(),  instance().dependency());
-	if(deps.first == deps.second)
-		return;
-
-	// for each service dependent on the previous service
-	for (auto depItr = deps.first; depItr != deps.second; ++depItr) {
-		// dep is the service that need to be present in any neighborhood used by service s
-		ServiceID dep = boost::target(*depItr,  instance().dependency());
-		addDependecyConstraintBetweenServices(lockedService(), dep);
+	const Problem::DependencyGraph & dep = instance().dependency();
+	for(ServiceID service = 0; service < n_services; service++){
+		if(free_by_service[service].empty())
+			continue;
+		// services the free processes depend on
+		auto out = boost::out_edges(service, dep);
+		for (auto itr = out.first; itr != out.second; ++itr) {
+			addDependecyConstraintBetweenServices(service, boost::target(*itr, dep));
+		}
+		// services depending on the free processes, unless already handled above
+		auto in = boost::in_edges(service, dep);
+		for (auto itr = in.first; itr != in.second; ++itr) {
+			ServiceID source = boost::source(*itr, dep);
+			if(free_by_service[source].empty())
+				addDependecyConstraintBetweenServices(source, service);
+		}
 	}
 }
 
-void LinearSolverSubProblem::addDependecyConstraintBetweenServices(ServiceID &service1, ServiceID &service2){
-	// for each neighborhood
-	CHECK(service1 >= 0);
-	CHECK(service1 < n_services);
-	CHECK(service2 >= 0);
-	CHECK(service2 < n_services);
-	      
-	vector<ProcessID> processesOfService1 = freeProcesses(); 
-	vector<ProcessID> processesOfService2;
-	getProcessesOfService(service1, processesOfService1);
-	getProcessesOfService(service2, processesOfService2);
-
-//	for(int i=0;i<processesOfService1.size();i++){
-	//	cout<< processesOfService1[i]<<endl;
-	//}
-	for(NeighborhoodID neighborhood = 1; neighborhood <= n_neighborhoods; neighborhood++){
-		vector<MachineID> machinesInNeighbor = instance().machinesByNeighborhood(neighborhood - 1);
-		
-		uint32_t size = machinesInNeighbor.size() * n_free_variables;
-
-		int* ind = new int[1 + size];
-		double* vals = new double[1 + size];
-		uint32_t index = 1;
-
-		// for all processes of the given service
-		for(ProcessID process = 0; process < n_free_variables; process++){
-			for(MachineID machine = 1; machine <= machinesInNeighbor.size(); machine++){
-				int p = processesOfService1[process];
-				MachineID m = machinesInNeighbor[machine - 1] + 1;
-				ind[index] = getMatrixIndexForVariable(process, m);
-				vals[index] = 1.0;
-				index++;
-			}
+/*
+ * service1 depends on service2: in each neighborhood without fixed processes of service2,
+ * a process of service1 requires a free process of service2
+ */
+void LinearSolverSubProblem::addDependecyConstraintBetweenServices(ServiceID service1, ServiceID service2){
+	const vector<uint32_t> & free1 = free_by_service[service1];
+	const vector<uint32_t> & free2 = free_by_service[service2];
+
+	// variables of the free processes of service2 by neighborhood
+	vector<vector<uint32_t>> cols2(n_neighborhoods);
+	for(uint32_t i = 0; i < free2.size(); i++){
+		const vector<MachineID> & machines = x_machines[free2[i]];
+		for(uint32_t k = 0; k < machines.size(); k++){
+			cols2[instance().machines()[machines[k]].neighborhood()].push_back(x_first_col[free2[i]] + k);
 		}
-		
-		bool isDependentServiceInNeighborhood = false;
-		for(ProcessID process = 0; process < processesOfService2.size(); process++){
-			ProcessID p = processesOfService2[process];
-			MachineID m = initial()[p];
-
-			for(MachineID machine = 1; machine <= machinesInNeighbor.size(); machine++){
-				if(machine - 1 == m)
-					isDependentServiceInNeighborhood = true;
-			}	
+	}
+	vector<bool> open(n_neighborhoods);
+	for(NeighborhoodID neighborhood = 0; neighborhood < n_neighborhoods; neighborhood++){
+		open[neighborhood] = fixedInNeighborhood(service2, neighborhood) == 0;
+		// a fixed process of service1 in the neighborhood requires one of the free processes of service2
+		if(open[neighborhood] && fixedInNeighborhood(service1, neighborhood) > 0){
+			uint32_t row = addRow(GLP_LO, 1.0, 0.0);
+			for(uint32_t j = 0; j < cols2[neighborhood].size(); j++)
+				addEntry(row, cols2[neighborhood][j], 1.0);
 		}
-		
-		int row = glp_add_rows(lp, 1);
-		glp_set_mat_row(lp, row, size, ind, vals);
-		double upper_bound = isDependentServiceInNeighborhood ? n_free_variables : 0;
-		glp_set_row_bnds(lp, row, GLP_UP, 0.0, upper_bound);
-		delete[] ind;
-		delete[] vals;
-	} // neighbors
-
-}
-
-void LinearSolverSubProblem::addTransientUsageConstraints(){
-	
-	for(ResourceID resource = 1; resource <= n_resources; resource++){
-		if(!instance().resources()[resource - 1].transient())
-			continue;
+	}
 
-		// transient resource
-		for(MachineID machine = 1; machine <= n_machines; machine++){			
-			
-			double capacityLimit = (double) instance().machines()[machine - 1].capacity(resource - 1);	
-			int* ind = new int[1 + n_free_variables];
-			double* vals = new double[1 + n_free_variables];
-			uint32_t index = 1;
-			for(ProcessID process = 0; process < n_free_variables; process++){
-				ind[index] = getMatrixIndexForVariable(process, machine);
-				uint32_t resourceRequirement = instance().processes()[process].requirement(resource - 1);			
-				if(initial()[process] == (machine - 1)){
-					capacityLimit -= resourceRequirement;
-					vals[index] = 0.0;
-				} else {
-					vals[index] = resourceRequirement;
-				}
-				index++;
-				}
-			int row = glp_add_rows(lp, 1);
-			glp_set_mat_row(lp, row, n_free_variables, ind, vals);
-			glp_set_row_bnds(lp, row, GLP_UP, 0.0,  capacityLimit);
-			delete[] ind;
-			delete[] vals;
+	// a free process of service1 in the neighborhood requires one of the free processes of service2
+	for(uint32_t i = 0; i < free1.size(); i++){
+		const vector<MachineID> & machines = x_machines[free1[i]];
+		for(uint32_t k = 0; k < machines.size(); k++){
+			NeighborhoodID neighborhood = instance().machines()[machines[k]].neighborhood();
+			if(!open[neighborhood])
+				continue;
+			if(machine_rows[neighborhood] == 0){
+				machine_rows[neighborhood] = addRow(GLP_UP, 0.0, 0.0);
+				for(uint32_t j = 0; j < cols2[neighborhood].size(); j++)
+					addEntry(machine_rows[neighborhood], cols2[neighborhood][j], -1.0);
+			}
+			addEntry(machine_rows[neighborhood], x_first_col[free1[i]] + k, 1.0);
+		}
+		for(uint32_t k = 0; k < machines.size(); k++){
+			machine_rows[instance().machines()[machines[k]].neighborhood()] = 0;
 		}
 	}
 }
 
-uint32_t LinearSolverSubProblem::addProcessMoveCost(){
-	//adding variable indicating wheter the given process was moved
-	uint32_t init_col = glp_add_cols(lp, n_processes);
-	uint32_t last_col = init_col;
-
-	for(ProcessID process = 1; process <= n_processes; process++){
-		glp_set_col_kind(lp, last_col, GLP_BV);
-		uint32_t initialMachine = initial()[process - 1] + 1;
-		uint32_t x_ij_col = getMatrixIndexForVariable(process, initialMachine);
-		int* ind = new int[1 + 2];
-		double* vals = new double[1 + 2];
-		ind[1] = x_ij_col;
-		vals[1] = 1.0;
-		ind[2] = last_col;
-		vals[2] = 1.0;
-		uint32_t row = glp_add_rows(lp, 1);
-		glp_set_mat_row(lp, row, 2, ind, vals);
-		glp_set_row_bnds(lp, row, GLP_LO, 1.0, 0.0);
-		double weight = instance().weightProcessMoveCost() * instance().processes()[process - 1].movementCost();
-		glp_set_obj_coef(lp, last_col, weight);
-		last_col++;
-
-		delete[] ind;
-		delete[] vals;
+/*
+ * smc >= moved processes of each service
+ */
+void LinearSolverSubProblem::addServiceMoveCost(){
+	uint32_t smc_col = serviceMoveCostCol();
+	uint32_t lower_bound = 0;
+	for(ServiceID service = 0; service < n_services; service++){
+		lower_bound = std::max(lower_bound, fixedMoved(service));
 	}
+	glp_set_col_bnds(lp, smc_col, GLP_LO, lower_bound, 0.0);
 
-	return init_col;
-}
-
-
-
-void LinearSolverSubProblem::addServiceMoveCost(uint32_t startColForProcessMove){
-	uint32_t last_col = glp_add_cols(lp, 1);
-	glp_set_col_kind(lp, last_col, GLP_CV);
-	glp_set_col_bnds(lp, last_col, GLP_LO, 0.0, 0.0);
-	
-	for(ServiceID service = 1; service <= n_services; service++){
-		vector<ProcessID> processesOfService;
-		getProcessesOfService(service - 1, processesOfService);
-		int* ind = new int[1 + processesOfService.size() + 1];
-		double* vals = new double[1 + processesOfService.size() + 1];
-		uint32_t index = 1;
-		// for each process belonging to service
-		for(vector<ProcessID>::iterator it = processesOfService.begin(); it != processesOfService.end(); ++it){
-			ind[index] = startColForProcessMove + (*it);
-			vals[index] = 1.0;
-			index++;
-		}
-		ind[index] = last_col;
-		vals[index] = -1.0;
-		uint32_t row = glp_add_rows(lp, 1);
-		glp_set_mat_row(lp, row, processesOfService.size() + 1, ind, vals);
-		glp_set_row_bnds(lp, row, GLP_UP, 0.0, 0.0);
-		delete[] ind;
-		delete[] vals;
-	}
-	glp_set_obj_coef(lp, last_col, instance().weightServiceMoveCost());
-}
-
-void LinearSolverSubProblem::addMachineMoveCost(){
-	uint32_t last_col = glp_add_cols(lp, 1);
-	glp_set_col_kind(lp, last_col, GLP_CV);
-	glp_set_col_bnds(lp, last_col, GLP_LO, 0.0, 0.0);
-	
-	uint32_t size = n_free_variables * n_machines + 1;
-	int* ind = new int[1 + size];
-	double* vals = new double[1 + size];
-	uint32_t index = 1;
-	for(ProcessID process = 0; process < n_free_variables; process++){
-		MachineID initialMachine = initial()[process] + 1;
-		for(MachineID machine = 1; machine <= n_machines; machine++){
-			ind[index] = getMatrixIndexForVariable(process, machine);
-			vals[index] = instance().machineMoveCost(initialMachine - 1, machine - 1);
-			index++;
+	for(ServiceID service = 0; service < n_services; service++){
+		const vector<uint32_t> & free = free_by_service[service];
+		if(free.empty())
+			continue;
+		uint32_t row = addRow(GLP_LO, fixedMoved(service), 0.0);
+		addEntry(row, smc_col, 1.0);
+		for(uint32_t i = 0; i < free.size(); i++){
+			MachineID initialMachine = initial()[m_freeProcesses[free[i]]];
+			const vector<MachineID> & machines = x_machines[free[i]];
+			for(uint32_t k = 0; k < machines.size(); k++){
+				if(machines[k] != initialMachine)
+					addEntry(row, x_first_col[free[i]] + k, -1.0);
+			}
 		}
 	}
-	ind[index] = last_col;
-	vals[index] = -1.0;
-	
-	uint32_t row = glp_add_rows(lp, 1);
-	glp_set_mat_row(lp, row, size, ind, vals);
-	glp_set_row_bnds(lp, row, GLP_UP, 0.0, 0.0);
-	glp_set_obj_coef(lp, last_col, instance().weightMachineMoveCost());
-	delete[] ind;
-	delete[] vals;
+	modeled_objective += static_cast<double>(instance().weightServiceMoveCost()) * m_current->serviceMoveCost();
 }
 
+/*
+ * Entries of the free processes in the balance cost rows
+ */
 void LinearSolverSubProblem::addBalanceCost(){
-	
-	if(n_balanceCosts == 0)
-		return;
-	
-	uint32_t init_col = glp_add_cols(lp, n_machines * n_balanceCosts);
-	uint32_t last_col = init_col;
-	
-	for(uint32_t balanceCost = 0; balanceCost < n_balanceCosts; balanceCost++){
-		BalanceCost b = instance().balanceCosts()[balanceCost];
-		
-		for(MachineID machine = 1; machine <= n_machines; machine++){
-			uint32_t size = n_processes + 1;
-			int* ind = new int[1 + size];
-			double* vals = new double[1 + size];
-			uint32_t index = 1;
-			for(ProcessID process = 1; process <= n_processes; process++){
-				ind[index] = getMatrixIndexForVariable(process, machine);
-				Process p = instance().processes()[process - 1];
-				vals[index] = -p.requirement(b.resource2()) + b.target() * p.requirement(b.resource1());
-				index++;
-			}// end processes
-			ind[index] = last_col;
-			vals[index] = 1;
-			
-			int row = glp_add_rows(lp, 1);
-			glp_set_mat_row(lp, row, size, ind, vals);
-			Machine m = instance().machines()[machine - 1];
-			
-			double bound = b.target() * m.capacity(b.resource1()) - m.capacity(b.resource2());
-			glp_set_row_bnds(lp, row, GLP_LO, bound , 0.0);
-			glp_set_col_kind(lp, last_col, GLP_CV);
-			glp_set_col_bnds(lp, last_col, GLP_LO, 0.0, 0.0);
-			
-#ifdef LS_DEBUG
-			stringstream var_name;
-			var_name << "bc_" << balanceCost+1 << machine;
-			glp_set_col_name(lp, last_col, var_name.str().c_str());
-#endif
-			glp_set_obj_coef(lp, last_col, b.weight());
-			last_col++;
-			delete[] ind;
-			delete[] vals;
-		} // end for machines
+	for(MachineID machine = 0; machine < n_machines; machine++){
+		const Machine & m = instance().machines()[machine];
+		const vector<pair<uint32_t, uint32_t>> & vars = x_by_machine[machine];
+		for(uint32_t balanceCost = 0; balanceCost < n_balanceCosts; balanceCost++){
+			const BalanceCost & b = instance().balanceCosts()[balanceCost];
+			double target = b.target();
+			for(uint32_t k = 0; k < vars.size(); k++){
+				const Process & p = instance().processes()[m_freeProcesses[vars[k].first]];
+				addEntry(balanceCostRow(machine, balanceCost), vars[k].second,
+					target * p.requirement(b.resource1()) - static_cast<double>(p.requirement(b.resource2())));
+			}
+			modeled_objective += static_cast<double>(b.weight()) * _computeBalanceCost(b, m,
+				m_current->usage(machine, b.resource1()), m_current->usage(machine, b.resource2()));
+		}
 	}
 }
 
@@ -506,102 +497,100 @@ void LinearSolverSubProblem::addBalanceCost(){
  */
 void LinearSolverSubProblem::initGLPK(){
 	lp = glp_create_prob();
-	glp_set_prob_name(lp, "gchallenge");	
-	glp_init_iocp(&param);
-	setSolverParameters();
+	glp_set_prob_name(lp, "gchallenge");
 
 	// minimization problem
 	glp_set_obj_dir(lp, GLP_MIN);
 }
 
-void LinearSolverSubProblem::setSolverParameters(){
+void LinearSolverSubProblem::callback(glp_tree *tree, void *info){
+	const AtomicFlag * flag = static_cast<const AtomicFlag *>(info);
+	if(flag->read())
+		glp_ios_terminate(tree);
+}
+
+void LinearSolverSubProblem::setSolverParameters(const double timeLimit, const double mipGap, const AtomicFlag & flag){
+	glp_init_iocp(&param);
+	param.msg_lev = GLP_MSG_OFF;
 	param.presolve = GLP_ON;
-	/*
 	param.fp_heur = GLP_ON;
-	param.gmi_cuts = GLP_ON;
-	param.mir_cuts = GLP_ON;
-	param.cov_cuts = GLP_ON;
-	param.clq_cuts = GLP_ON;
-	param.tm_lim = 1000 * 60;
-	*/
+	param.mip_gap = mipGap;
+	param.tm_lim = std::max(1, static_cast<int>(timeLimit * 1000));
+	param.cb_func = callback;
+	param.cb_info = const_cast<AtomicFlag *>(&flag);
 }
 
+/*
+ * Computes the usage of the fixed processes from the usage of the current solution.
+ * Free processes count in the transient usage of their initial machine, wherever they go.
+ */
 void LinearSolverSubProblem::computeReducedCapacities(){
-	//scale capacity
-	
+	fixed_usage.resize(n_machines, vector<uint32_t>(n_resources));
+	fixed_transient.resize(n_machines, vector<uint32_t>(n_resources));
 	for(MachineID m = 0; m < n_machines; m++){
-		vector<uint32_t> v;
 		for(ResourceID r = 0; r < n_resources; r++){
-			uint32_t reduced_capacity = instance().machines()[m].capacity(r);
-			for(ProcessID p = 0; p < n_processes; p++){
-				// this can be improved by iterating on the list of fixed processes
-				if(!isFreeProcess(p)){
-					reduced_capacity -= instance().processes()[p].requirement(r);
-				}
-			}
-			v.push_back(reduced_capacity);
+			fixed_usage[m][r] = m_current->usage(m, r);
+			fixed_transient[m][r] = m_current->transient(m, r);
+		}
+	}
+	for(uint32_t i = 0; i < n_free_variables; i++){
+		ProcessID process = m_freeProcesses[i];
+		const Process & p = instance().processes()[process];
+		MachineID current = m_current->solution()[process];
+		MachineID initialMachine = initial()[process];
+		for(ResourceID r = 0; r < n_resources; r++){
+			fixed_usage[current][r] -= p.requirement(r);
+			if(current == initialMachine && instance().resources()[r].transient())
+				fixed_transient[initialMachine][r] += p.requirement(r);
 		}
-		reduced_capacities.push_back(v);
+		free_by_service[p.service()].push_back(i);
 	}
 }
 
-void LinearSolverSubProblem::solve(){	
-	initGLPK();
-	
-	n_processes = instance().processes().size();
-	n_machines = instance().machines().size();
-	n_resources = instance().resources().size();
-	n_services = instance().services().size();
-	n_neighborhoods = instance().neighborhoodCount();
-	n_locations = instance().locationCount();
-	n_balanceCosts = instance().balanceCosts().size();	
+void LinearSolverSubProblem::update(const SolutionInfo & current, const std::vector<ProcessID> & freeProcesses){
+	clearFreeProcesses();
+	m_current = &current;
+	m_freeProcesses = freeProcesses;
+	n_free_variables = m_freeProcesses.size();
+	CHECK(n_free_variables > 0);
+	modeled_objective = 0.0;
 
 	computeReducedCapacities();
+	updateMachineBounds();
 	addPlacementConstraints();
 	addCapacityConstraints();
 	addConflictConstraints();
 	addLoadCostObjectiveFunction();
 	addSpreadConstraints();
 	addDependencyConstraints();
-	addTransientUsageConstraints();
-	addMachineMoveCost();		
-	//uint32_t startColForProcessMove = addProcessMoveCost();
-	//addServiceMoveCost(startColForProcessMove);
-	//addBalanceCost();
+	addServiceMoveCost();
+	addBalanceCost();
+	// costs not depending on the free processes
+	glp_set_obj_coef(lp, 0, static_cast<double>(m_current->objective()) - modeled_objective);
+	glp_load_matrix(lp, ia.size() - 1, &ia[0], &ja[0], &ar[0]);
+}
 
+bool LinearSolverSubProblem::solve(const double timeLimit, const double mipGap, const AtomicFlag & flag, std::vector<MachineID> & solution){
 	//solve the problem
+	setSolverParameters(timeLimit, mipGap, flag);
 	glp_intopt(lp, &param);
-	
-#ifdef LS_DEBUG		
-	cout<< "Objective: " << glp_mip_obj_val(lp)<< endl;
+	int status = glp_mip_status(lp);
+	if(status != GLP_OPT && status != GLP_FEAS)
+		return false;
+	predicted_objective = glp_mip_obj_val(lp);
+
+#ifdef LS_DEBUG
+	cout << "Linear solver - Objective: " << predicted_objective << endl;
 #endif
 
-	vector<MachineID> machineAssignment = initial();
-	for(ProcessID free_process_index = 0; free_process_index < n_free_variables; free_process_index++){
-		for(MachineID machine = 0; machine < n_machines; machine++){
-			double x_ij = glp_mip_col_val(lp, getMatrixIndexForVariable(free_process_index, machine + 1));
-			if(x_ij == 1.0){
-				machineAssignment[free_process_index] = machine;
+	solution = m_current->solution();
+	for(uint32_t free_process_index = 0; free_process_index < n_free_variables; free_process_index++){
+		const vector<MachineID> & machines = x_machines[free_process_index];
+		for(uint32_t k = 0; k < machines.size(); k++){
+			if(glp_mip_col_val(lp, x_first_col[free_process_index] + k) > 0.5){
+				solution[m_freeProcesses[free_process_index]] = machines[k];
 			}
 		}
 	}
-
-	SolutionInfo sol(instance(), initial(), machineAssignment);
-	
-#ifdef LS_DEBUG
-	Verifier verifier;
-	Verifier::Result result = verifier.verify(instance(), initial(), machineAssignment);
-	if (!result.feasible()) {
-		throw runtime_error("Linear solver: wrong feasibility");
-	} else {
-		cout<< "Solution is feasible with obj: "<< sol.objective()<< endl;
-	}
-#endif
-
-//	best_objective = sol.objective();
-//	best_solution = sol.solution();
-
-
-	//deallocate glpk problem
-	glp_delete_prob(lp);
+	return true;
 }
@@ -1,8 +1,8 @@
 #include "load_cost_optimizer.h"
-#include "move_verifier.h"
 #include "vector_comparer.h"
 #include "pair_comparer.h"
 #include <vector>
+#include <limits>
 #include <algorithm>
 #include <iostream>
 
@@ -10,6 +10,19 @@ using namespace R12;
 
 #define TRACE_LCOPT 1
 
+// below this number of candidate moves a step is evaluated by the calling thread alone
+#define LCOPT_MIN_PARALLEL_CANDIDATES 4096
+
+namespace {
+
+const uint32_t ABSENT = std::numeric_limits<uint32_t>::max();
+
+}
+
+LoadCostOptimizer::LoadCostOptimizer(const uint32_t threads)
+: m_threads(std::max(1u, std::min(threads, TaskRuntime::instance().threads()))), m_workers(m_threads) {
+}
+
 uint64_t LoadCostOptimizer::evaluateLoadCost(const Machine & machine,
 											 const ResourceID r,
 											 const int64_t usage) const {
@@ -18,14 +31,112 @@ uint64_t LoadCostOptimizer::evaluateLoadCost(const Machine & machine,
 	return loadCost;
 }
 
+void LoadCostOptimizer::index(SolutionInfo & x) {
+	const Problem & instance = x.instance();
+	const ProcessCount pCount = instance.processes().size();
+	const MachineCount mCount = instance.machines().size();
+	m_procByMachine.assign(mCount, std::vector<ProcessID>());
+	m_position.resize(pCount);
+	for (ProcessID p = 0; p < pCount; ++p) {
+		std::vector<ProcessID> & processes = m_procByMachine[x.solution()[p]];
+		m_position[p] = processes.size();
+		processes.push_back(p);
+	}
+	m_lowLoadPosition.assign(mCount, ABSENT);
+	for (uint32_t w = 0; w < m_workers.size(); ++w) {
+		m_workers[w].mv.reset(new MoveVerifier(x));
+	}
+}
+
+void LoadCostOptimizer::addLowLoad(const MachineID m) {
+	if (m_lowLoadPosition[m] == ABSENT) {
+		m_lowLoadPosition[m] = m_lowLoad.size();
+		m_lowLoad.push_back(m);
+	}
+}
+
+void LoadCostOptimizer::removeLowLoad(const MachineID m) {
+	const uint32_t pos = m_lowLoadPosition[m];
+	if (pos == ABSENT) {
+		return;
+	}
+	const MachineID last = m_lowLoad.back();
+	m_lowLoad[pos] = last;
+	m_lowLoadPosition[last] = pos;
+	m_lowLoad.pop_back();
+	m_lowLoadPosition[m] = ABSENT;
+}
+
+void LoadCostOptimizer::evaluate(Worker & worker, const MachineID src, const uint32_t begin, const uint32_t end) {
+	const std::vector<ProcessID> & processes = m_procByMachine[src];
+	for (uint32_t j = begin; j < end; ++j) {
+		const MachineID dst = m_lowLoad[j];
+		for (ProcessCount i = 0; i < processes.size(); ++i) {
+			Move move(processes[i], src, dst);
+			if (worker.mv->feasible(move)) {
+				uint64_t obj = worker.mv->objective(move);
+				if (obj < worker.bestObj) {
+					worker.bestObj = obj;
+					worker.bestMove = move;
+					worker.bestIndex = j;
+				}
+			}
+		}
+	}
+}
+
+bool LoadCostOptimizer::bestMove(const SolutionInfo & x, const MachineID src, Move & move) {
+	const uint32_t count = m_lowLoad.size();
+	const uint64_t candidates = static_cast<uint64_t>(count) * m_procByMachine[src].size();
+	const uint32_t workers = candidates < LCOPT_MIN_PARALLEL_CANDIDATES ? 1 : std::min(m_threads, count);
+	for (uint32_t w = 0; w < workers; ++w) {
+		m_workers[w].bestObj = x.objective();
+		m_workers[w].bestIndex = count;
+	}
+	if (workers == 1) {
+		evaluate(m_workers[0], src, 0, count);
+	} else {
+		EvaluateBody body(*this, src);
+		TaskRuntime::instance().parallelFor(count, body, workers);
+	}
+	// workers claim increasing indices: on ties the first candidate in machine order wins, as in a serial scan
+	const Worker * best = &m_workers[0];
+	for (uint32_t w = 1; w < workers; ++w) {
+		const Worker & worker = m_workers[w];
+		if (worker.bestObj < best->bestObj || (worker.bestObj == best->bestObj && worker.bestIndex < best->bestIndex)) {
+			best = &worker;
+		}
+	}
+	if (best->bestObj < x.objective()) {
+		move = best->bestMove;
+		return true;
+	}
+	return false;
+}
+
+void LoadCostOptimizer::commit(const Move & move) {
+	MoveVerifier & mv = *m_workers[0].mv;
+	mv.objective(move);
+	mv.commit(move);
+	const ProcessID p = move.p();
+	std::vector<ProcessID> & src = m_procByMachine[move.src()];
+	const ProcessID last = src.back();
+	src[m_position[p]] = last;
+	m_position[last] = m_position[p];
+	src.pop_back();
+	std::vector<ProcessID> & dst = m_procByMachine[move.dst()];
+	m_position[p] = dst.size();
+	dst.push_back(p);
+}
+
 void LoadCostOptimizer::optimizeResource(SolutionInfo & x,
-										 const ResourceID r) const {
+										 const ResourceID r) {
 	typedef std::pair<MachineID,uint64_t> MLC;
 	const Problem & instance = x.instance();
-	const ProcessCount pCount = instance.processes().size();
 	const MachineCount mCount = instance.machines().size();
 	std::vector<MLC> sortedMachines;
-	std::vector<MachineID> lowLoadMachines;
+	m_lowLoad.clear();
+	std::fill(m_lowLoadPosition.begin(), m_lowLoadPosition.end(), ABSENT);
 	for (MachineID m = 0; m < mCount; ++m) {
 		const Machine & machine = instance.machines()[m];
 		int64_t usage = x.usage(m, r);
@@ -33,7 +144,7 @@ void LoadCostOptimizer::optimizeResource(SolutionInfo & x,
 		if (loadCost > 0) {
 			sortedMachines.push_back(MLC(m, loadCost));
 		} else {
-			lowLoadMachines.push_back(m);
+			addLowLoad(m);
 		}
 	}
 	#if TRACE_LCOPT >= 1
@@ -43,45 +154,24 @@ void LoadCostOptimizer::optimizeResource(SolutionInfo & x,
 	std::sort(sortedMachines.begin(),
 			  sortedMachines.end(),
 			  PairComparer<MachineID,uint64_t,true>());
-	MoveVerifier mv(x);
 	for (MachineCount i = 0; i < sortedMachines.size(); ++i) {
 		const MachineID m = sortedMachines[i].first;
 		const uint64_t initialLoadCost = sortedMachines[i].second;
 		const Machine & machine = instance.machines()[m];
-		std::vector<ProcessID> processes;
-		for (ProcessID p = 0; p < pCount; ++p) {
-			if (x.solution()[p] == m) {
-				processes.push_back(p);
-			}
-		}
 		uint64_t loadCost = initialLoadCost;
-		while(loadCost > 0) {
-			uint64_t initialObj = x.objective();
-			uint64_t bestObj = initialObj;
-			Move bestMove(0, 0, 0);
-			for (MachineCount j = 0; j < lowLoadMachines.size(); ++j) {
-				const MachineID m2 = lowLoadMachines[j];
-				for (ProcessCount i = 0; i < processes.size(); ++i) {
-					const ProcessID p = processes[i];
-					Move move(p, m, m2);
-					if (mv.feasible(move)) {
-						uint64_t obj = mv.objective(move);
-						if (obj < bestObj) {
-							bestObj = obj;
-							bestMove = move;
-						}
-					}
-				}
-			}
-			if (bestObj < initialObj) {
-				mv.objective(bestMove);
-				mv.commit(bestMove);
-				auto pItr = std::find(processes.begin(), processes.end(), bestMove.p());
-				processes.erase(pItr);
-				loadCost = evaluateLoadCost(machine, r, x.usage(m, r));
-			} else {
-				break;
+		Move move(0, 0, 0);
+		while (loadCost > 0 && bestMove(x, m, move)) {
+			commit(move);
+			// the destination is no longer a target once it goes above its safety capacity
+			const MachineID dst = move.dst();
+			if (evaluateLoadCost(instance.machines()[dst], r, x.usage(dst, r)) > 0) {
+				removeLowLoad(dst);
 			}
+			loadCost = evaluateLoadCost(machine, r, x.usage(m, r));
+		}
+		// a machine brought below its safety capacity can receive the processes of the next ones
+		if (loadCost == 0) {
+			addLowLoad(m);
 		}
 		#if TRACE_LCOPT >= 2
 		std::cout << "Load cost for resource " << r;
@@ -91,12 +181,13 @@ void LoadCostOptimizer::optimizeResource(SolutionInfo & x,
 	}
 }
 
-void LoadCostOptimizer::optimize(SolutionInfo & x) const {
+void LoadCostOptimizer::optimize(SolutionInfo & x) {
 	const Problem & instance = x.instance();
 	const ResourceCount rCount = instance.resources().size();
 	#if TRACE_LCOPT >= 1
 	writeCostComposition(x);
 	#endif
+	index(x);
 	std::vector<uint64_t> weightedResourceLC(rCount);
 	std::vector<ResourceID> sortedResources(rCount);
 	for (ResourceID r = 0; r < rCount; ++r) {
@@ -8,6 +8,9 @@
 #include "solution_pool.h"
 #include "analyzer.h"
 #include "atomic_flag.h"
+#include "task_runtime.h"
+#include "island_model.h"
+#include "scheduler.h"
 // standard library headers
 #include <cassert>
 #include <fstream>
@@ -20,6 +23,7 @@
 #include <iostream>
 // boost headers
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
 
 using namespace std;
@@ -135,9 +139,14 @@ int main(int argc, char ** argv) {
 		initialObjective = initialInfo.objective();
 		pool.push(initialObjective, initial);
 	}
+	// insert the solutions pushed by the heuristics on a separate thread
+	pool.start();
 
 	std::vector<std::string> heuristicNames;
 	std::vector<std::unique_ptr<R12::Heuristic>> heuristics;
+	std::vector<std::unique_ptr<R12::IslandModel>> islandModels;
+	// the time of the heuristics which stop contributing goes to the others
+	R12::Scheduler scheduler(args.timeLimit - TIME_SAFETY_GAP);
 
 	// get heuristic names
 	boost::split(heuristicNames, args.heuristicName, boost::is_any_of(","));
@@ -156,27 +165,66 @@ int main(int argc, char ** argv) {
 			std::cerr << "Invalid heuristic configuration: " << hc << std::endl;
 			return R12_ERROR_HEURISTIC_PARSE;
 		}
-		const std::string & name = nameAndConfig[0];
+		// name*N runs N islands of the heuristic, each with its own pool
+		std::vector<std::string> nameAndCount;
+		boost::split(nameAndCount, nameAndConfig[0], boost::is_any_of("*"));
+		if (nameAndCount.size() > 2) {
+			std::cerr << "Invalid heuristic configuration: " << hc << std::endl;
+			return R12_ERROR_HEURISTIC_PARSE;
+		}
+		const std::string & name = nameAndCount[0];
 		const std::string & config = nameAndConfig.size() == 2 ? nameAndConfig[1] : "";
 		// initialize heuristic
 		try {
-			std::unique_ptr<R12::Heuristic> h(R12::makeHeuristic(name));
-			h->init(instance, initial, seed, flag, pool, config);
-			heuristics.push_back(std::move(h));
+			if (nameAndCount.size() == 2) {
+				const uint32_t islands = boost::lexical_cast<uint32_t>(nameAndCount[1]);
+				if (islands == 0) {
+					throw std::runtime_error("At least one island is required");
+				}
+				const R12::ParameterMap islandParams = R12::ParameterMap(config).extractGroup("island");
+				std::unique_ptr<R12::IslandModel> model(new R12::IslandModel(pool, islands, islandParams, seed, hqMinBestDelta, hdMaxBestObjRatio));
+				for (uint32_t island = 0; island < islands; ++island) {
+					std::unique_ptr<R12::Heuristic> h(R12::makeHeuristic(name));
+					h->init(instance, initial, seed, flag, model->pool(island), config);
+					scheduler.add(*h, model->pool(island));
+					heuristics.push_back(std::move(h));
+					seed += 100;
+				}
+				islandModels.push_back(std::move(model));
+			} else {
+				std::unique_ptr<R12::Heuristic> h(R12::makeHeuristic(name));
+				h->init(instance, initial, seed, flag, pool, config);
+				scheduler.add(*h, pool);
+				heuristics.push_back(std::move(h));
+				// change seed for the next heuristic
+				seed += 100;
+			}
 		} catch (std::exception & ex) {
 			std::cerr << "Error during initialization of heuristic ";
 			std::cerr << (itr-heuristicNames.begin()) << " of type '";
 			std::cerr << name << "': " << ex.what() << std::endl;
 			return R12_ERROR_HEURISTIC_INIT;
 		}
-		// change seed for the next heuristic
-		seed += 100;
 	}
 
-	// start heuristics
+	// start the shared workers, heuristics then run in turns on the available slots
+	try {
+		R12::TaskRuntime::instance().init(args.threads);
+	} catch (std::exception & ex) {
+		std::cerr << "Error while starting the task runtime: " << ex.what() << std::endl;
+		return R12_ERROR_HEURISTIC_INIT;
+	}
+
+	// start migrations among islands, then heuristics
+	for (auto mItr = islandModels.begin(); mItr != islandModels.end(); ++mItr) {
+		(*mItr)->start();
+	}
 	for (auto hItr = heuristics.begin(); hItr != heuristics.end(); ++hItr) {
 		(*hItr)->start(deadline);
 	}
+	if (!args.staticSchedule && heuristics.size() > 1) {
+		scheduler.start();
+	}
 
 	// wait for completion of all heuristics or deadline
 	std::vector<bool> completed(heuristics.size());
@@ -203,7 +251,11 @@ int main(int argc, char ** argv) {
 	#ifdef TRACE_MAINHH
 	std::cout << "Forcing termination of uncompleted heuristics" << std::endl;
 	#endif
+	scheduler.stop();
 	pool.shutdown();
+	for (auto mItr = islandModels.begin(); mItr != islandModels.end(); ++mItr) {
+		(*mItr)->shutdown();
+	}
 	flag.write();
 
 	// wait for termination
@@ -214,6 +266,14 @@ int main(int argc, char ** argv) {
 		}
 		++i;
 	}
+	// forward the best solutions of the islands and insert the last solutions pushed by the heuristics
+	for (auto mItr = islandModels.begin(); mItr != islandModels.end(); ++mItr) {
+		(*mItr)->stop();
+	}
+	pool.stop();
+	#ifdef TRACE_MAINHH
+	std::cout << "Pool pushes coalesced: " << pool.coalescedCount() << std::endl;
+	#endif
 
 	i = 0;
 	int errorCount = 0;
@@ -61,7 +61,7 @@ inline void MoveVerifier::computeDiffProcessMoveCost(const Move & move) const {
 }
 
 	
-inline void MoveVerifier::computeDiffServiceMoveCost(const Move & move) const {
+void MoveVerifier::computeDiffServiceMoveCost(const Move & move) const {
 	const Process & process = m_info.instance().processes()[move.p()];
 	const ServiceID s = process.service();
 
@@ -139,6 +139,7 @@ void MoveVerifier::commit(const Move & move) {
 	if (src != dst) {
 		// change solution 
 		m_info.solution()[p] = dst;
+		m_info.updateMoved(p);
 
 		// get data
 		const Process & process = m_info.instance().processes()[p];
@@ -3,6 +3,7 @@
 #include "move_verifier.h"
 #include "exchange_verifier.h"
 #include <cmath>
+#include <algorithm>
 
 //#define TRACE_OPTLSR
 
@@ -16,154 +17,295 @@ uint64_t OptimizedLocalSearchRoutine::defaultMaxTrials() {
 
 void OptimizedLocalSearchRoutine::configure(const ParameterMap & parameters) {
 	m_pDist = ProcessDist(0, instance().processes().size() - 1);
-	m_mDist = MachineDist(0, instance().machines().size() - 1);
 	m_maxTrials = parameters.param<uint64_t>("maxTrials", defaultMaxTrials());
 	m_maxSamples = parameters.param<uint64_t>("maxSamples", 1000);
 	m_block = parameters.param<uint64_t>("block", 20);
+	m_threads = parameters.param<uint32_t>("threads", TaskRuntime::instance().threads());
+	m_threads = std::max(1u, std::min(m_threads, TaskRuntime::instance().threads()));
+	m_workers.resize(m_threads);
+	m_batch = std::max(1u, parameters.param<uint32_t>("batch", 1));
+	m_batchGain = parameters.param<double>("batchGain", 0.5);
+	// retain enough candidates per worker to find disjoint ones
+	for (uint32_t w = 0; w < m_threads; ++w) {
+		m_workers[w].keep = m_batch > 1 ? 4 * m_batch : 0;
+	}
+	m_machineStamp.assign(instance().machines().size(), 0);
+	m_serviceStamp.assign(instance().services().size(), 0);
+	m_neighborhoodStamp.assign(instance().neighborhoodCount(), 0);
+	m_stamp = 0;
+	m_moveFeasibleEvalCount = 0;
+	m_moveObjectiveEvalCount = 0;
+	m_moveCommitCount = 0;
+	m_exchangeFeasibleEvalCount = 0;
+	m_exchangeObjectiveEvalCount = 0;
+	m_exchangeCommitCount = 0;
 }
 
-void OptimizedLocalSearchRoutine::search(SolutionInfo & x) {
-	MoveVerifier mv(x);
-	ExchangeVerifier ev(x);
+void OptimizedLocalSearchRoutine::collect(SampleWorker & worker, const SolutionInfo & x, const uint64_t xObj) {
+	const MoveVerifier & mv = worker.mv();
+	const ExchangeVerifier & ev = worker.ev();
 	MethodDist methodDist(0, 1);
-	uint64_t it = 0;
-	uint64_t xObj = x.objective();
-	uint8_t bestMethod = 0;
-	Move bestMove(0, 0, 0);
-	Exchange bestExchange(0, 0, 0, 0);
-	uint64_t bestObj = xObj;
-	while (!interrupted()) {
-		++it;
-		// perform one iteration
-		uint64_t trials = 0;
-		uint64_t samples = 0;
-		std::vector<ProcessID> pvec(m_block);
-		std::vector<MachineID> mvec(m_block);
-		std::vector<ProcessID> p1vec(m_block);
-		std::vector<ProcessID> p2vec(m_block);
-		bool renewMove = true;
-		bool renewExchange = true;
-		uint64_t pi = 0;
-		uint64_t mi = 0;
-		uint64_t p1i = 0;
-		uint64_t p2i = 0;
-		while (trials < m_maxTrials && samples < m_maxSamples) {
-			if (renewMove) {
-				for (uint64_t i = 0; i < m_block; ++i) {
-					pvec[i] = m_pDist(rng());
-					mvec[i] = m_mDist(rng());
-				}
-				renewMove = false;
+	std::vector<ProcessID> pvec(m_block);
+	std::vector<MachineID> mvec(m_block);
+	std::vector<ProcessID> p1vec(m_block);
+	std::vector<ProcessID> p2vec(m_block);
+	bool renewMove = true;
+	bool renewExchange = true;
+	uint64_t pi = 0;
+	uint64_t mi = 0;
+	uint64_t p1i = 0;
+	uint64_t p2i = 0;
+	while (!worker.done()) {
+		if (renewMove) {
+			for (uint64_t i = 0; i < m_block; ++i) {
+				pvec[i] = m_pDist(worker.rng());
+				mvec[i] = dstSampler().sample(pvec[i], worker.rng());
 			}
-			if (renewExchange) {
-				for (uint64_t i = 0; i < m_block; ++i) {
-					p1vec[i] = m_pDist(rng());
-					p2vec[i] = m_pDist(rng());
-				}
-				renewExchange = false;
+			renewMove = false;
+		}
+		if (renewExchange) {
+			for (uint64_t i = 0; i < m_block; ++i) {
+				p1vec[i] = m_pDist(worker.rng());
+				p2vec[i] = m_pDist(worker.rng());
 			}
-			// perform a trial
-			++trials;
-			uint8_t method = methodDist(rng());
-			if (method == 0) {
-				// select next move
-				const ProcessID p = pvec[pi];
-				const MachineID dst = mvec[mi];
-				const MachineID src = x.solution()[p];
-				Move move(p, src, dst);
-				// check feasibility and objective
-				bool feasible = mv.feasible(move);
-				++m_moveFeasibleEvalCount;
-				if (feasible) {
-					uint64_t obj = mv.objective(move);
-					++m_moveObjectiveEvalCount;
-					if (obj < xObj) {
-						++samples;
-						if (obj < bestObj) {
-							// this is now the best sample
-							bestMethod = 0;
-							bestMove = move;
-							bestObj = obj;
-						}
-					}
+			renewExchange = false;
+		}
+		// perform a trial
+		++worker.trials;
+		uint8_t method = methodDist(worker.rng());
+		if (method == 0) {
+			// select next move
+			const ProcessID p = pvec[pi];
+			const MachineID dst = mvec[mi];
+			const MachineID src = x.solution()[p];
+			Move move(p, src, dst);
+			// check feasibility and objective
+			bool feasible = mv.feasible(move);
+			++worker.moveFeasibleEvalCount;
+			if (feasible) {
+				uint64_t obj = mv.objective(move);
+				++worker.moveObjectiveEvalCount;
+				if (obj < xObj) {
+					worker.offer(move, obj);
 				}
-				// increase indexes
-				++mi;
-				if (mi == m_block) {
-					mi = 0;
-					++pi;
-					if (pi == m_block) {
-						pi = 0;
-						renewMove = true;
-					}
+			}
+			// increase indexes
+			++mi;
+			if (mi == m_block) {
+				mi = 0;
+				++pi;
+				if (pi == m_block) {
+					pi = 0;
+					renewMove = true;
 				}
-			} else if (method == 1) {
-				// select next exchange
-				const ProcessID p1 = p1vec[p1i];
-				const ProcessID p2 = p2vec[p2i];
-				const MachineID m1 = x.solution()[p1];
-				const MachineID m2 = x.solution()[p2];
-				Exchange exchange(m1, p1, m2, p2);
-				// check feasibility and objective
-				bool feasible = ev.feasible(exchange);
-				++m_exchangeFeasibleEvalCount;
-				if (feasible) {
-					uint64_t obj = ev.objective(exchange);
-					++m_exchangeObjectiveEvalCount;
-					if (obj < xObj) {
-						++samples;
-						if (obj < bestObj) {
-							// this is now the best sample
-							bestMethod = 1;
-							bestExchange = exchange;
-							bestObj = obj;
-						}
-					}
+			}
+		} else if (method == 1) {
+			// select next exchange
+			const ProcessID p1 = p1vec[p1i];
+			const ProcessID p2 = p2vec[p2i];
+			const MachineID m1 = x.solution()[p1];
+			const MachineID m2 = x.solution()[p2];
+			Exchange exchange(m1, p1, m2, p2);
+			// check feasibility and objective
+			bool feasible = ev.feasible(exchange);
+			++worker.exchangeFeasibleEvalCount;
+			if (feasible) {
+				uint64_t obj = ev.objective(exchange);
+				++worker.exchangeObjectiveEvalCount;
+				if (obj < xObj) {
+					worker.offer(exchange, obj);
 				}
-				// increase indexes
-				++p2i;
-				if (p2i == m_block) {
-					p2i = 0;
-					++p1i;
-					if (p1i == m_block) {
-						p1i = 0;
-						renewExchange = true;
-					}
+			}
+			// increase indexes
+			++p2i;
+			if (p2i == m_block) {
+				p2i = 0;
+				++p1i;
+				if (p1i == m_block) {
+					p1i = 0;
+					renewExchange = true;
 				}
-			} else {
-				CHECK(false);
 			}
+		} else {
+			CHECK(false);
 		}
+	}
+}
+
+bool OptimizedLocalSearchRoutine::claim(const ProcessID p, const MachineID src, const MachineID dst, const bool mark) {
+	const ServiceID s = instance().processes()[p].service();
+	const NeighborhoodID nsrc = instance().machines()[src].neighborhood();
+	const NeighborhoodID ndst = instance().machines()[dst].neighborhood();
+	// dependencies only change when the process leaves its neighborhood
+	const bool crossing = nsrc != ndst;
+	if (!mark) {
+		return m_machineStamp[src] != m_stamp && m_machineStamp[dst] != m_stamp && m_serviceStamp[s] != m_stamp &&
+			   (!crossing || (m_neighborhoodStamp[nsrc] != m_stamp && m_neighborhoodStamp[ndst] != m_stamp));
+	}
+	m_machineStamp[src] = m_stamp;
+	m_machineStamp[dst] = m_stamp;
+	m_serviceStamp[s] = m_stamp;
+	if (crossing) {
+		m_neighborhoodStamp[nsrc] = m_stamp;
+		m_neighborhoodStamp[ndst] = m_stamp;
+	}
+	return true;
+}
+
+bool OptimizedLocalSearchRoutine::claim(const SampleWorker::Candidate & candidate, const bool mark) {
+	if (candidate.method == 0) {
+		const Move & move = candidate.move;
+		return claim(move.p(), move.src(), move.dst(), mark);
+	} else {
+		const Exchange & exchange = candidate.exchange;
+		// both processes must be free before marking either of them
+		if (!mark && !claim(exchange.p1(), exchange.m1(), exchange.m2(), false)) {
+			return false;
+		}
+		if (!mark && !claim(exchange.p2(), exchange.m2(), exchange.m1(), false)) {
+			return false;
+		}
+		if (mark) {
+			claim(exchange.p1(), exchange.m1(), exchange.m2(), true);
+			claim(exchange.p2(), exchange.m2(), exchange.m1(), true);
+		}
+		return true;
+	}
+}
+
+uint32_t OptimizedLocalSearchRoutine::commitBatch(MoveVerifier & mv, ExchangeVerifier & ev, const SolutionInfo & x, uint64_t & xObj) {
+	// a new stamp releases all machines, services and neighborhoods
+	++m_stamp;
+	if (m_stamp == 0) {
+		std::fill(m_machineStamp.begin(), m_machineStamp.end(), 0);
+		std::fill(m_serviceStamp.begin(), m_serviceStamp.end(), 0);
+		std::fill(m_neighborhoodStamp.begin(), m_neighborhoodStamp.end(), 0);
+		m_stamp = 1;
+	}
+	m_candidates.clear();
+	for (uint32_t w = 0; w < m_workers.size(); ++w) {
+		m_candidates.insert(m_candidates.end(), m_workers[w].candidates.begin(), m_workers[w].candidates.end());
+	}
+	std::stable_sort(m_candidates.begin(), m_candidates.end(), SampleWorker::CandidateCompare());
+	// later samples must retain a fraction of the gain of the best one
+	const uint64_t startObj = xObj;
+	const double minGain = m_batchGain * static_cast<double>(startObj - m_candidates.front().obj);
+	uint32_t committed = 0;
+	for (auto itr = m_candidates.begin(); itr != m_candidates.end() && committed < m_batch; ++itr) {
+		if (static_cast<double>(startObj - itr->obj) < minGain) {
+			break;
+		}
+		if (!claim(*itr, false)) {
+			continue;
+		}
+		// the gain was measured on the solution before the batch: evaluate again
+		if (itr->method == 0) {
+			const Move & move = itr->move;
+			if (x.solution()[move.p()] != move.src() || !mv.feasible(move)) {
+				continue;
+			}
+			uint64_t obj = mv.objective(move);
+			if (obj >= xObj) {
+				continue;
+			}
+			mv.commit(move);
+			++m_moveCommitCount;
+			xObj = obj;
+		} else {
+			const Exchange & exchange = itr->exchange;
+			if (x.solution()[exchange.p1()] != exchange.m1() || x.solution()[exchange.p2()] != exchange.m2() || !ev.feasible(exchange)) {
+				continue;
+			}
+			uint64_t obj = ev.objective(exchange);
+			if (obj >= xObj) {
+				continue;
+			}
+			ev.commit(exchange);
+			++m_exchangeCommitCount;
+			xObj = obj;
+		}
+		claim(*itr, true);
+		dstSampler().update();
+		++committed;
+	}
+	#ifdef TRACE_OPTLSR
+	std::cout << "Committed " << committed << " samples, objective: " << xObj << std::endl;
+	#endif
+	return committed;
+}
+
+void OptimizedLocalSearchRoutine::search(SolutionInfo & x) {
+	MoveVerifier mv(x);
+	ExchangeVerifier ev(x);
+	const uint32_t workers = m_workers.size();
+	for (uint32_t w = 0; w < workers; ++w) {
+		m_workers[w].bind(x);
+	}
+	// a single worker draws from the routine generator, as the serial search did
+	if (workers == 1) {
+		m_workers[0].useRng(rng());
+	}
+	uint64_t it = 0;
+	uint64_t xObj = x.objective();
+	CollectBody body(*this, x, xObj);
+	dstSampler().refresh(x);
+	while (!interrupted()) {
+		++it;
+		// perform one iteration: workers sample the same solution
+		for (uint32_t w = 0; w < workers; ++w) {
+			if (workers > 1) {
+				m_workers[w].seed(rng()());
+			}
+			m_workers[w].start(xObj, SampleWorker::share(m_maxTrials, workers, w), SampleWorker::share(m_maxSamples, workers, w));
+		}
+		TaskRuntime::instance().parallelFor(workers, body, workers, 1);
+		uint64_t trials;
+		uint64_t samples;
+		const SampleWorker & best = m_workers[SampleWorker::reduce(m_workers, trials, samples)];
 		// iteration completed
 		// check if stuck in local minimum
-		if (samples == 0 && trials == m_maxTrials) {
+		if (samples == 0) {
 			#ifdef TRACE_OPTLSR
 			std::cout << "Iteration " << it << " failed, exiting local search" << std::endl;
 			#endif
 			break;
 		}
-		// check if iteration completed
-		if (samples == m_maxSamples || trials == m_maxTrials) {
-			#ifdef TRACE_OPTLSR
-			std::cout << "Iteration " << it;
-			std::cout << ": collected " << samples << " samples";
-			std::cout << " in " << trials << " trials.";
-			std::cout << " Best sample objective: " << bestObj << std::endl;
-			#endif
-			// perform the best move or the best exchange
-			if (bestMethod == 0) {
-				mv.objective(bestMove);
-				mv.commit(bestMove);
-				++m_moveCommitCount;
-			} else if (bestMethod == 1) {
-				ev.objective(bestExchange);
-				ev.commit(bestExchange);
-				++m_exchangeCommitCount;
-			} else {
-				CHECK(false);
-			}
-			// update objective of current solution
-			xObj = bestObj;
+		#ifdef TRACE_OPTLSR
+		std::cout << "Iteration " << it;
+		std::cout << ": collected " << samples << " samples";
+		std::cout << " in " << trials << " trials.";
+		std::cout << " Best sample objective: " << best.bestObj << std::endl;
+		#endif
+		if (m_batch > 1) {
+			// perform the best sample followed by non-interfering ones
+			commitBatch(mv, ev, x, xObj);
+			continue;
+		}
+		// perform the best move or the best exchange
+		if (best.bestMethod == 0) {
+			mv.objective(best.bestMove);
+			mv.commit(best.bestMove);
+			++m_moveCommitCount;
+		} else if (best.bestMethod == 1) {
+			ev.objective(best.bestExchange);
+			ev.commit(best.bestExchange);
+			++m_exchangeCommitCount;
+		} else {
+			CHECK(false);
 		}
+		dstSampler().update();
+		// update objective of current solution
+		xObj = best.bestObj;
+	}
+	for (uint32_t w = 0; w < workers; ++w) {
+		SampleWorker & worker = m_workers[w];
+		m_moveFeasibleEvalCount += worker.moveFeasibleEvalCount;
+		m_moveObjectiveEvalCount += worker.moveObjectiveEvalCount;
+		m_exchangeFeasibleEvalCount += worker.exchangeFeasibleEvalCount;
+		m_exchangeObjectiveEvalCount += worker.exchangeObjectiveEvalCount;
+		worker.moveFeasibleEvalCount = 0;
+		worker.moveObjectiveEvalCount = 0;
+		worker.exchangeFeasibleEvalCount = 0;
+		worker.exchangeObjectiveEvalCount = 0;
 	}
 }
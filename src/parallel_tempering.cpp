@@ -0,0 +1,229 @@
+#include "parallel_tempering.h"
+
+#include "SA_local_search_routine.h"
+#include "temperature_calibration.h"
+#include "move.h"
+#include "exchange.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+
+using namespace R12;
+
+namespace {
+
+// sweeps between two reads of the pool
+const uint64_t SYNC_PERIOD = 16;
+// steps between two reads of the stop flag
+const uint64_t FLAG_PERIOD = 256;
+// coldest temperature: the cold chains only refine, unlike the final stage of simulated annealing
+const double MIN_TEMPERATURE = 1.0;
+
+bool metropolis(const uint64_t obj, const uint64_t newObj, const double t, boost::mt19937 & rng) {
+	if (newObj <= obj) {
+		return true;
+	}
+	boost::random::uniform_01<double> dist;
+	return dist(rng) < std::exp(-static_cast<double>(newObj - obj) / t);
+}
+
+}
+
+void ParallelTempering::run() {
+	try {
+		SolutionInfo start(instance(), initial());
+		runFromSolution(start);
+	} catch (std::exception & e) {
+		signalError(e.what());
+		return;
+	}
+	signalCompletion();
+}
+
+void ParallelTempering::runFromSolution(SolutionInfo & info) {
+	m_replicas = std::max(2u, param<uint32_t>("replicas", TaskRuntime::instance().threads()));
+	m_steps = param<uint64_t>("steps", instance().processes().size());
+	m_threads = param<uint32_t>("threads", TaskRuntime::instance().threads());
+	m_threads = std::max(1u, std::min(m_threads, TaskRuntime::instance().threads()));
+	m_readPool = param<bool>("read_pool", false);
+	m_stats = param<bool>("stats", false);
+	const double iProb = param<double>("i_prob", InitProb);
+	const double minProb = param<double>("min_prob", MinProb);
+	const double tMin = param<double>("min_t", MIN_TEMPERATURE);
+	m_rng.seed(seed());
+	m_pDist = ProcessDist(0, instance().processes().size() - 1);
+	m_mDist = MachineDist(0, instance().machines().size() - 1);
+	m_best.reset(new SolutionInfo(info));
+	double tMax = param<double>("max_t", 0.0);
+	if (tMax <= 0.0) {
+		const uint64_t samples = std::min<uint64_t>(DefaultCalibrationSamples,
+			static_cast<uint64_t>(instance().processes().size()) * instance().machines().size());
+		tMax = static_cast<double>(calibrateTemperature(*m_best, m_rng,
+			param<uint64_t>("calib_samples", samples), param<double>("calib_time", DefaultCalibrationTime), flag()));
+	}
+	if (tMax <= tMin) {
+		tMax = 2.0 * tMin;
+	}
+	// geometric ladder, coldest first
+	m_temperatures.resize(m_replicas);
+	m_moveProb.resize(m_replicas);
+	const double ratio = std::pow(tMax / tMin, 1.0 / (m_replicas - 1));
+	for (uint32_t level = 0; level < m_replicas; ++level) {
+		m_temperatures[level] = tMin * std::pow(ratio, static_cast<double>(level));
+		const double prob = iProb * (std::log(m_temperatures[level]) - std::log(tMin)) / (std::log(tMax) - std::log(tMin));
+		m_moveProb[level] = std::max(minProb, prob);
+	}
+	m_chains.clear();
+	m_chains.resize(m_replicas);
+	m_order.resize(m_replicas);
+	for (uint32_t i = 0; i < m_replicas; ++i) {
+		Chain & chain = m_chains[i];
+		chain.x.reset(new SolutionInfo(info));
+		chain.mv.reset(new MoveVerifier(*chain.x));
+		chain.ev.reset(new ExchangeVerifier(*chain.x));
+		chain.rng.seed(m_rng());
+		m_order[i] = i;
+	}
+	m_proposed.assign(m_replicas, 0);
+	m_accepted.assign(m_replicas, 0);
+	m_swapsProposed.assign(m_replicas - 1, 0);
+	m_swapsAccepted.assign(m_replicas - 1, 0);
+	pool().push(m_best->objective(), m_best->solution());
+	#ifdef TRACE_PT
+	std::cout << "Parallel tempering - " << m_replicas << " replicas from " << tMin << " to " << tMax << std::endl;
+	#endif
+	SweepBody body(*this);
+	uint64_t round = 0;
+	while (!interrupted() && remaining() > 0) {
+		for (uint32_t i = 0; i < m_replicas; ++i) {
+			m_chains[i].bestObj = m_best->objective();
+		}
+		TaskRuntime::instance().parallelFor(m_replicas, body, m_threads, 1);
+		// keep the best solution met by any chain during the sweep
+		uint32_t improved = m_replicas;
+		for (uint32_t i = 0; i < m_replicas; ++i) {
+			if (m_chains[i].bestObj < m_best->objective() && (improved == m_replicas || m_chains[i].bestObj < m_chains[improved].bestObj)) {
+				improved = i;
+			}
+		}
+		if (improved < m_replicas) {
+			m_best.reset(new SolutionInfo(instance(), initial(), m_chains[improved].best));
+			pool().push(m_best->objective(), m_best->solution());
+			#ifdef TRACE_PT
+			std::cout << "Parallel tempering - Round " << round << ": " << m_best->objective() << std::endl;
+			#endif
+		}
+		swap(round);
+		++round;
+		// restart the coldest chain from the pool when another heuristic found better
+		if (m_readPool && round % SYNC_PERIOD == 0) {
+			Chain & cold = m_chains[m_order[0]];
+			if (pool().bestObjective() < cold.x->objective()) {
+				SolutionPool::Entry entry;
+				if (pool().best(entry)) {
+					*cold.x = SolutionInfo(instance(), initial(), *entry.ptr());
+					if (entry.obj() < m_best->objective()) {
+						m_best.reset(new SolutionInfo(*cold.x));
+					}
+				}
+			}
+		}
+	}
+	#ifndef TRACE_PT
+	if (m_stats)
+	#endif
+	printStats();
+}
+
+void ParallelTempering::sweep(const uint32_t level) {
+	Chain & chain = m_chains[m_order[level]];
+	const double t = m_temperatures[level];
+	const double moveProb = m_moveProb[level];
+	boost::random::uniform_01<double> method;
+	uint64_t obj = chain.x->objective();
+	uint64_t proposed = 0;
+	uint64_t accepted = 0;
+	for (uint64_t step = 0; step < m_steps; ++step) {
+		// workers only read the flag, interrupted() caches it in the heuristic
+		if (step % FLAG_PERIOD == 0 && flag().read()) {
+			break;
+		}
+		uint64_t newObj;
+		if (method(chain.rng) < moveProb) {
+			const ProcessID p = m_pDist(chain.rng);
+			const MachineID src = chain.x->solution()[p];
+			const MachineID dst = m_mDist(chain.rng);
+			if (src == dst) {
+				continue;
+			}
+			Move move(p, src, dst);
+			++proposed;
+			if (!chain.mv->feasible(move)) {
+				continue;
+			}
+			newObj = chain.mv->objective(move);
+			if (!metropolis(obj, newObj, t, chain.rng)) {
+				continue;
+			}
+			chain.mv->commit(move);
+		} else {
+			const ProcessID p1 = m_pDist(chain.rng);
+			const ProcessID p2 = m_pDist(chain.rng);
+			const MachineID m1 = chain.x->solution()[p1];
+			const MachineID m2 = chain.x->solution()[p2];
+			if (m1 == m2) {
+				continue;
+			}
+			Exchange exchange(m1, p1, m2, p2);
+			++proposed;
+			if (!chain.ev->feasible(exchange)) {
+				continue;
+			}
+			newObj = chain.ev->objective(exchange);
+			if (!metropolis(obj, newObj, t, chain.rng)) {
+				continue;
+			}
+			chain.ev->commit(exchange);
+		}
+		obj = newObj;
+		++accepted;
+		if (obj < chain.bestObj) {
+			chain.bestObj = obj;
+			chain.best = chain.x->solution();
+		}
+	}
+	m_proposed[level] += proposed;
+	m_accepted[level] += accepted;
+}
+
+void ParallelTempering::swap(const uint64_t round) {
+	// even and odd pairs alternate so that each chain takes part in at most one swap per round
+	boost::random::uniform_01<double> dist;
+	for (uint32_t level = round % 2; level + 1 < m_replicas; level += 2) {
+		const uint64_t cold = m_chains[m_order[level]].x->objective();
+		const uint64_t hot = m_chains[m_order[level + 1]].x->objective();
+		const double exponent = (1.0 / m_temperatures[level] - 1.0 / m_temperatures[level + 1])
+			* (static_cast<double>(cold) - static_cast<double>(hot));
+		++m_swapsProposed[level];
+		if (exponent >= 0.0 || dist(m_rng) < std::exp(exponent)) {
+			std::swap(m_order[level], m_order[level + 1]);
+			++m_swapsAccepted[level];
+		}
+	}
+}
+
+void ParallelTempering::printStats() const {
+	std::cout << "Parallel tempering - Level, temperature, acceptance rate, swap rate with the next level" << std::endl;
+	for (uint32_t level = 0; level < m_replicas; ++level) {
+		std::cout << "Parallel tempering - " << level << " " << std::fixed << std::setprecision(1) << m_temperatures[level];
+		std::cout << " " << std::setprecision(4) << acceptanceRate(level);
+		if (level + 1 < m_replicas) {
+			std::cout << " " << swapRate(level);
+		}
+		std::cout << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+}
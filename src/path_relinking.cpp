@@ -3,6 +3,7 @@
 #include "best_improvement_local_search.h"
 
 #include <limits>
+#include <sstream>
 
 //#define TRACE_PATH_RELINKING
 
@@ -12,7 +13,18 @@
 
 using namespace R12;
 
+namespace {
+
+// heap keys are changes of the objective shifted to be non-negative, infeasible moves come last
+const uint64_t DELTA_OFFSET = static_cast<uint64_t>(1) << 63;
+const uint64_t INFEASIBLE = std::numeric_limits<uint64_t>::max();
+
+}
+
 void PathRelinking::run() {
+	m_lsThreads = parameters().extractGroup("ls").param<uint32_t>("threads", TaskRuntime::instance().threads());
+	m_depth = param<uint32_t>("depth", 0);
+	m_stamp = 0;
 	// initialize best
 	SolutionInfo initialInfo(instance(), initial());
 	m_bestObjective = initialInfo.objective();
@@ -25,13 +37,24 @@ void PathRelinking::run() {
 	// run path relinking until termination signal
 	uint64_t runs = 0;
 	while (!interrupted()) {
-		// wait for notification
-		if (subPtr->wait()) {
+		// wait for notification, leaving the slot to other heuristics
+		bool notified;
+		{
+			TaskRuntime::BlockingRegion blocking;
+			notified = subPtr->wait();
+		}
+		if (notified) {
 			// successful!
 			// retrieve another solution among the good ones
 			pool().randomHighQuality(s1);
-			// retrieve solution
+			// retrieve solution, keeping only the best one if more are pending
 			s2 = subPtr->dequeue();
+			while (subPtr->trywait()) {
+				SolutionPool::Entry pending = subPtr->dequeue();
+				if (pending.obj() < s2.obj()) {
+					s2 = pending;
+				}
+			}
 			// check that the solutions are different enough
 			if (delta(*s1.ptr(), *s2.ptr()) >= 2) {
 				++runs;
@@ -47,75 +70,99 @@ void PathRelinking::run() {
 	signalCompletion();
 }
 
-bool PathRelinking::step(SolutionInfo & info1, const SolutionInfo & info2, std::list<ProcessID> & differences) {
-	MoveVerifier mv(info1);
-	// look for best move
-	std::list<ProcessID>::iterator bestItr = differences.end();
-	uint64_t bestObj = std::numeric_limits<uint64_t>::max();
-	for (auto itr = differences.begin(); itr != differences.end(); ++itr) {
-		ProcessID p = *itr;
-		Move move(p, info1.solution()[p], info2.solution()[p]);
-		bool feasible = mv.feasible(move);
-		if (feasible) {
-			uint64_t obj = mv.objective(move);
-			if (obj < bestObj) {
-				bestItr = itr;
-				bestObj = obj;
-			}
-		}
+void PathRelinking::evaluate(const MoveVerifier & mv, const std::vector<MachineID> & target, const ProcessID p) {
+	if (!m_heap.contains(p) || m_evaluated[p] == m_stamp) {
+		return;
 	}
-	// apply best move if found
-	if (bestItr != differences.end()) {
-		ProcessID p = *bestItr;
-		Move move(p, info1.solution()[p], info2.solution()[p]);
-		mv.objective(move);
-		mv.commit(move);
-		differences.erase(bestItr);
-		return true;
-	} else {
-		// failed to find feasible move
-		return false;
+	m_evaluated[p] = m_stamp;
+	Move move(p, mv.info().solution()[p], target[p]);
+	// the change of the objective is stored, since the objective of the current solution changes at every step
+	m_heap.update(p, mv.feasible(move) ? mv.objective(move) - mv.info().objective() + DELTA_OFFSET : INFEASIBLE);
+}
+
+void PathRelinking::evaluateAll(const MoveVerifier & mv, const std::vector<MachineID> & target, const std::vector<ProcessID> & processes) {
+	for (auto itr = processes.begin(); itr != processes.end(); ++itr) {
+		evaluate(mv, target, *itr);
 	}
 }
 
 void PathRelinking::relink(const SolutionPool::Entry s1, const SolutionPool::Entry s2) {
 	const std::vector<MachineID> & v1 = *s1.ptr();
 	const std::vector<MachineID> & v2 = *s2.ptr();
+	const ProcessCount pCount = instance().processes().size();
 	// enumerate processes placed on different machines
-	std::list<ProcessID> differences;
-	for (ProcessID p = 0; p < instance().processes().size(); ++p) {
+	std::vector<ProcessID> differences;
+	m_byMachine.resize(instance().machines().size());
+	for (ProcessID p = 0; p < pCount; ++p) {
 		if (v1[p] != v2[p]) {
 			differences.push_back(p);
+			m_byMachine[v1[p]].push_back(p);
+			m_byMachine[v2[p]].push_back(p);
 		}
 	}
-	// relink
+	// only the starting point is built, the target is only read
 	SolutionInfo info1(instance(), initial(), v1);
-	SolutionInfo info2(instance(), initial(), v2);
+	MoveVerifier mv(info1);
+	m_heap.reset(pCount);
+	for (auto itr = differences.begin(); itr != differences.end(); ++itr) {
+		m_heap.update(*itr, 0);
+	}
+	m_evaluated.resize(pCount, 0);
+	++m_stamp;
+	evaluateAll(mv, v2, differences);
+	// relink, remembering the steps so that the best solution is only copied at the end
 	uint64_t initialBestObj = info1.objective();
 	uint64_t bestObj = info1.objective();
-	std::vector<MachineID> best = v1;
-	uint32_t it = 0;
-	while (differences.size() > 1 && !interrupted()) {
-		bool success = false;
-		if (it % 2 == 0) {
-			success = step(info1, info2, differences);
-			uint64_t obj = info1.objective();
-			if (obj < bestObj) {
-				best = info1.solution();
-				bestObj = obj;
-			}
-		} else {
-			success = step(info2, info1, differences);
-			uint64_t obj = info2.objective();
-			if (obj < bestObj) {
-				best = info2.solution();
-				bestObj = obj;
-			}
-		}
-		if (!success) {
+	std::vector<ProcessID> steps;
+	uint32_t bestSteps = 0;
+	while (m_heap.size() > 1 && (m_depth == 0 || steps.size() < m_depth) && !interrupted()) {
+		const ProcessID p = m_heap.top();
+		if (m_heap.key(p) == INFEASIBLE) {
+			// failed to find feasible move
 			break;
 		}
+		const MachineID src = info1.solution()[p];
+		const MachineID dst = v2[p];
+		const ServiceID s = instance().processes()[p].service();
+		const uint64_t oldSmc = info1.serviceMoveCost();
+		const ProcessCount oldMoved = info1.movedProcesses(s);
+		Move move(p, src, dst);
+		mv.objective(move);
+		mv.commit(move);
+		m_heap.remove(p);
+		steps.push_back(p);
+		if (info1.objective() < bestObj) {
+			bestObj = info1.objective();
+			bestSteps = steps.size();
+		}
+		++m_stamp;
+		const uint64_t maxMoved = std::max(oldMoved, info1.movedProcesses(s));
+		if (info1.serviceMoveCost() != oldSmc || maxMoved >= oldSmc) {
+			// the maximum of the moved processes changed or the service held it: the service move cost of any move may have changed
+			evaluateAll(mv, v2, differences);
+			continue;
+		}
+		// load, balance, capacity and transient usage changed on the two machines,
+		// conflicts and spread in the service, dependencies in the services related to it
+		evaluateAll(mv, v2, m_byMachine[src]);
+		evaluateAll(mv, v2, m_byMachine[dst]);
+		evaluateAll(mv, v2, instance().processesByService(s));
+		auto out = boost::out_edges(s, instance().dependency());
+		for (auto eItr = out.first; eItr != out.second; ++eItr) {
+			evaluateAll(mv, v2, instance().processesByService(boost::target(*eItr, instance().dependency())));
+		}
+		auto in = boost::in_edges(s, instance().dependency());
+		for (auto eItr = in.first; eItr != in.second; ++eItr) {
+			evaluateAll(mv, v2, instance().processesByService(boost::source(*eItr, instance().dependency())));
+		}
 	}
+	for (auto itr = differences.begin(); itr != differences.end(); ++itr) {
+		m_byMachine[v1[*itr]].clear();
+		m_byMachine[v2[*itr]].clear();
+	}
+	#ifdef TRACE_PATH_RELINKING
+	std::cout << "Path relinking - " << steps.size() << " steps out of " << differences.size() << " differences" << std::endl;
+	#endif
 	// check if we had an improvement
 	if (bestObj < initialBestObj) {
 		#ifdef TRACE_PATH_RELINKING
@@ -123,16 +170,20 @@ void PathRelinking::relink(const SolutionPool::Entry s1, const SolutionPool::Ent
 		#endif
 		// do local search on the best solution
 		BestImprovementLocalSearch ls;
-		ls.init(instance(), initial(), seed(), flag(), pool(), "");
+		std::stringstream lsConfig;
+		lsConfig << "threads=" << m_lsThreads;
+		ls.init(instance(), initial(), seed(), flag(), pool(), lsConfig.str());
+		std::vector<MachineID> best(v1);
+		for (uint32_t i = 0; i < bestSteps; ++i) {
+			best[steps[i]] = v2[steps[i]];
+		}
 		SolutionInfo bestInfo(instance(), initial(), best);
 		ls.runFromSolution(bestInfo);
 		#ifdef TRACE_PATH_RELINKING
 		std::cout << "Path relinking - Local search: " << bestInfo.objective() << std::endl;
 		#endif
 		// compare with best in the pool
-		SolutionPool::Entry poolBest;
-		pool().best(poolBest);
-		if (bestInfo.objective() < poolBest.obj() * 1.1) {
+		if (bestInfo.objective() < pool().bestObjective() * 1.1) {
 			pool().push(bestInfo.objective(), bestInfo.solution());
 		}
 		// compare with best of this heuristic
@@ -19,7 +19,7 @@ Move RandomLocalSearchRoutine::randomMove(const SolutionInfo & x) {
 	do {
 		p = m_pDist(rng());
 		src = x.solution()[p];
-		dst = m_mDist(rng());
+		dst = dstSampler().sample(p, rng());
 	} while (src == dst);
 	Move move(p, src, dst);
 	return move;
@@ -39,7 +39,6 @@ Exchange RandomLocalSearchRoutine::randomExchange(const SolutionInfo & x) {
 
 void RandomLocalSearchRoutine::configure(const ParameterMap & parameters) {
 	m_pDist = ProcessDist(0, instance().processes().size() - 1);
-	m_mDist = MachineDist(0, instance().machines().size() - 1);
 	m_maxTrials = parameters.param<uint64_t>("maxTrials", defaultMaxTrials());
 }
 
@@ -50,6 +49,7 @@ void RandomLocalSearchRoutine::search(SolutionInfo & x) {
 	uint64_t it = 0;
 	uint64_t trials = 0;
 	uint64_t xObj = x.objective();
+	dstSampler().refresh(x);
 	while (trials < m_maxTrials && !interrupted()) {
 		++trials;
 		int method = methodDist(rng());
@@ -62,6 +62,7 @@ void RandomLocalSearchRoutine::search(SolutionInfo & x) {
 				++m_moveObjectiveEvalCount;
 				if (obj < xObj) {
 					mv.commit(move);
+					dstSampler().update();
 					xObj = obj;
 					++m_moveCommitCount;
 					trials = 0;
@@ -77,6 +78,7 @@ void RandomLocalSearchRoutine::search(SolutionInfo & x) {
 				++m_exchangeObjectiveEvalCount;
 				if (obj < xObj) {
 					ev.commit(exchange);
+					dstSampler().update();
 					xObj = obj;
 					++m_exchangeCommitCount;
 					trials = 0;
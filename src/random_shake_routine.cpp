@@ -13,7 +13,7 @@ Move RandomShakeRoutine::randomMove(const SolutionInfo & x) {
 	do {
 		p = m_pDist(rng());
 		src = x.solution()[p];
-		dst = m_mDist(rng());
+		dst = dstSampler().sample(p, rng());
 	} while (src == dst);
 	Move move(p, src, dst);
 	return move;
@@ -33,7 +33,6 @@ Exchange RandomShakeRoutine::randomExchange(const SolutionInfo & x) {
 
 void RandomShakeRoutine::configure(const ParameterMap & parameters) {
 	m_pDist = ProcessDist(0, instance().processes().size() - 1);
-	m_mDist = MachineDist(0, instance().machines().size() - 1);
 	m_maxTrials = parameters.param<uint64_t>("maxTrials", 1000);
 }
 
@@ -42,6 +41,7 @@ void RandomShakeRoutine::shake(SolutionInfo & x, const uint64_t k) {
 	ExchangeVerifier ev(x);
 	boost::uniform_int<int> methodDist(0, 1);
 	bool stopped = false;
+	dstSampler().refresh(x);
 	for (uint64_t i = 0; i < k; ++i) {
 		bool found = false;
 		uint64_t trials = 0;
@@ -56,6 +56,7 @@ void RandomShakeRoutine::shake(SolutionInfo & x, const uint64_t k) {
 					mv.objective(move);
 					++m_moveObjectiveEvalCount;
 					mv.commit(move);
+					dstSampler().update();
 					++m_moveCommitCount;
 					found = true;
 				}
@@ -67,6 +68,7 @@ void RandomShakeRoutine::shake(SolutionInfo & x, const uint64_t k) {
 					ev.objective(exchange);
 					++m_exchangeObjectiveEvalCount;
 					ev.commit(exchange);
+					dstSampler().update();
 					++m_exchangeCommitCount;
 					found = true;
 				}
@@ -0,0 +1,126 @@
+#include "restore_local_search_routine.h"
+
+#include "move_verifier.h"
+#include "exchange_verifier.h"
+#include <algorithm>
+#include <iostream>
+
+//#define TRACE_RLSR
+
+using namespace R12;
+
+void RestoreLocalSearchRoutine::configure(const ParameterMap & parameters) {
+	m_maxPasses = parameters.param<uint32_t>("maxPasses", UINT32_MAX);
+	m_maxBlockers = parameters.param<uint32_t>("maxBlockers", 32);
+	m_slot.resize(instance().processes().size());
+	m_saving.resize(instance().processes().size());
+}
+
+void RestoreLocalSearchRoutine::buildHosted(const SolutionInfo & x) {
+	m_hosted.resize(instance().machines().size());
+	for (MachineID m = 0; m < instance().machines().size(); ++m) {
+		m_hosted[m].clear();
+	}
+	for (ProcessID p = 0; p < instance().processes().size(); ++p) {
+		const MachineID m = x.solution()[p];
+		m_slot[p] = m_hosted[m].size();
+		m_hosted[m].push_back(p);
+	}
+}
+
+void RestoreLocalSearchRoutine::updateHosted(const ProcessID p, const MachineID src, const MachineID dst) {
+	// swap with the last process of the source machine
+	std::vector<ProcessID> & srcHosted = m_hosted[src];
+	const ProcessID last = srcHosted.back();
+	srcHosted[m_slot[p]] = last;
+	m_slot[last] = m_slot[p];
+	srcHosted.pop_back();
+	m_slot[p] = m_hosted[dst].size();
+	m_hosted[dst].push_back(p);
+}
+
+uint64_t RestoreLocalSearchRoutine::saving(const SolutionInfo & x, const ProcessID p) const {
+	const Process & process = instance().processes()[p];
+	const MachineID m = x.solution()[p];
+	return static_cast<uint64_t>(instance().weightProcessMoveCost()) * process.movementCost() +
+		   static_cast<uint64_t>(instance().weightMachineMoveCost()) * instance().machineMoveCost(initial()[p], m);
+}
+
+void RestoreLocalSearchRoutine::search(SolutionInfo & x) {
+	MoveVerifier mv(x);
+	ExchangeVerifier ev(x);
+	uint64_t xObj = x.objective();
+	dstSampler().refresh(x);
+	buildHosted(x);
+	for (uint32_t pass = 0; pass < m_maxPasses && !interrupted(); ++pass) {
+		// visit moved processes by decreasing saving
+		m_order.clear();
+		for (ProcessCount i = 0; i < x.movedCount(); ++i) {
+			const ProcessID p = x.moved(i);
+			m_saving[p] = saving(x, p);
+			m_order.push_back(p);
+		}
+		std::sort(m_order.begin(), m_order.end(), SavingCompare(m_saving));
+		uint32_t improvements = 0;
+		for (auto itr = m_order.begin(); itr != m_order.end() && !interrupted(); ++itr) {
+			const ProcessID p = *itr;
+			// an earlier exchange may already have sent the process home
+			if (!x.isMoved(p)) {
+				continue;
+			}
+			const MachineID src = x.solution()[p];
+			const MachineID home = initial()[p];
+			// try moving the process home
+			Move move(p, src, home);
+			if (mv.feasible(move)) {
+				uint64_t obj = mv.objective(move);
+				if (obj < xObj) {
+					mv.commit(move);
+					updateHosted(p, src, home);
+					dstSampler().update();
+					xObj = obj;
+					++improvements;
+					continue;
+				}
+			}
+			// try exchanging the process with one of the blockers on its initial machine
+			const std::vector<ProcessID> & blockers = m_hosted[home];
+			if (blockers.empty()) {
+				continue;
+			}
+			const uint32_t count = std::min<uint32_t>(m_maxBlockers, blockers.size());
+			boost::random::uniform_int_distribution<uint32_t> offsetDist(0, blockers.size() - 1);
+			const uint32_t offset = offsetDist(rng());
+			uint64_t bestObj = xObj;
+			ProcessID bestBlocker = 0;
+			for (uint32_t i = 0; i < count; ++i) {
+				const ProcessID q = blockers[(offset + i) % blockers.size()];
+				Exchange exchange(src, p, home, q);
+				if (ev.feasible(exchange)) {
+					uint64_t obj = ev.objective(exchange);
+					if (obj < bestObj) {
+						bestObj = obj;
+						bestBlocker = q;
+					}
+				}
+			}
+			if (bestObj < xObj) {
+				Exchange exchange(src, p, home, bestBlocker);
+				ev.objective(exchange);
+				ev.commit(exchange);
+				updateHosted(p, src, home);
+				updateHosted(bestBlocker, home, src);
+				dstSampler().update();
+				xObj = bestObj;
+				++improvements;
+			}
+		}
+		#ifdef TRACE_RLSR
+		std::cout << "Restore pass " << pass << ": " << improvements << " improvements";
+		std::cout << ", " << x.movedCount() << " moved processes, objective " << xObj << std::endl;
+		#endif
+		if (improvements == 0) {
+			break;
+		}
+	}
+}
@@ -0,0 +1,173 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <iostream>
+
+//#define TRACE_SCHEDULER
+
+using namespace R12;
+
+namespace {
+
+// seconds between two measurements, as a fraction of the time limit and at least MIN_EPOCH
+const double EPOCH_FRACTION = 0.01;
+const double MIN_EPOCH = 0.5;
+// fraction of the time limit during which every heuristic runs
+const double WARMUP_FRACTION = 0.1;
+// weight of the previous rate in the decayed rate
+const double RATE_DECAY = 0.7;
+// heuristics whose rate is below this fraction of the best rate are suspended
+const double MIN_SHARE = 0.05;
+// epochs of the first suspension and of the probation following a resume
+const double SUSPENSION_EPOCHS = 5.0;
+const double PROBATION_EPOCHS = 3.0;
+
+}
+
+Scheduler::Scheduler(const double timeLimit)
+: m_timeLimit(timeLimit), m_running(false), m_stopEvent(false), m_suspensionCount(0) {
+	pthread_mutex_init(&m_mutex, 0);
+	pthread_cond_init(&m_cond, 0);
+	m_startTime.tv_sec = 0;
+	m_startTime.tv_nsec = 0;
+}
+
+Scheduler::~Scheduler() {
+	stop();
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void Scheduler::add(Heuristic & heuristic, const SolutionPool & pool) {
+	CHECK(!m_running);
+	Record record;
+	record.heuristic = &heuristic;
+	record.pool = &pool;
+	record.improvement = 0;
+	record.rate = 0.0;
+	record.suspensions = 0;
+	record.resumeAt = 0.0;
+	record.probationUntil = 0.0;
+	m_records.push_back(record);
+}
+
+void Scheduler::start() {
+	clock_gettime(CLOCK_REALTIME, &m_startTime);
+	m_stopEvent = false;
+	int err = pthread_create(&m_thread, 0, &Scheduler::doSchedule, this);
+	if (err != 0) {
+		throw std::runtime_error("Scheduler: pthread_create failed");
+	}
+	m_running = true;
+}
+
+void Scheduler::stop() {
+	if (!m_running) {
+		return;
+	}
+	pthread_mutex_lock(&m_mutex);
+	m_stopEvent = true;
+	pthread_cond_signal(&m_cond);
+	pthread_mutex_unlock(&m_mutex);
+	pthread_join(m_thread, 0);
+	m_running = false;
+	for (uint32_t i = 0; i < m_records.size(); ++i) {
+		m_records[i].heuristic->resume();
+	}
+	#ifdef TRACE_SCHEDULER
+	std::cout << "Scheduler - " << m_suspensionCount << " suspensions" << std::endl;
+	#endif
+}
+
+void * Scheduler::doSchedule(void * arg) {
+	static_cast<Scheduler*>(arg)->loop();
+	return 0;
+}
+
+double Scheduler::elapsed() const {
+	timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return static_cast<double>(now.tv_sec - m_startTime.tv_sec) + static_cast<double>(now.tv_nsec - m_startTime.tv_nsec) * 1e-9;
+}
+
+void Scheduler::loop() {
+	const double epoch = std::max(MIN_EPOCH, EPOCH_FRACTION * m_timeLimit);
+	pthread_mutex_lock(&m_mutex);
+	while (!m_stopEvent) {
+		timespec wakeup;
+		clock_gettime(CLOCK_REALTIME, &wakeup);
+		const double seconds = std::floor(epoch);
+		wakeup.tv_sec += static_cast<time_t>(seconds);
+		wakeup.tv_nsec += static_cast<long>((epoch - seconds) * 1e9);
+		if (wakeup.tv_nsec >= 1000000000L) {
+			wakeup.tv_sec += 1;
+			wakeup.tv_nsec -= 1000000000L;
+		}
+		int err = 0;
+		while (!m_stopEvent && err == 0) {
+			err = pthread_cond_timedwait(&m_cond, &m_mutex, &wakeup);
+		}
+		if (m_stopEvent) {
+			break;
+		}
+		pthread_mutex_unlock(&m_mutex);
+		rebalance(epoch);
+		pthread_mutex_lock(&m_mutex);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void Scheduler::rebalance(const double epoch) {
+	const double now = elapsed();
+	// measure the contributions of the last epoch
+	double bestRate = 0.0;
+	uint32_t active = 0;
+	for (uint32_t i = 0; i < m_records.size(); ++i) {
+		Record & r = m_records[i];
+		if (r.heuristic->completed()) {
+			continue;
+		}
+		const uint64_t improvement = r.pool->improvement(r.heuristic->source());
+		r.rate = RATE_DECAY * r.rate + (1.0 - RATE_DECAY) * static_cast<double>(improvement - r.improvement) / epoch;
+		r.improvement = improvement;
+		if (!r.heuristic->suspended()) {
+			bestRate = std::max(bestRate, r.rate);
+			++active;
+		}
+	}
+	// give another chance to the heuristics suspended long enough
+	for (uint32_t i = 0; i < m_records.size(); ++i) {
+		Record & r = m_records[i];
+		if (r.heuristic->suspended() && now >= r.resumeAt) {
+			r.heuristic->resume();
+			r.rate = 0.0;
+			r.probationUntil = now + PROBATION_EPOCHS * epoch;
+			#ifdef TRACE_SCHEDULER
+			std::cout << "Scheduler - Resuming heuristic " << i << " at " << now << std::endl;
+			#endif
+		}
+	}
+	// nobody is suspended while all heuristics start or when none of them is improving
+	if (now < WARMUP_FRACTION * m_timeLimit || bestRate <= 0.0) {
+		return;
+	}
+	for (uint32_t i = 0; i < m_records.size() && active > 1; ++i) {
+		Record & r = m_records[i];
+		if (r.heuristic->completed() || r.heuristic->suspended() || now < r.probationUntil) {
+			continue;
+		}
+		if (r.rate < MIN_SHARE * bestRate) {
+			const double period = SUSPENSION_EPOCHS * epoch * std::pow(2.0, static_cast<double>(std::min(r.suspensions, 10u)));
+			r.heuristic->suspend();
+			r.resumeAt = now + period;
+			++r.suspensions;
+			++m_suspensionCount;
+			--active;
+			#ifdef TRACE_SCHEDULER
+			std::cout << "Scheduler - Suspending heuristic " << i << " at " << now << " for " << period << " seconds" << std::endl;
+			#endif
+		}
+	}
+}
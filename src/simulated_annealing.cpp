@@ -18,6 +18,10 @@ inline void SimulatedAnnealing::configure()
 	setMinTemperature(param<long double>("min_t",MinTemp));
 	setReduceTemperature(param<long double>("r_factor",RedPar));
 	setReadPool(param<bool>("read_pool",false));
+	CalibrationSamples = param<uint64_t>("calib_samples", DefaultCalibrationSamples);
+	CalibrationTime = param<double>("calib_time", DefaultCalibrationTime);
+	m_iterations = 0;
+	m_searchSeconds = 0.0;
 
 	std::string SAlsName = param<std::string>("SAls");
 	SAlsParameters = parameters().extractGroup("SAls");
@@ -28,25 +32,20 @@ void SimulatedAnnealing::run()
 	configure();	
 	m_bestSolution.reset(new SolutionInfo(instance(), initial()));
 
-	uint64_t problemSizeLimit = 50000 * 1000;
-	if(instance().processes().size() * instance().machines().size() > problemSizeLimit){
-		// big instance, don't use SA
-		signalCompletion();
-		return;
-	}
-	
 	Init();
 	
 	while(!interrupted())
 	{
 		runFromSolution(*m_bestSolution);
+		// only rebuild when the pool has something better than the current solution
 		SolutionPool::Entry best;
-		pool().best(best);	
-		m_bestSolution.reset(new SolutionInfo(instance(), initial(), *(best.ptr()))); 		
+		if (pool().best(best) && best.obj() < m_bestSolution->objective())
+			m_bestSolution.reset(new SolutionInfo(instance(), initial(), *(best.ptr())));
 	}
 
 #ifdef TRACE_SA
 	std::cout << "Simulated annealing - Ends Best solution: " << m_bestSolution->objective() << std::endl;
+	std::cout << "Simulated annealing - " << m_iterations << " iterations, " << iterationsPerSecond() << " per second" << std::endl;
 #endif
 
 	signalCompletion();
@@ -56,9 +55,13 @@ void SimulatedAnnealing::run()
 void SimulatedAnnealing::runFromSolution(SolutionInfo & info) 
 {
 
-	std::unique_ptr<SALocalSearchRoutine> SAls(new SALocalSearchRoutine);
-
-	SAls->init(instance(), initial(), flag(), m_rng, SAlsParameters);
+	// the routine is kept between runs, so its cache is allocated once
+	if (!SAls) {
+		SAls.reset(new SALocalSearchRoutine);
+		SAls->init(instance(), initial(), flag(), m_rng, SAlsParameters);
+	} else {
+		SAls->resetCache();
+	}
 
 	int64_t bestObjective = info.objective();
 	int64_t lastObjective ;
@@ -128,11 +131,12 @@ void SimulatedAnnealing::runFromSolution(SolutionInfo & info)
 			if(ResetTemperature <  LowestResetTemperature)
 				ResetTemperature = Temperature / pow(2, MAX_DIVISIONS_RESET);
 			
-			if(ReadPool){
+			if(ReadPool && pool().bestObjective() < m_bestSolution->objective()){
 				SolutionPool::Entry entry;
 				if (pool().best(entry)) {
 					if (entry.obj() < m_bestSolution->objective()) {
 						m_bestSolution.reset(new SolutionInfo(instance(), initial(), *(entry.ptr())));
+						SAls->resetCache();
 					}
 				}
 			}
@@ -156,86 +160,20 @@ void SimulatedAnnealing::runFromSolution(SolutionInfo & info)
 		#endif
 	} // end simulated annealing loop
 
+	m_iterations = SAls->iterations();
+	m_searchSeconds = SAls->seconds();
+
 	//m_bestSolution =  info.solution();
 
 }
 
 void SimulatedAnnealing::Init()
 {
-	ProcessCount pCount = instance().processes().size();
-	MachineCount mCount = instance().machines().size();
-	MoveVerifier mv(*m_bestSolution);
-	ExchangeVerifier ev(*m_bestSolution);
-	uint64_t MaxDiff = 0;
-
-	// perform one iteration
-	uint64_t samples = 0;
-	ProcessID p = 0;
-	MachineID dst = 0;	
-	ProcessID p1 = 0;	
-	ProcessID p2 = 0;
-	uint64_t m_maxSamples = instance().processes().size() * instance().machines().size();
-	uint64_t FeasibleSolutions = 0;
-
-	while (samples < m_maxSamples)
-	{
-		samples++;
-		// try move or exchange
-		if (samples % 2 == 0)
-		{
-			// Move
-			p = (p + 1) % pCount;
-			dst = (dst + 1) % mCount;
-			MachineID src =	(*m_bestSolution).solution()[p];
-			if (src != dst)
-			{
-				Move move(p, src, dst);
-				if (mv.feasible(move)) 
-				{
-					FeasibleSolutions++;
-					
-					uint64_t obj = mv.objective(move);
-					uint64_t Diff = std::abs ((int64_t)obj - (int64_t)m_bestSolution->objective() );
-			
-					if(Diff > MaxDiff)
-						MaxDiff = Diff;
-				}
-			}
-		}
-		else {
-			// Exchange
-			p1 = (p1 + 1) % pCount;
-			do
-			{
-				p2 = (p2 + 1) % pCount;
-			} while(p1 == p2) ;
-
-			MachineID m1 = (*m_bestSolution).solution()[p1];
-			MachineID m2 = (*m_bestSolution).solution()[p2];
-			if (m1 != m2) 
-	     	{
-				Exchange exchange(m1, p1, m2, p2);
-				if (ev.feasible(exchange)) 
-				{
-					FeasibleSolutions++;
-					uint64_t obj = ev.objective(exchange);
-					uint64_t Diff = std::abs ((int64_t)obj - (int64_t)m_bestSolution->objective() );
-		
-					if(Diff > MaxDiff)
-						MaxDiff = Diff;
-				}
-			}
-		}
-	}
-	
-	if(FeasibleSolutions>0)
-		setMaxTemperature(MaxDiff);
-	else
-		setMaxTemperature(m_bestSolution->objective());
+	// the initial temperature is the largest objective change among random feasible moves and exchanges,
+	// sampled until enough of them are found or the calibration time is over
+	setMaxTemperature(calibrateTemperature(*m_bestSolution, m_rng, CalibrationSamples, CalibrationTime, flag()));
 
 #ifdef TRACE_SA
 	std::cout << "Max temperature: " << MaxTemperature << " Min temperature: " << MinTemperature << std::endl;
 #endif
-
-
-}
\ No newline at end of file
+}
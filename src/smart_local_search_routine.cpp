@@ -22,6 +22,7 @@ void SmartLocalSearchRoutine::configure(const ParameterMap & parameters) {
 	m_mDist = MachineDist(0, instance().machines().size() - 1);
 	m_maxTrials = parameters.param<uint64_t>("maxTrials", defaultMaxTrials());
 	m_maxSamples = parameters.param<uint64_t>("maxSamples", 1000);
+	m_cache.init(instance(), parameters.param<uint32_t>("cacheBits", 0));
 	m_unitStep = parameters.param<bool>("unitStep", false);
 }
 
@@ -45,6 +46,9 @@ void SmartLocalSearchRoutine::search(SolutionInfo & x) {
 	Move bestMove(0, 0, 0);
 	Exchange bestExchange(0, 0, 0, 0);
 	uint64_t bestObj = xObj;
+	const bool uniformDst = dstSampler().uniform();
+	dstSampler().refresh(x);
+	m_cache.reset();
 	while (!interrupted()) {
 		++it;
 		// perform one iteration
@@ -75,12 +79,16 @@ void SmartLocalSearchRoutine::search(SolutionInfo & x) {
 			// try move or exchange
 			if (trials % 2 == 0) {
 				p = (p + pStep) % pCount;
-				dst = (dst + dstStep) % mCount;
+				if (uniformDst) {
+					dst = (dst + dstStep) % mCount;
+				} else {
+					dst = dstSampler().sample(p, rng());
+				}
 				MachineID src = x.solution()[p];
 				if (src != dst) {
 					Move move(p, src, dst);
-					if (mv.feasible(move)) {
-						uint64_t obj = mv.objective(move);
+					uint64_t obj;
+					if (m_cache.evaluate(mv, move, xObj, obj)) {
 						if (obj < xObj) {
 							++samples;
 							if (obj < bestObj) {
@@ -98,8 +106,8 @@ void SmartLocalSearchRoutine::search(SolutionInfo & x) {
 				MachineID m2 = x.solution()[p2];
 				if (p1 != p2 && m1 != m2) {
 					Exchange exchange(m1, p1, m2, p2);
-					if (ev.feasible(exchange)) {
-						uint64_t obj = ev.objective(exchange);
+					uint64_t obj;
+					if (m_cache.evaluate(ev, exchange, xObj, obj)) {
 						if (obj < xObj) {
 							++samples;
 							if (obj < bestObj) {
@@ -132,12 +140,15 @@ void SmartLocalSearchRoutine::search(SolutionInfo & x) {
 			if (bestMethod == 0) {
 				mv.objective(bestMove);
 				mv.commit(bestMove);
+				m_cache.update(bestMove);
 			} else if (bestMethod == 1) {
 				ev.objective(bestExchange);
 				ev.commit(bestExchange);
+				m_cache.update(bestExchange);
 			} else {
 				CHECK(false);
 			}
+			dstSampler().update();
 			// update objective of current solution
 			xObj = bestObj;
 		}
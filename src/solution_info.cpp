@@ -43,6 +43,7 @@ void SolutionInfo::initializeContainers() {
 		m_locationPresence[s].resize(instance().locationCount());
 	}
 	m_movedProcesses.resize(instance().services().size());
+	m_movedIndex.resize(instance().processes().size(), notMoved());
 	m_loadCosts.resize(instance().resources().size());
 	m_balanceCosts.resize(instance().balanceCosts().size());
 }
@@ -95,6 +96,7 @@ void SolutionInfo::initializeSolutionDelta() {
 			setProcessMoveCost(processMoveCost() + process.movementCost());
 			setMachineMoveCost(machineMoveCost() + instance().machineMoveCost(mInitial, m));
 			setMovedProcesses(process.service(), movedProcesses(process.service()) + 1);
+			updateMoved(p);
 		}
 	}
 	computeServiceMoveCost();
@@ -115,6 +117,10 @@ bool SolutionInfo::operator==(const SolutionInfo & other) const {
 	if (m_locationPresence != other.m_locationPresence) return false;
 	if (m_neighborhoodPresence != other.m_neighborhoodPresence) return false;
 	if (m_movedProcesses != other.m_movedProcesses) return false;
+	if (m_moved.size() != other.m_moved.size()) return false;
+	for (auto itr = m_moved.begin(); itr != m_moved.end(); ++itr) {
+		if (!other.isMoved(*itr)) return false;
+	}
 	if (m_loadCosts != other.m_loadCosts) return false;
 	if (m_balanceCosts != other.m_balanceCosts) return false;
 	if (m_processMoveCost != other.m_processMoveCost) return false;
@@ -2,16 +2,17 @@
 
 #include <boost/random/uniform_int_distribution.hpp>
 #include <iostream>
+#include <limits>
 
-#include <solution_info.h>
-#include <move_verifier.h>
+// largest number of attributes stored without hashing
+#define TABU_SEARCH_MAX_ATTRIBUTES (1 << 24)
 
-#define TABU_PROCESSES_MAX_SIZE (50)
-#define TABU_MACHINES_MAX_SIZE (50)
+#define TABU_SEARCH_SYNC (1000)
 
-#define TABU_SEARCH_WIPE (500)
+// candidates drawn per sampled move at most
+#define TABU_SEARCH_MAX_TRIALS (20)
 
-#define TABU_SEARCH_SYNC (1000)
+//#define TRACE_TABU_SEARCH
 
 using namespace R12;
 
@@ -22,85 +23,149 @@ inline ProcessID TabuSearch::pickProcess()
 	return distribution(randomizer);
 }
 
-inline MachineID TabuSearch::pickMachine()
+inline MachineID TabuSearch::pickDestination(MachineID src)
 {
-	boost::random::uniform_int_distribution<MachineID> distribution(0, instance().machines().size() - 1);
-	return distribution(randomizer);
+	// uniform among the other machines, requires at least two machines
+	const MachineCount mCount = instance().machines().size();
+	boost::random::uniform_int_distribution<MachineID> distribution(0, mCount - 2);
+	return (src + 1 + distribution(randomizer)) % mCount;
+}
+
+inline uint64_t TabuSearch::attribute(ProcessID p, MachineID m) const
+{
+	const uint64_t index = static_cast<uint64_t>(p) * instance().machines().size() + m;
+	if (!tabu_hashed)
+		return index;
+	// collisions only make a few more moves tabu for a while
+	return (index * 0x9E3779B97F4A7C15ULL >> 20) & tabu_mask;
+}
+
+void TabuSearch::initTabu()
+{
+	const uint64_t attributes = static_cast<uint64_t>(instance().processes().size()) * instance().machines().size();
+	tabu_hashed = attributes > TABU_SEARCH_MAX_ATTRIBUTES;
+	const uint64_t size = tabu_hashed ? TABU_SEARCH_MAX_ATTRIBUTES : attributes;
+	tabu_mask = size - 1;
+	tabu_until.assign(size, 0);
+	iteration = 0;
+}
+
+void TabuSearch::clearTabu()
+{
+	// every stamp is at most iteration plus the longest tenure
+	iteration += m_tenure + m_tenure / 2 + 1;
+}
+
+void TabuSearch::restart(const std::vector<MachineID> & solution)
+{
+	current.reset(new SolutionInfo(instance(), initial(), solution));
+	verifier.reset(new MoveVerifier(*current));
+	clearTabu();
+}
+
+void TabuSearch::saveIncumbent()
+{
+	best_solution = current->solution();
+	pool().push(best_objective, best_solution);
 }
 
 void TabuSearch::run()
 {
-	randomizer.seed(seed());
+	try {
+		SolutionInfo start(instance(), initial());
+		runFromSolution(start);
+	} catch (std::exception & e) {
+		signalError(e.what());
+		return;
+	}
+	signalCompletion();
+}
 
-	SolutionInfo solution(instance(), initial());
-	best_objective = solution.objective();
-	best_solution = solution.solution();
-
-	uint64_t i;
-	for (i = 0; !interrupted(); i++) {
-		if (i % TABU_SEARCH_WIPE == 0) {
-			tabu_processes.clear();
-			tabu_processes_order.clear();
-			tabu_machines.clear();
-			tabu_machines_order.clear();
-		} else if (i % TABU_SEARCH_SYNC == 0) {
+void TabuSearch::runFromSolution(SolutionInfo & info)
+{
+	randomizer.seed(seed());
+	m_samples = std::max(1u, param<uint32_t>("samples", 100));
+	m_tenure = std::max(1u, param<uint32_t>("tenure", 10));
+	m_readPool = param<bool>("read_pool", true);
+
+	initTabu();
+	current.reset(new SolutionInfo(info));
+	verifier.reset(new MoveVerifier(*current));
+	best_objective = current->objective();
+	best_solution = current->solution();
+	// whether the current solution is an incumbent not copied yet
+	bool unsaved = false;
+	boost::random::uniform_int_distribution<uint32_t> tenureDistribution(m_tenure, m_tenure + m_tenure / 2);
+	const MachineCount mCount = instance().machines().size();
+
+	#ifdef TRACE_TABU_SEARCH
+	uint64_t improvements = 0;
+	uint64_t aspirations = 0;
+	#endif
+	uint64_t steps;
+	for (steps = 0; !interrupted(); ++steps, ++iteration) {
+		if (m_readPool && steps % TABU_SEARCH_SYNC == 0 && pool().bestObjective() < best_objective) {
 			SolutionPool::Entry entry;
-			if (pool().best(entry)) {
-				solution = SolutionInfo(instance(), initial(), *(entry.ptr()));
-				best_objective = solution.objective();
-				best_solution = solution.solution();
-				// XXX: just reset the tabu lists
-				tabu_processes.clear();
-				tabu_processes_order.clear();
-				tabu_machines.clear();
-				tabu_machines_order.clear();
+			if (pool().best(entry) && entry.obj() < best_objective) {
+				if (unsaved)
+					saveIncumbent();
+				restart(*entry.ptr());
+				best_objective = current->objective();
+				best_solution = current->solution();
+				unsaved = false;
 			}
 		}
-		MoveVerifier verifier(solution);
-		ProcessID p = pickProcess();
-		if (tabu_processes.find(p) != tabu_processes.end())
-			continue;
-		MachineID src = best_solution[p];
-		MachineID dst;
-		// FIXME: maybe this loop could lead to timing troubles...
-		do {
-			dst = pickMachine();
-		} while (dst == src);
-		if (tabu_machines.find(dst) != tabu_machines.end())
+		// best admissible move among a sample of feasible moves, drawing a bounded number of candidates on tight instances
+		uint64_t bestObj = std::numeric_limits<uint64_t>::max();
+		Move bestMove(0, 0, 0);
+		uint32_t feasibleCount = 0;
+		for (uint32_t trials = 0; feasibleCount < m_samples && trials < TABU_SEARCH_MAX_TRIALS * m_samples; ++trials) {
+			const ProcessID p = pickProcess();
+			const MachineID src = current->solution()[p];
+			const MachineID dst = mCount > 1 ? pickDestination(src) : src;
+			if (dst == src)
+				continue;
+			Move m(p, src, dst);
+			if (!verifier->feasible(m))
+				continue;
+			++feasibleCount;
+			const uint64_t objective = verifier->objective(m);
+			if (objective >= bestObj)
+				continue;
+			const bool tabu = tabu_until[attribute(p, dst)] > iteration;
+			if (tabu && objective >= best_objective)
+				continue;
+			#ifdef TRACE_TABU_SEARCH
+			if (tabu)
+				++aspirations;
+			#endif
+			bestObj = objective;
+			bestMove = m;
+		}
+		if (bestObj == std::numeric_limits<uint64_t>::max())
 			continue;
-		Move m(p, src, dst);
-		if (verifier.feasible(m)) {
-			uint64_t objective = verifier.objective(m);
-			if (objective < best_objective) {
-				verifier.commit(m);
-				best_objective = objective;
-				best_solution = solution.solution();
-				if (tabu_processes.size() > TABU_PROCESSES_MAX_SIZE) {
-					ProcessID lra_p = tabu_processes_order.front();
-					tabu_processes_order.pop_front();
-					tabu_processes.erase(lra_p);
-				}
-				tabu_processes.insert(p);
-				tabu_processes_order.push_back(p);
-				if (tabu_machines.size() > TABU_MACHINES_MAX_SIZE) {
-					MachineID lra_m = tabu_machines_order.front();
-					tabu_machines_order.pop_front();
-					tabu_machines.erase(lra_m);
-				}
-				tabu_machines.insert(dst);
-				tabu_machines_order.push_back(dst);
-
-				pool().push(best_objective, best_solution);
-			}
+		// leaving an incumbent: keep a copy before moving away from it
+		if (unsaved && bestObj >= current->objective()) {
+			saveIncumbent();
+			unsaved = false;
+		}
+		// the objective evaluated last is not the one of the chosen move
+		verifier->objective(bestMove);
+		verifier->commit(bestMove);
+		tabu_until[attribute(bestMove.p(), bestMove.src())] = iteration + tenureDistribution(randomizer);
+		if (current->objective() < best_objective) {
+			best_objective = current->objective();
+			unsaved = true;
+			#ifdef TRACE_TABU_SEARCH
+			++improvements;
+			#endif
 		}
 	}
-
-	// std::cout << "iteration: " << i << " objective: " << best_objective << std::endl;
-	// std::cout << "iteration: " << i << " solution: ";
-	// for (auto i = best_solution.begin(); i != best_solution.end(); i++)
-	//	std::cout << *i << " ";
-	// std::cout << std::endl;
-
-	signalCompletion();
+	if (unsaved)
+		saveIncumbent();
+	#ifdef TRACE_TABU_SEARCH
+	std::cout << "Tabu search - " << steps << " iterations, " << improvements << " improvements, ";
+	std::cout << aspirations << " aspirations, best " << best_objective << std::endl;
+	#endif
+	info = SolutionInfo(instance(), initial(), best_solution);
 }
-
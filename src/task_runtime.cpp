@@ -0,0 +1,277 @@
+#include "task_runtime.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <sched.h>
+
+using namespace R12;
+
+namespace {
+
+// index of the worker running on this thread, -1 for threads not owned by the runtime
+__thread int32_t currentWorker = -1;
+// whether this thread holds a slot, and since when
+__thread bool slotHeld = false;
+__thread timespec slotSince;
+
+double secondsSince(const timespec & t) {
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<double>(now.tv_sec - t.tv_sec) + static_cast<double>(now.tv_nsec - t.tv_nsec) * 1e-9;
+}
+
+}
+
+TaskRuntime::TaskRuntime()
+: m_threads(1), m_pending(0), m_nextQueue(0), m_shutdown(false), m_freeSlots(1), m_nextTicket(0), m_serving(0), m_quantum(0.05) {
+	pthread_mutex_init(&m_mutex, 0);
+	pthread_cond_init(&m_workCond, 0);
+	pthread_cond_init(&m_slotCond, 0);
+}
+
+TaskRuntime::~TaskRuntime() {
+	stopWorkers();
+	pthread_cond_destroy(&m_slotCond);
+	pthread_cond_destroy(&m_workCond);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+TaskRuntime & TaskRuntime::instance() {
+	static TaskRuntime runtime;
+	return runtime;
+}
+
+void TaskRuntime::init(const uint32_t threads) {
+	CHECK(m_handles.size() == 0);
+	pthread_mutex_lock(&m_mutex);
+	m_threads = std::max(1u, threads);
+	m_freeSlots += m_threads - 1;
+	pthread_mutex_unlock(&m_mutex);
+	// the thread calling parallelFor always takes part, so one worker less than slots is enough
+	const uint32_t workers = m_threads - 1;
+	m_queues.resize(workers);
+	for (uint32_t w = 0; w < workers; ++w) {
+		m_queues[w].reset(new WorkerQueue);
+		pthread_mutex_init(&m_queues[w]->mutex, 0);
+	}
+	m_handles.resize(workers);
+	m_args.resize(workers);
+	for (uint32_t w = 0; w < workers; ++w) {
+		m_args[w].runtime = this;
+		m_args[w].worker = w;
+		int err = pthread_create(&m_handles[w], 0, &TaskRuntime::doWork, &m_args[w]);
+		if (err != 0) {
+			throw std::runtime_error("TaskRuntime: pthread_create failed");
+		}
+	}
+}
+
+void TaskRuntime::stopWorkers() {
+	pthread_mutex_lock(&m_mutex);
+	m_shutdown = true;
+	pthread_cond_broadcast(&m_workCond);
+	pthread_mutex_unlock(&m_mutex);
+	for (uint32_t w = 0; w < m_handles.size(); ++w) {
+		pthread_join(m_handles[w], 0);
+	}
+	m_handles.clear();
+	for (uint32_t w = 0; w < m_queues.size(); ++w) {
+		pthread_mutex_destroy(&m_queues[w]->mutex);
+	}
+	m_queues.clear();
+}
+
+void * TaskRuntime::doWork(void * arg) {
+	WorkerArg * workerArg = static_cast<WorkerArg*>(arg);
+	currentWorker = workerArg->worker;
+	workerArg->runtime->work(workerArg->worker);
+	return 0;
+}
+
+void TaskRuntime::work(const uint32_t worker) {
+	while (true) {
+		pthread_mutex_lock(&m_mutex);
+		while (!m_shutdown && m_pending == 0) {
+			pthread_cond_wait(&m_workCond, &m_mutex);
+		}
+		if (m_shutdown) {
+			pthread_mutex_unlock(&m_mutex);
+			break;
+		}
+		--m_pending;
+		pthread_mutex_unlock(&m_mutex);
+		JobPtr job;
+		if (!popJob(worker, job)) {
+			continue;
+		}
+		// skip loops which are already fully claimed
+		if (job->next >= job->count) {
+			continue;
+		}
+		// helpers never queue for a slot: when heuristics use all of them the caller completes the loop alone
+		if (!tryAcquireSlot()) {
+			continue;
+		}
+		const uint32_t id = __sync_fetch_and_add(&job->joined, 1);
+		if (id < job->workers) {
+			runChunks(*job, id);
+		}
+		releaseSlot();
+	}
+}
+
+bool TaskRuntime::popJob(const uint32_t worker, JobPtr & job) {
+	// own deque first, newest ticket first
+	WorkerQueue & own = *m_queues[worker];
+	pthread_mutex_lock(&own.mutex);
+	if (own.jobs.size() > 0) {
+		job = own.jobs.back();
+		own.jobs.pop_back();
+	}
+	pthread_mutex_unlock(&own.mutex);
+	if (job) {
+		return true;
+	}
+	// steal the oldest ticket of another worker
+	const uint32_t workers = m_queues.size();
+	for (uint32_t i = 1; i < workers && !job; ++i) {
+		WorkerQueue & victim = *m_queues[(worker + i) % workers];
+		pthread_mutex_lock(&victim.mutex);
+		if (victim.jobs.size() > 0) {
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+		}
+		pthread_mutex_unlock(&victim.mutex);
+	}
+	return static_cast<bool>(job);
+}
+
+void TaskRuntime::pushJob(const JobPtr & job) {
+	uint32_t q;
+	if (currentWorker >= 0) {
+		q = currentWorker;
+	} else {
+		pthread_mutex_lock(&m_mutex);
+		q = m_nextQueue;
+		m_nextQueue = (m_nextQueue + 1) % m_queues.size();
+		pthread_mutex_unlock(&m_mutex);
+	}
+	WorkerQueue & queue = *m_queues[q];
+	pthread_mutex_lock(&queue.mutex);
+	queue.jobs.push_back(job);
+	pthread_mutex_unlock(&queue.mutex);
+	pthread_mutex_lock(&m_mutex);
+	++m_pending;
+	pthread_cond_signal(&m_workCond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TaskRuntime::runChunks(LoopJob & job, const uint32_t worker) {
+	while (true) {
+		const uint32_t begin = __sync_fetch_and_add(&job.next, job.chunk);
+		if (begin >= job.count) {
+			break;
+		}
+		const uint32_t end = std::min(job.count, begin + job.chunk);
+		(*job.body)(begin, end, worker);
+		__sync_fetch_and_add(&job.done, end - begin);
+	}
+}
+
+void TaskRuntime::parallelFor(const uint32_t count, ParallelBody & body, const uint32_t workers, const uint32_t chunk) {
+	const uint32_t maxWorkers = std::max(1u, std::min(workers, m_threads));
+	if (maxWorkers == 1 || count <= 1) {
+		if (count > 0) {
+			body(0, count, 0);
+		}
+		return;
+	}
+	JobPtr job(new LoopJob);
+	job->body = &body;
+	job->count = count;
+	job->chunk = chunk > 0 ? chunk : std::max(1u, count / (4 * maxWorkers));
+	job->workers = maxWorkers;
+	job->next = 0;
+	job->done = 0;
+	job->joined = 1;
+	// one ticket per potential helper
+	const uint32_t chunks = (count + job->chunk - 1) / job->chunk;
+	const uint32_t helpers = std::min(maxWorkers - 1, chunks - 1);
+	for (uint32_t h = 0; h < helpers; ++h) {
+		pushJob(job);
+	}
+	runChunks(*job, 0);
+	// wait for the chunks claimed by helpers, which are short
+	while (true) {
+		uint32_t done = job->done;
+		__sync_synchronize();
+		if (done == count) {
+			break;
+		}
+		sched_yield();
+	}
+}
+
+void TaskRuntime::acquireSlot() {
+	CHECK(!slotHeld);
+	pthread_mutex_lock(&m_mutex);
+	const uint64_t ticket = m_nextTicket++;
+	while (m_freeSlots == 0 || m_serving != ticket) {
+		pthread_cond_wait(&m_slotCond, &m_mutex);
+	}
+	++m_serving;
+	--m_freeSlots;
+	// the next ticket may be servable as well
+	pthread_cond_broadcast(&m_slotCond);
+	pthread_mutex_unlock(&m_mutex);
+	slotHeld = true;
+	clock_gettime(CLOCK_MONOTONIC, &slotSince);
+}
+
+bool TaskRuntime::tryAcquireSlot() {
+	pthread_mutex_lock(&m_mutex);
+	const bool acquired = m_freeSlots > 0 && m_serving == m_nextTicket;
+	if (acquired) {
+		--m_freeSlots;
+	}
+	pthread_mutex_unlock(&m_mutex);
+	slotHeld = acquired;
+	return acquired;
+}
+
+void TaskRuntime::releaseSlot() {
+	CHECK(slotHeld);
+	slotHeld = false;
+	pthread_mutex_lock(&m_mutex);
+	++m_freeSlots;
+	pthread_cond_broadcast(&m_slotCond);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void TaskRuntime::yieldSlot() {
+	if (!slotHeld) {
+		return;
+	}
+	// unsynchronized read: a stale value only delays the hand-over
+	if (m_serving == m_nextTicket) {
+		return;
+	}
+	if (secondsSince(slotSince) < m_quantum) {
+		return;
+	}
+	// queue behind the waiting threads
+	releaseSlot();
+	acquireSlot();
+}
+
+TaskRuntime::BlockingRegion::BlockingRegion() : m_held(slotHeld) {
+	if (m_held) {
+		TaskRuntime::instance().releaseSlot();
+	}
+}
+
+TaskRuntime::BlockingRegion::~BlockingRegion() {
+	if (m_held) {
+		TaskRuntime::instance().acquireSlot();
+	}
+}
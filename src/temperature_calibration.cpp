@@ -0,0 +1,65 @@
+#include "temperature_calibration.h"
+
+#include "move.h"
+#include "exchange.h"
+#include "move_verifier.h"
+#include "exchange_verifier.h"
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+
+using namespace R12;
+
+namespace {
+
+double secondsSince(const timespec & start) {
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<double>(now.tv_sec - start.tv_sec) + static_cast<double>(now.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+}
+
+uint64_t R12::calibrateTemperature(SolutionInfo & x, boost::mt19937 & rng, const uint64_t samples, const double seconds, const AtomicFlag & flag) {
+	boost::random::uniform_int_distribution<ProcessID> pDist(0, x.instance().processes().size() - 1);
+	boost::random::uniform_int_distribution<MachineID> mDist(0, x.instance().machines().size() - 1);
+	MoveVerifier mv(x);
+	ExchangeVerifier ev(x);
+	const uint64_t objective = x.objective();
+	const uint64_t maxTrials = CalibrationTrialFactor * samples;
+	timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	uint64_t maxDiff = 0;
+	uint64_t feasible = 0;
+	for (uint64_t trial = 1; feasible < samples && trial <= maxTrials; ++trial) {
+		// the clock and the flag are read every 1024 trials
+		if (trial % 1024 == 0 && (secondsSince(start) > seconds || flag.read())) {
+			break;
+		}
+		uint64_t obj;
+		// alternate moves and exchanges
+		if (trial % 2 == 0) {
+			const ProcessID p = pDist(rng);
+			const MachineID src = x.solution()[p];
+			const MachineID dst = mDist(rng);
+			Move move(p, src, dst);
+			if (src == dst || !mv.feasible(move)) {
+				continue;
+			}
+			obj = mv.objective(move);
+		} else {
+			const ProcessID p1 = pDist(rng);
+			const ProcessID p2 = pDist(rng);
+			const MachineID m1 = x.solution()[p1];
+			const MachineID m2 = x.solution()[p2];
+			Exchange exchange(m1, p1, m2, p2);
+			if (m1 == m2 || !ev.feasible(exchange)) {
+				continue;
+			}
+			obj = ev.objective(exchange);
+		}
+		++feasible;
+		maxDiff = std::max<uint64_t>(maxDiff, std::abs(static_cast<int64_t>(obj) - static_cast<int64_t>(objective)));
+	}
+	return feasible > 0 ? maxDiff : objective;
+}
@@ -109,7 +109,7 @@ void VNS::run() {
 	while (!interrupted()) {
 		++it;
 		// periodically sync with best result
-		if (it % syncPeriod == 0) {
+		if (it % syncPeriod == 0 && pool().bestObjective() < m_best->objective()) {
 			SolutionPool::Entry entry;
 			if (pool().best(entry)) {
 				if (entry.obj() < m_best->objective()) {
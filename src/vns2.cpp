@@ -32,7 +32,23 @@ Move VNS2::randomMove() {
 }
 
 Exchange VNS2::randomExchange() {
-	if (!m_useAdvisor) {
+	if (!m_useAdvisor && m_useBuckets) {
+		// partners with a similar requirement profile, preferably on another machine
+		const uint32_t maxDraws = 4;
+		ProcessID p1 = 0;
+		ProcessID p2 = 0;
+		for (uint32_t draw = 0; draw < maxDraws; ++draw) {
+			p1 = m_pDist(m_rng);
+			p2 = m_buckets->partner(p1, m_rng);
+			if (m_current->solution()[p1] != m_current->solution()[p2]) {
+				break;
+			}
+		}
+		MachineID m1 = m_current->solution()[p1];
+		MachineID m2 = m_current->solution()[p2];
+		Exchange exchange(m1, p1, m2, p2);
+		return exchange;
+	} else if (!m_useAdvisor) {
 		ProcessID p1, p2;
 		do {
 			p1 = m_pDist(m_rng);
@@ -191,6 +207,7 @@ void VNS2::run() {
 	// read parameters
 	m_useAdvisor = param<bool>("useAdvisor", false);
 	m_useDynamicAdvisor = param<bool>("useDynamicAdvisor", false);
+	m_useBuckets = param<bool>("useBuckets", false);
 	m_kMin = param<uint64_t>("kMin", 1);
 	m_kMax = param<uint64_t>("kMax", 100);
 	m_maxTrialsLS = param<uint64_t>("maxTrialsLS", defaultMaxTrialsLS());
@@ -202,7 +219,10 @@ void VNS2::run() {
 	m_mDist = MachineDist(0, instance().machines().size() - 1);
 	m_best.reset(new SolutionInfo(instance(), initial()));
 	if (m_useAdvisor) {
-		m_advisor.reset(new Advisor(instance(), initial(), m_rng));
+		m_advisor.reset(new Advisor(instance(), initial(), m_rng, param<uint32_t>("compThreads", 1)));
+	}
+	if (m_useBuckets) {
+		m_buckets.reset(new RequirementBuckets(instance()));
 	}
 	m_moveFeasibleEvalCount = 0;
 	m_moveObjectiveEvalCount = 0;
@@ -225,7 +245,7 @@ void VNS2::run() {
 	while (!interrupted()) {
 		++it;
 		// if time to sync, update best
-		if (it % syncPeriod == 0) {
+		if (it % syncPeriod == 0 && pool().bestObjective() < m_best->objective()) {
 			SolutionPool::Entry entry;
 			if (pool().best(entry)) {
 				if (entry.obj() < m_best->objective()) {
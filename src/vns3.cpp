@@ -10,70 +10,120 @@
 #include "smart_local_search_routine.h"
 #include "sequential_local_search_routine.h"
 #include "optimized_local_search_routine.h"
+#include "restore_local_search_routine.h"
 #include "load_cost_optimizer.h"
 #include "balance_cost_optimizer.h"
 #include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <boost/algorithm/string.hpp>
 
 #define TRACE_VNS3 0
 
-#if TRACE_VNS3 > 0
-#include <iostream>
-#endif
-
 using namespace std;
 using namespace R12;
 
-void VNS3::run() {
-	const uint64_t syncPeriod = 10;
+namespace {
+
+LocalSearchRoutine * makeLocalSearchRoutine(const std::string & name) {
+	if (name.compare("random") == 0) {
+		return new RandomLocalSearchRoutine;
+	} else if (name.compare("deep") == 0) {
+		return new DeepLocalSearchRoutine;
+	} else if (name.compare("smart") == 0) {
+		return new SmartLocalSearchRoutine;
+	} else if (name.compare("sequential") == 0) {
+		return new SequentialLocalSearchRoutine;
+	} else if (name.compare("optimized") == 0) {
+		return new OptimizedLocalSearchRoutine;
+	} else if (name.compare("restore") == 0) {
+		return new RestoreLocalSearchRoutine;
+	} else {
+		throw std::runtime_error("Invalid local search routine");
+	}
+}
+
+ShakeRoutine * makeShakeRoutine(const std::string & name) {
+	if (name.compare("random") == 0) {
+		return new RandomShakeRoutine;
+	} else if (name.compare("deep") == 0) {
+		return new DeepShakeRoutine;
+	} else {
+		throw std::runtime_error("Invalid shake routine");
+	}
+}
+
+// splits a list of routine names separated by slashes, adaptive standing for the given routines
+std::vector<std::string> routineNames(const std::string & value, const char * adaptive) {
+	std::vector<std::string> names;
+	boost::split(names, value.compare("adaptive") == 0 ? std::string(adaptive) : value, boost::is_any_of("/"));
+	return names;
+}
+
+}
+
+void VNS3::prepare() {
 	// read parameters
-	bool runLoadCostOpt = param<bool>("lcopt", false);
-	bool runBalanceCostOpt = param<bool>("bcopt", false);
 	m_kMin = param<uint64_t>("kMin", 1);
 	m_kMax = param<uint64_t>("kMax", 100);
 	m_kStep = param<uint64_t>("kStep", 1);
-	std::string lsName = param<std::string>("ls", "random");
-	std::string shakeName = param<std::string>("shake", "random");
+	m_lsNames = routineNames(param<std::string>("ls", "random"), "random/deep/smart/sequential/optimized");
+	m_shakeNames = routineNames(param<std::string>("shake", "random"), "random/deep");
+	const double exploration = param<double>("bandit_c", 0.5);
+	const double decay = param<double>("bandit_decay", 0.99);
 	ParameterMap lsParameters = parameters().extractGroup("ls");
 	ParameterMap shakeParameters = parameters().extractGroup("shake");
 	// create routines
-	std::unique_ptr<LocalSearchRoutine> ls;
-	if (lsName.compare("random") == 0) {
-		ls.reset(new RandomLocalSearchRoutine);
-	} else if (lsName.compare("deep") == 0) {
-		ls.reset(new DeepLocalSearchRoutine);
-	} else if (lsName.compare("smart") == 0) {
-		ls.reset(new SmartLocalSearchRoutine);
-	} else if (lsName.compare("sequential") == 0) {
-		ls.reset(new SequentialLocalSearchRoutine);
-	} else if (lsName.compare("optimized") == 0) {
-		ls.reset(new OptimizedLocalSearchRoutine);
-	} else {
-		signalError("Invalid local search routine");
-		return;
+	m_ls.clear();
+	for (uint32_t i = 0; i < m_lsNames.size(); ++i) {
+		m_ls.push_back(std::unique_ptr<LocalSearchRoutine>(makeLocalSearchRoutine(m_lsNames[i])));
+		m_ls.back()->init(instance(), initial(), flag(), m_rng, lsParameters);
 	}
-	std::unique_ptr<ShakeRoutine> shake;
-	if (shakeName.compare("random") == 0) {
-		shake.reset(new RandomShakeRoutine);
-	} else if (shakeName.compare("deep") == 0) {
-		shake.reset(new DeepShakeRoutine);
-	} else {
-		signalError("Invalid shake routine");
+	m_shake.clear();
+	for (uint32_t i = 0; i < m_shakeNames.size(); ++i) {
+		m_shake.push_back(std::unique_ptr<ShakeRoutine>(makeShakeRoutine(m_shakeNames[i])));
+		m_shake.back()->init(instance(), initial(), flag(), m_rng, shakeParameters);
+	}
+	m_lsBandit.reset(m_ls.size(), exploration, decay);
+	m_shakeBandit.reset(m_shake.size(), exploration, decay);
+	m_rng.seed(seed());
+}
+
+void VNS3::run() {
+	bool runLoadCostOpt = param<bool>("lcopt", false);
+	bool runBalanceCostOpt = param<bool>("bcopt", false);
+	uint32_t optThreads = param<uint32_t>("opt_threads", TaskRuntime::instance().threads());
+	try {
+		prepare();
+	} catch (std::runtime_error & e) {
+		signalError(e.what());
 		return;
 	}
-	ls->init(instance(), initial(), flag(), m_rng, lsParameters);
-	shake->init(instance(), initial(), flag(), m_rng, shakeParameters);
 	// initialize
-	m_rng.seed(seed());
 	m_best.reset(new SolutionInfo(instance(), initial()));
 	// run optimizer
 	if (runLoadCostOpt) {
-		LoadCostOptimizer lcopt;
+		LoadCostOptimizer lcopt(optThreads);
 		lcopt.optimize(*m_best);
 	}
 	if (runBalanceCostOpt) {
-		BalanceCostOptimizer bcopt;
+		BalanceCostOptimizer bcopt(optThreads);
 		bcopt.optimize(*m_best);
 	}
+	search();
+	signalCompletion();
+}
+
+void VNS3::runFromSolution(SolutionInfo & info) {
+	prepare();
+	m_best.reset(new SolutionInfo(info));
+	search();
+	info = *m_best;
+}
+
+void VNS3::search() {
+	const uint64_t syncPeriod = 10;
+	const bool adaptive = m_ls.size() > 1 || m_shake.size() > 1;
 	// prepare VNS
 	uint64_t k = m_kMin;
 	uint64_t it = 0;
@@ -82,7 +132,7 @@ void VNS3::run() {
 	while (!interrupted()) {
 		++it;
 		// if time to sync, update best
-		if (it % syncPeriod == 0) {
+		if (it % syncPeriod == 0 && pool().bestObjective() < m_best->objective()) {
 			SolutionPool::Entry entry;
 			if (pool().best(entry)) {
 				if (entry.obj() < m_best->objective()) {
@@ -91,12 +141,26 @@ void VNS3::run() {
 				}
 			}
 		}
+		// choose routines
+		const uint32_t lsIdx = m_lsBandit.select();
+		const uint32_t shakeIdx = m_shakeBandit.select();
+		const double start = adaptive ? elapsed() : 0.0;
 		// clone best
 		m_current.reset(new SolutionInfo(*m_best));
 		// find random solution in k neighborhood
-		shake->shake(*m_current, k);
+		m_shake[shakeIdx]->shake(*m_current, k);
 		// perform local search
-		ls->search(*m_current);
+		m_ls[lsIdx]->search(*m_current);
+		// reward the routines with the improvement per second
+		if (adaptive) {
+			const double seconds = std::max(elapsed() - start, 1e-6);
+			double gain = 0.0;
+			if (m_current->objective() < m_best->objective()) {
+				gain = static_cast<double>(m_best->objective() - m_current->objective());
+			}
+			m_lsBandit.update(lsIdx, gain, seconds);
+			m_shakeBandit.update(shakeIdx, gain, seconds);
+		}
 		// check improvement
 		if (m_current->objective() < m_best->objective()) {
 			#if TRACE_VNS3 >= 1
@@ -120,5 +184,20 @@ void VNS3::run() {
 	std::cout << "Iterations: " << it << std::endl;
 	std::cout << "Iterations with improvement: " << improvements << std::endl;
 	#endif
-	signalCompletion();
+	if (adaptive) {
+		printWeights();
+	}
+}
+
+void VNS3::printWeights() const {
+	std::cout << "VNS3 - Local search weights:";
+	for (uint32_t i = 0; i < m_ls.size(); ++i) {
+		std::cout << " " << m_lsNames[i] << "=" << m_lsBandit.weight(i) << " (" << m_lsBandit.plays(i) << ")";
+	}
+	std::cout << std::endl;
+	std::cout << "VNS3 - Shake weights:";
+	for (uint32_t i = 0; i < m_shake.size(); ++i) {
+		std::cout << " " << m_shakeNames[i] << "=" << m_shakeBandit.weight(i) << " (" << m_shakeBandit.plays(i) << ")";
+	}
+	std::cout << std::endl;
 }